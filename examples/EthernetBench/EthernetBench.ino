@@ -0,0 +1,158 @@
+/*
+ Ethernet driver benchmark
+
+ Report the RX/TX throughput of the Ethernet driver (frames/s, bytes/s) and
+ the CPU cycles it spends per frame, and measure how long the driver takes to
+ recover from RX descriptor exhaustion and a stalled TX DMA.
+
+ Add the following line to "lwipopts_extra.h" to enable the statistics:
+   #define ETH_BENCHMARK 1
+
+ Feed the board with a captured traffic profile from a host, e.g.
+   tcpreplay -i eth0 --topspeed capture.pcap
+ or with iPerf UDP traffic to port 5001:
+   iperf -u -c 192.168.10.85 -b 50M
+
+ MSH commands:
+   eth_bench         - Print and clear the statistics
+   eth_fault rx|tx   - Inject a RX exhaustion or TX stall fault
+
+*/
+
+#define ADD_MSH_CMD(name)
+#include <user_cmd.h>
+
+#include <rtt.h>
+#include <LwIP.h>
+#include <RttEthernet.h>
+#include <EthernetUdp.h>
+#include <utility/ethernetif.h>
+
+#define LOG_TAG "ETH_BENCH"
+#include <log.h>
+
+#if !ETH_BENCHMARK
+# error "Please define ETH_BENCHMARK to 1 in lwipopts_extra.h"
+#endif
+
+// Enter a MAC address and IP address for your controller below.
+// The IP address will be dependent on your local network:
+byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
+IPAddress ip(192, 168, 10, 85);
+IPAddress myDns(192, 168, 10, 254);
+IPAddress gateway(192, 168, 10, 254);
+IPAddress subnet(255, 255, 255, 0);
+
+// UDP sink port
+unsigned int localPort = 5001;
+
+// Report period in ms
+#define REPORT_PERIOD 5000
+
+EthernetUDP Udp;
+uint8_t packetBuffer[1500];
+
+void setup() {
+  RT_T.begin();
+}
+
+void setup_after_rtt_start() {
+  static int init_done = 0;
+  if (init_done) {
+    return;
+  }
+
+  // start the Ethernet
+  Ethernet.begin(mac, ip, myDns, gateway, subnet);
+
+  if (Ethernet.linkStatus() == LinkOFF) {
+    LOG_I("Ethernet cable is not connected.");
+  }
+
+  // start UDP sink
+  Udp.begin(localPort);
+  ethernetif_bench_reset();
+
+  init_done = 1;
+}
+
+void bench_report(void) {
+  ethernetif_bench_t bench;
+  uint32_t ms;
+
+  ethernetif_bench_get(&bench);
+  ethernetif_bench_reset();
+  ms = HAL_GetTick() - bench.start_tick;
+  if (ms == 0) {
+    return;
+  }
+
+  LOG_I("Period: %u ms", ms);
+  LOG_I("RX: %u frames/s, %u bytes/s, %u cycles/frame",
+    (uint32_t)((uint64_t)bench.rx_frames * 1000 / ms),
+    (uint32_t)(bench.rx_bytes * 1000 / ms),
+    bench.rx_frames ? (uint32_t)(bench.rx_cycles / bench.rx_frames) : 0);
+  LOG_I("TX: %u frames/s, %u bytes/s, %u cycles/frame",
+    (uint32_t)((uint64_t)bench.tx_frames * 1000 / ms),
+    (uint32_t)(bench.tx_bytes * 1000 / ms),
+    bench.tx_frames ? (uint32_t)(bench.tx_cycles / bench.tx_frames) : 0);
+  if (bench.rx_recover_cnt) {
+    LOG_I("RX recovery: %u times, avg %u us, max %u us",
+      bench.rx_recover_cnt,
+      (uint32_t)(bench.rx_recover_cycles / bench.rx_recover_cnt / (SystemCoreClock / 1000000)),
+      bench.rx_recover_max / (SystemCoreClock / 1000000));
+  }
+  if (bench.tx_recover_cnt) {
+    LOG_I("TX recovery: %u times, avg %u us, max %u us",
+      bench.tx_recover_cnt,
+      (uint32_t)(bench.tx_recover_cycles / bench.tx_recover_cnt / (SystemCoreClock / 1000000)),
+      bench.tx_recover_max / (SystemCoreClock / 1000000));
+  }
+}
+
+void loop() {
+  static uint32_t last = 0;
+
+  setup_after_rtt_start();
+
+  // drain the UDP sink
+  while (Udp.parsePacket()) {
+    Udp.read(packetBuffer, sizeof(packetBuffer));
+  }
+
+  if ((millis() - last) >= REPORT_PERIOD) {
+    last = millis();
+    bench_report();
+  }
+  rt_thread_mdelay(1);
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int eth_bench(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  bench_report();
+  return 0;
+}
+MSH_CMD_EXPORT(eth_bench, Print Ethernet benchmark.)
+
+int eth_fault(int argc, char **argv) {
+  if ((argc == 2) && !rt_strcmp(argv[1], "rx")) {
+    ethernetif_bench_inject(ETH_FAULT_RX_EXHAUST);
+  } else if ((argc == 2) && !rt_strcmp(argv[1], "tx")) {
+    ethernetif_bench_inject(ETH_FAULT_TX_STALL);
+  } else {
+    rt_kprintf("Usage: eth_fault rx|tx\n");
+  }
+  return 0;
+}
+MSH_CMD_EXPORT(eth_fault, Inject Ethernet fault.)
+
+#ifdef __cplusplus
+}
+#endif
+ADD_MSH_CMD(eth_bench)
+ADD_MSH_CMD(eth_fault)
@@ -0,0 +1,2 @@
+ADD_MSH_CMD(eth_bench)
+ADD_MSH_CMD(eth_fault)
@@ -0,0 +1,98 @@
+/*
+ Fast boot benchmark
+
+ Measure the time from reset to the first successful TCP connection, with or
+ without fast boot.
+
+ Run it once with SAVED_LINK_CONFIG 0, then set SAVED_LINK_CONFIG to the
+ printed link config (e.g. stored in flash or backup registers by a real
+ application) and compare the times. Set FAST_BOOT to 0 for the reference.
+
+ For best result, also add the following lines to "lwipopts_extra.h":
+   #define ETH_INIT_ASYNC 1
+   #define ARP_QUEUEING 1
+   #define MEMP_NUM_ARP_QUEUE 8
+
+ Start a TCP server on the host, e.g.
+   nc -lk 5001
+
+ Circuit:
+ * STM32 board with Ethernet support
+
+ */
+
+#include <rtt.h>
+#include <LwIP.h>
+#include <RttEthernet.h>
+
+#define LOG_TAG "FAST_BOOT"
+#include <log.h>
+
+#define FAST_BOOT 1
+#define SAVED_LINK_CONFIG 0
+
+// Enter a MAC address and IP address for your controller below.
+// The IP address will be dependent on your local network:
+byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
+IPAddress ip(192, 168, 10, 85);
+IPAddress myDns(192, 168, 10, 254);
+IPAddress gateway(192, 168, 10, 254);
+IPAddress subnet(255, 255, 255, 0);
+
+// TCP server to connect to
+IPAddress server(192, 168, 10, 10);
+unsigned int serverPort = 5001;
+
+EthernetClient client;
+
+void setup() {
+  RT_T.begin();
+}
+
+void setup_after_rtt_start() {
+  static int init_done = 0;
+  if (init_done) {
+    return;
+  }
+  unsigned long start = millis();
+  unsigned long ready;
+
+  // start the Ethernet
+#if FAST_BOOT
+  Ethernet.fastBoot(SAVED_LINK_CONFIG);
+#endif
+  Ethernet.begin(mac, ip, myDns, gateway, subnet);
+  unsigned long begun = millis();
+
+  if (!Ethernet.waitReady(10000)) {
+    LOG_I("Ethernet is not ready, is the cable connected?");
+    init_done = 1;
+    return;
+  }
+  ready = millis();
+
+  // retry until the server accepts the connection
+  while (!client.connect(server, serverPort)) {
+    if ((millis() - ready) > 10000) {
+      LOG_I("connection failed");
+      init_done = 1;
+      return;
+    }
+  }
+  unsigned long connected = millis();
+  client.stop();
+
+  LOG_I("Fast boot: %s", FAST_BOOT ? "on" : "off");
+  LOG_I("  Reset to setup:    %lu ms", start);
+  LOG_I("  begin():           %lu ms", begun - start);
+  LOG_I("  Network ready:     %lu ms", ready - start);
+  LOG_I("  First TCP connect: %lu ms", connected - start);
+  LOG_I("Link config: 0x%02x", Ethernet.linkConfig());
+
+  init_done = 1;
+}
+
+void loop() {
+  setup_after_rtt_start();
+  rt_thread_mdelay(100);
+}
@@ -0,0 +1,80 @@
+/*
+ PTP Client
+
+ Synchronize the Ethernet MAC clock to an IEEE 1588 (PTP) master on the local
+ network with hardware time stamps, and print the offset from master and the
+ path delay every second.
+
+ Add the following line to "lwipopts_extra.h" to enable the time stamps:
+   #define ETH_PTP 1
+
+ Run a PTPv2 master (UDP/IPv4, end-to-end delay) on the network, e.g.
+   ptp4l -i eth0 -4 -E -m
+
+*/
+
+#include <rtt.h>
+#include <LwIP.h>
+#include <RttEthernet.h>
+#include <EthernetPtp.h>
+
+#define LOG_TAG "PTP_CL"
+#include <log.h>
+
+#if !ETH_PTP
+# error "Please define ETH_PTP to 1 in lwipopts_extra.h"
+#endif
+
+// Enter a MAC address for your controller below.
+byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
+
+// Report period in ms
+#define REPORT_PERIOD 1000
+
+EthernetPTP Ptp;
+
+void setup() {
+  RT_T.begin();
+}
+
+void setup_after_rtt_start() {
+  static int init_done = 0;
+  if (init_done) {
+    return;
+  }
+
+  // start Ethernet and PTP
+  if (Ethernet.begin(mac) == 0) {
+    LOG_I("Failed to configure Ethernet using DHCP");
+    if (Ethernet.linkStatus() == LinkOFF) {
+      LOG_I("Ethernet cable is not connected.");
+    }
+    // no point in carrying on, so do nothing forevermore:
+    while (true) {
+      rt_thread_mdelay(1000);
+    }
+  }
+  if (!Ptp.begin()) {
+    LOG_I("Failed to start PTP");
+  }
+
+  init_done = 1;
+}
+
+void loop() {
+  static uint32_t last = 0;
+  uint32_t sec, nsec;
+
+  setup_after_rtt_start();
+
+  // time stamps are taken by hardware, polling latency doesn't matter
+  Ptp.maintain();
+
+  if ((millis() - last) >= REPORT_PERIOD) {
+    last = millis();
+    Ptp.time(sec, nsec);
+    LOG_I("Time %u.%09u, offset %d ns, delay %u ns%s", sec, nsec,
+      Ptp.offset(), Ptp.delay(), Ptp.synchronized() ? ", synchronized" : "");
+  }
+  rt_thread_mdelay(10);
+}
@@ -0,0 +1,442 @@
+/***************************************************************************//**
+ * @file    eth_bench.cpp
+ * @brief   Host build: driver benchmark and fault recovery on the ETH model
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * Feeds the frames of a pcap file (or synthetic UDP frames) to the RX DMA of
+ * the model, as fast as the line allows (100 Mbit/s, virtual time), and runs
+ * the unmodified driver on them:
+ *  - Throughput: frames/s and bytes/s (wall clock, driver and model), and
+ *    host cycles/frame spent in low_level_input() / low_level_output()
+ *  - Fault injection, with the measured recovery time:
+ *    - rbus:    interrupt held while a burst exhausts the RX descriptors
+ *    - tus:     TX underflow
+ *    - rx:      ETH_FAULT_RX_EXHAUST, ring handed back without poll demand
+ *    - tx:      ETH_FAULT_TX_STALL, a transmit poll demand lost
+ *
+ * usage: eth_bench [-r in.pcap] [-w out.pcap] [-n frames] [-s size] [-e]
+ *                  [-l] [-f rbus,tus,rx,tx] [-v]
+ ******************************************************************************/
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "host_lwip.h"
+#include "eth_model.h"
+#include "ethernetif.h"
+#include "stm32_eth.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PCAP_MAGIC_US         0xA1B2C3D4UL
+#define PCAP_MAGIC_NS         0xA1B23C4DUL
+#define PCAP_LINKTYPE_ETH     1U
+#define FRAME_MIN             14U
+#define FRAME_MAX             1514U
+/* Preamble, SFD, FCS and inter frame gap */
+#define WIRE_OVERHEAD         24U
+#define WIRE_NS_PER_BYTE      80U
+#define FAULT_ROUNDS          100U
+#define FAULT_STEP_NS         1000U
+#define FAULT_STEP_MAX        10000U
+
+#if !ETH_BENCHMARK
+# error "ETH_BENCHMARK is required"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+typedef std::vector<uint8_t> frame_t;
+
+/* Private variables ---------------------------------------------------------*/
+static std::vector<frame_t> frames;
+static FILE *pcap_out;
+static uint8_t echo;
+extern int host_log_level;
+/* Declared by stm32_eth.h in interrupt mode only */
+extern struct netif gnetif;
+
+/* Private functions ---------------------------------------------------------*/
+static double wall_time(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint32_t swap32(uint32_t v) {
+  return __builtin_bswap32(v);
+}
+
+static int pcap_load(const char *name) {
+  FILE *f = fopen(name, "rb");
+  uint32_t hdr[6];
+  uint32_t rec[4];
+  uint8_t swap;
+  uint32_t len;
+  frame_t frame;
+
+  if (f == NULL) {
+    perror(name);
+    return -1;
+  }
+  if (fread(hdr, sizeof(hdr), 1, f) != 1) {
+    fprintf(stderr, "%s: no pcap header\n", name);
+    fclose(f);
+    return -1;
+  }
+  if ((hdr[0] == PCAP_MAGIC_US) || (hdr[0] == PCAP_MAGIC_NS)) {
+    swap = 0;
+  } else if ((swap32(hdr[0]) == PCAP_MAGIC_US) || (swap32(hdr[0]) == PCAP_MAGIC_NS)) {
+    swap = 1;
+  } else {
+    fprintf(stderr, "%s: not a pcap file\n", name);
+    fclose(f);
+    return -1;
+  }
+  if ((swap ? swap32(hdr[5]) : hdr[5]) != PCAP_LINKTYPE_ETH) {
+    fprintf(stderr, "%s: not Ethernet\n", name);
+    fclose(f);
+    return -1;
+  }
+
+  while (fread(rec, sizeof(rec), 1, f) == 1) {
+    len = swap ? swap32(rec[2]) : rec[2];
+    frame.resize(len);
+    if ((len != 0) && (fread(frame.data(), len, 1, f) != 1)) {
+      break;
+    }
+    /* Captured without FCS, truncated ones are skipped */
+    if ((len >= FRAME_MIN) && (len <= FRAME_MAX) && ((swap ? swap32(rec[3]) : rec[3]) == len)) {
+      frames.push_back(frame);
+    }
+  }
+  fclose(f);
+  return frames.empty() ? -1 : 0;
+}
+
+static void pcap_sink(const uint8_t *frame, uint16_t len, void *arg) {
+  uint64_t ns = eth_model_now();
+  uint32_t hdr[4];
+  (void)arg;
+
+  hdr[0] = (uint32_t)(ns / 1000000000ULL);
+  hdr[1] = (uint32_t)(ns % 1000000000ULL);
+  hdr[2] = len;
+  hdr[3] = len;
+  fwrite(hdr, sizeof(hdr), 1, pcap_out);
+  fwrite(frame, len, 1, pcap_out);
+}
+
+static int pcap_create(const char *name) {
+  static const uint32_t hdr[6] = { PCAP_MAGIC_NS, 0x00040002UL, 0, 0, 65535, PCAP_LINKTYPE_ETH };
+
+  pcap_out = fopen(name, "wb");
+  if (pcap_out == NULL) {
+    perror(name);
+    return -1;
+  }
+  fwrite(hdr, sizeof(hdr), 1, pcap_out);
+  eth_model_set_tx_sink(pcap_sink, NULL);
+  return 0;
+}
+
+/* UDP frame to the station address, port 5001 */
+static void synth_frames(uint32_t size) {
+  static const uint8_t src[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  frame_t frame(size);
+  uint8_t *ip = &frame[SIZEOF_ETH_HDR];
+  uint8_t *udp = ip + IP_HLEN;
+  uint16_t ip_len = (uint16_t)(size - SIZEOF_ETH_HDR);
+  uint16_t chksum;
+  uint32_t i;
+
+  memcpy(&frame[0], gnetif.hwaddr, ETH_HWADDR_LEN);
+  memcpy(&frame[6], src, sizeof(src));
+  frame[12] = 0x08;
+  frame[13] = 0x00;
+  ip[0] = 0x45;
+  ip[2] = (uint8_t)(ip_len >> 8);
+  ip[3] = (uint8_t)ip_len;
+  ip[8] = 64;
+  ip[9] = IP_PROTO_UDP;
+  memcpy(&ip[12], "\xC0\xA8\x0A\x01", 4);
+  memcpy(&ip[16], "\xC0\xA8\x0A\x55", 4);
+  chksum = inet_chksum(ip, IP_HLEN);
+  memcpy(&ip[10], &chksum, 2);
+  udp[0] = 0x13;
+  udp[1] = 0x89;
+  udp[2] = 0x13;
+  udp[3] = 0x89;
+  udp[4] = (uint8_t)((ip_len - IP_HLEN) >> 8);
+  udp[5] = (uint8_t)(ip_len - IP_HLEN);
+  for (i = SIZEOF_ETH_HDR + IP_HLEN + UDP_HLEN; i < size; i++) {
+    frame[i] = (uint8_t)i;
+  }
+  frames.push_back(frame);
+}
+
+/* tcpip_thread input: echo the frame back, or drop it */
+static err_t bench_input(struct pbuf *p, struct netif *netif) {
+  if (echo) {
+    (void)netif->linkoutput(netif, p);
+  }
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+/* What tcpip_thread and ethernet thread would do, without waiting */
+static void service(void) {
+  uint32_t events;
+
+  (void)host_tcpip_poll(0);
+#ifndef ETH_INPUT_USE_IT
+  ethernetif_input(&gnetif);
+#endif
+  events = ethernetif_wait_event(0);
+  if (events & (ETH_EVENT_RX_RESUME | ETH_EVENT_TX_RESUME | ETH_EVENT_TX_RECLAIM)) {
+    ethernetif_resume(&gnetif, events);
+  }
+  (void)host_tcpip_poll(0);
+}
+
+static void wire(const frame_t &frame) {
+  (void)eth_model_rx(frame.data(), (uint16_t)frame.size());
+  eth_model_step((frame.size() + WIRE_OVERHEAD) * WIRE_NS_PER_BYTE);
+  service();
+}
+
+static void settle(void) {
+  uint32_t i;
+
+  for (i = 0; i < 16; i++) {
+    eth_model_step(FAULT_STEP_NS);
+    service();
+  }
+}
+
+static void print_rate(const char *dir, uint32_t n, uint64_t bytes, uint64_t cycles, double sec) {
+  printf("%s: %u frames, %.0f frames/s, %.0f bytes/s, %llu cycles/frame\n", dir, n,
+    n / sec, bytes / sec, n ? (unsigned long long)(cycles / n) : 0ULL);
+}
+
+static void print_recovery(const char *name, uint32_t cnt, uint64_t cycles, uint64_t max, uint64_t ns) {
+  if (cnt == 0) {
+    printf("  %-5s: not recovered\n", name);
+    return;
+  }
+  printf("  %-5s: %u times, avg %llu cycles, max %llu cycles", name, cnt,
+    (unsigned long long)(cycles / cnt), (unsigned long long)max);
+  if (ns) {
+    printf(", DMA idle avg %llu ns", (unsigned long long)(ns / cnt));
+  }
+  printf("\n");
+}
+
+static void run_throughput(uint32_t count) {
+  ethernetif_bench_t bench;
+  eth_model_stats_t model;
+  ethernetif_stats_t stats;
+  double start;
+  double sec;
+  uint32_t i;
+
+  eth_model_clear_stats();
+  ethernetif_clear_stats();
+  ethernetif_bench_reset();
+  start = wall_time();
+  for (i = 0; i < count; i++) {
+    wire(frames[i % frames.size()]);
+  }
+  settle();
+  sec = wall_time() - start;
+
+  ethernetif_bench_get(&bench);
+  eth_model_get_stats(&model);
+  ethernetif_get_stats(&stats);
+  printf("Throughput: %u frames in %.3f s (line %.3f ms)\n", count, sec, eth_model_now() / 1e6);
+  print_rate("RX", bench.rx_frames, bench.rx_bytes, bench.rx_cycles, sec);
+  if (echo) {
+    print_rate("TX", bench.tx_frames, bench.tx_bytes, bench.tx_cycles, sec);
+  }
+  printf("  DMA: rx %u, missed %u, rbus %u, tx %u, tbus %u, irq %u\n",
+    model.rx_frames, model.rx_missed, model.rx_rbus, model.tx_frames, model.tx_tbus, model.irq);
+  printf("  Driver: rx irq %u, mbox drop %u, tx reclaim %u, tx queue drop %u, pbuf in use %u\n",
+    stats.rx_irq, stats.rx_mbox_drop, stats.tx_reclaim, stats.tx_queue_drop, host_pbuf_used());
+}
+
+static void send_frame(const frame_t &frame) {
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)frame.size(), PBUF_RAM);
+
+  if (p == NULL) {
+    return;
+  }
+  (void)pbuf_take(p, frame.data(), (u16_t)frame.size());
+  LOCK_TCPIP_CORE();
+  (void)gnetif.linkoutput(&gnetif, p);
+  UNLOCK_TCPIP_CORE();
+  pbuf_free(p);
+}
+
+/* Interrupt held while more frames than RX descriptors arrive */
+static void fault_rbus(void) {
+  eth_model_stats_t model;
+  uint32_t i;
+  uint32_t j;
+
+  eth_model_clear_stats();
+  for (i = 0; i < FAULT_ROUNDS; i++) {
+    eth_model_irq_hold(1);
+    for (j = 0; j < (ETH_RXBUFNB + 1); j++) {
+      (void)eth_model_rx(frames[j % frames.size()].data(), (uint16_t)frames[j % frames.size()].size());
+      eth_model_step((frames[j % frames.size()].size() + WIRE_OVERHEAD) * WIRE_NS_PER_BYTE);
+    }
+    eth_model_irq_hold(0);
+    settle();
+  }
+  eth_model_get_stats(&model);
+  print_recovery("rbus", model.rx_recover_cnt, model.rx_recover_cycles, model.rx_recover_max, model.rx_recover_ns);
+}
+
+/* TX underflow */
+static void fault_tus(void) {
+  eth_model_stats_t model;
+  uint32_t i;
+
+  eth_model_clear_stats();
+  for (i = 0; i < FAULT_ROUNDS; i++) {
+    eth_model_inject(ETH_MODEL_FAULT_TUS);
+    send_frame(frames[i % frames.size()]);
+    settle();
+    send_frame(frames[i % frames.size()]);
+    settle();
+  }
+  eth_model_get_stats(&model);
+  print_recovery("tus", model.tx_recover_cnt, model.tx_recover_cycles, model.tx_recover_max, model.tx_recover_ns);
+}
+
+/* Faults injected by the driver, recovery measured by it */
+static void fault_driver(uint32_t fault) {
+  ethernetif_bench_t bench;
+  uint32_t i;
+  uint32_t j;
+  uint32_t cnt;
+
+  ethernetif_bench_reset();
+  for (i = 0; i < FAULT_ROUNDS; i++) {
+    ethernetif_bench_get(&bench);
+    cnt = (fault == ETH_FAULT_RX_EXHAUST) ? bench.rx_recover_cnt : bench.tx_recover_cnt;
+    ethernetif_bench_inject(fault);
+    for (j = 0; j < FAULT_STEP_MAX; j++) {
+      if (fault == ETH_FAULT_RX_EXHAUST) {
+        wire(frames[j % frames.size()]);
+      } else {
+        send_frame(frames[j % frames.size()]);
+        eth_model_step(FAULT_STEP_NS);
+        service();
+      }
+      ethernetif_bench_get(&bench);
+      if (((fault == ETH_FAULT_RX_EXHAUST) ? bench.rx_recover_cnt : bench.tx_recover_cnt) != cnt) {
+        break;
+      }
+    }
+    settle();
+  }
+  ethernetif_bench_get(&bench);
+  if (fault == ETH_FAULT_RX_EXHAUST) {
+    print_recovery("rx", bench.rx_recover_cnt, bench.rx_recover_cycles, bench.rx_recover_max, 0);
+  } else {
+    print_recovery("tx", bench.tx_recover_cnt, bench.tx_recover_cycles, bench.tx_recover_max, 0);
+  }
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+    "usage: %s [-r in.pcap] [-w out.pcap] [-n frames] [-s size] [-e] [-l] [-f rbus,tus,rx,tx] [-v]\n"
+    "  -r  replay the frames of a pcap file (Ethernet, without FCS)\n"
+    "  -w  write the transmitted frames to a pcap file\n"
+    "  -n  frames to receive, 100000 by default\n"
+    "  -s  size of the synthetic UDP frames if no pcap, 1024 by default\n"
+    "  -e  echo the received frames back (TX benchmark)\n"
+    "  -l  transmit at line rate (virtual time)\n"
+    "  -f  faults to inject after the throughput run\n"
+    "  -v  driver log\n", name);
+}
+
+/* Exported functions ------------------------------------------------------- */
+int main(int argc, char **argv) {
+  const char *in = NULL;
+  const char *out = NULL;
+  const char *faults = NULL;
+  uint32_t count = 100000;
+  uint32_t size = 1024;
+  uint8_t line_rate = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:w:n:s:elf:v")) != -1) {
+    switch (opt) {
+      case 'r': in = optarg; break;
+      case 'w': out = optarg; break;
+      case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 's': size = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'e': echo = 1; break;
+      case 'l': line_rate = 1; break;
+      case 'f': faults = optarg; break;
+      case 'v': host_log_level = 4; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if ((size < (SIZEOF_ETH_HDR + IP_HLEN + UDP_HLEN)) || (size > FRAME_MAX) || (count == 0)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  eth_model_reset();
+  eth_model_set_line_rate(line_rate);
+  if ((out != NULL) && pcap_create(out)) {
+    return 1;
+  }
+  host_tcpip_set_input(bench_input);
+  ethernetif_event_init();
+  if (netif_add(&gnetif, NULL, NULL, NULL, NULL, ethernetif_init, tcpip_input) == NULL) {
+    fprintf(stderr, "ethernetif_init failed\n");
+    return 1;
+  }
+  netif_set_default(&gnetif);
+  netif_set_up(&gnetif);
+  settle();
+
+  if (in != NULL) {
+    if (pcap_load(in)) {
+      return 1;
+    }
+    printf("Replay: %s, %u frames\n", in, (uint32_t)frames.size());
+  } else {
+    synth_frames(size);
+    printf("Synthetic: UDP, %u bytes\n", size);
+  }
+
+  run_throughput(count);
+
+  if (faults != NULL) {
+    printf("Recovery (%u rounds each):\n", FAULT_ROUNDS);
+    if (strstr(faults, "rbus")) {
+      fault_rbus();
+    }
+    if (strstr(faults, "tus")) {
+      fault_tus();
+    }
+    if (strstr(faults, "rx")) {
+      fault_driver(ETH_FAULT_RX_EXHAUST);
+    }
+    if (strstr(faults, "tx")) {
+      fault_driver(ETH_FAULT_TX_STALL);
+    }
+  }
+
+  if (pcap_out != NULL) {
+    fclose(pcap_out);
+  }
+  return 0;
+}
@@ -0,0 +1,34 @@
+/***************************************************************************//**
+ * @file    Arduino.h
+ * @brief   Host build: Arduino core subset used by the driver
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "stm32_def.h"
+#include "PeripheralPins.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define INPUT_PULLUP          2U
+#define FALLING               2U
+
+/* Exported macro ------------------------------------------------------------*/
+#define digitalPinToInterrupt(p)  (p)
+
+/* Exported functions ------------------------------------------------------- */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t millis(void);
+void pinMode(uint32_t pin, uint32_t mode);
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_ARDUINO_H__ */
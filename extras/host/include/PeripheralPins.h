@@ -0,0 +1,48 @@
+/***************************************************************************//**
+ * @file    PeripheralPins.h
+ * @brief   Host build: pin map subset used by the driver
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#ifndef __HOST_PERIPHERALPINS_H__
+#define __HOST_PERIPHERALPINS_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "stm32_def.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+  NC = 0xFFFFFFFF
+} PinName;
+
+typedef struct {
+  PinName pin;
+  void *peripheral;
+  int function;
+} PinMap;
+
+/* Exported macro ------------------------------------------------------------*/
+#define pin_pinName(map)      ((map)->pin)
+#define STM_PORT(pin)         (((uint32_t)(pin) >> 4) & 0xFU)
+#define STM_GPIO_PIN(pin)     (1U << ((uint32_t)(pin) & 0xFU))
+#define STM_PIN_MODE(func)    ((uint32_t)(func) & 0x7U)
+#define STM_PIN_PUPD(func)    (((uint32_t)(func) >> 4) & 0x3U)
+#define STM_PIN_AFNUM(func)   (((uint32_t)(func) >> 8) & 0xFU)
+
+/* Exported variables --------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* No pins on host: the map is empty */
+extern const PinMap PinMap_Ethernet[];
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t pinmap_function(PinName pin, const PinMap *map);
+GPIO_TypeDef *set_GPIO_Port_Clock(uint32_t port_idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_PERIPHERALPINS_H__ */
@@ -0,0 +1,28 @@
+/***************************************************************************//**
+ * @file    host_cycles.h
+ * @brief   Host build: CPU cycle counter
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#ifndef __HOST_CYCLES_H__
+#define __HOST_CYCLES_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#if !defined(__x86_64__) && !defined(__i386__)
+#include <time.h>
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+/* Time stamp counter where available, else nanoseconds */
+static inline uint64_t host_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#endif /* __HOST_CYCLES_H__ */
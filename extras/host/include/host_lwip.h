@@ -0,0 +1,541 @@
+/***************************************************************************//**
+ * @file    host_lwip.h
+ * @brief   Host build: LwIP subset used by the driver
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * Only what the driver (utility/) uses, with the LwIP 2.1 names and
+ * semantics. "pbuf", memory pools and tcpip_thread mailbox are functional,
+ * protocols (TCP, UDP, DHCP, DNS, ARP) are stubs. All the forwarding headers
+ * in lwip/ and netif/ include this one.
+ ******************************************************************************/
+#ifndef __HOST_LWIP_H__
+#define __HOST_LWIP_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
+#include "lwipopts.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef LWIP_IGMP
+#define LWIP_IGMP             0
+#endif
+#ifndef LWIP_IPV6
+#define LWIP_IPV6             0
+#endif
+#ifndef LWIP_DNS
+#define LWIP_DNS              0
+#endif
+#ifndef LWIP_UDP
+#define LWIP_UDP              1
+#endif
+#ifndef LWIP_TCP
+#define LWIP_TCP              1
+#endif
+#ifndef LWIP_NETIF_HOSTNAME
+#define LWIP_NETIF_HOSTNAME   0
+#endif
+#ifndef TCPIP_MBOX_SIZE
+#define TCPIP_MBOX_SIZE       8
+#endif
+#ifndef CHECKSUM_CHECK_TCP
+#define CHECKSUM_CHECK_TCP    1
+#endif
+#ifndef TCP_MSS
+#define TCP_MSS               536
+#endif
+#ifndef TCP_SND_BUF
+#define TCP_SND_BUF           (2 * TCP_MSS)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef uint8_t   u8_t;
+typedef int8_t    s8_t;
+typedef uint16_t  u16_t;
+typedef int16_t   s16_t;
+typedef uint32_t  u32_t;
+typedef int32_t   s32_t;
+typedef uintptr_t mem_ptr_t;
+typedef s8_t      err_t;
+typedef int       sys_prot_t;
+
+typedef enum {
+  ERR_OK         = 0,
+  ERR_MEM        = -1,
+  ERR_BUF        = -2,
+  ERR_TIMEOUT    = -3,
+  ERR_RTE        = -4,
+  ERR_INPROGRESS = -5,
+  ERR_VAL        = -6,
+  ERR_WOULDBLOCK = -7,
+  ERR_USE        = -8,
+  ERR_ALREADY    = -9,
+  ERR_ISCONN     = -10,
+  ERR_CONN       = -11,
+  ERR_IF         = -12,
+  ERR_ABRT       = -13,
+  ERR_RST        = -14,
+  ERR_CLSD       = -15,
+  ERR_ARG        = -16
+} err_enum_t;
+
+/* Exported macro ------------------------------------------------------------*/
+#define LWIP_ASSERT(message, assertion) do { \
+  if (!(assertion)) { \
+    host_lwip_assert(message, __FILE__, __LINE__); \
+  } \
+} while (0)
+#define LWIP_UNUSED_ARG(x)    (void)x
+#define LWIP_MIN(x, y)        (((x) < (y)) ? (x) : (y))
+#define LWIP_MAX(x, y)        (((x) > (y)) ? (x) : (y))
+#define LWIP_MEM_ALIGN_SIZE(size) (((size) + 3U) & ~3U)
+
+#define PP_HTONS(x)           ((u16_t)((((x) & 0x00ffUL) << 8) | (((x) & 0xff00UL) >> 8)))
+#define PP_NTOHS(x)           PP_HTONS(x)
+#define PP_HTONL(x)           ((((x) & 0x000000ffUL) << 24) | (((x) & 0x0000ff00UL) << 8) | \
+                               (((x) & 0x00ff0000UL) >> 8) | (((x) & 0xff000000UL) >> 24))
+#define PP_NTOHL(x)           PP_HTONL(x)
+#define lwip_htons(x)         PP_HTONS(x)
+#define lwip_ntohs(x)         PP_NTOHS(x)
+#define lwip_htonl(x)         PP_HTONL(x)
+#define lwip_ntohl(x)         PP_NTOHL(x)
+
+/* Critical section: recursive, as the ETH model runs interrupts in line */
+#define SYS_ARCH_DECL_PROTECT(lev)  sys_prot_t lev
+#define SYS_ARCH_PROTECT(lev)       lev = sys_arch_protect()
+#define SYS_ARCH_UNPROTECT(lev)     sys_arch_unprotect(lev)
+
+#define LOCK_TCPIP_CORE()     sys_lock_tcpip_core()
+#define UNLOCK_TCPIP_CORE()   sys_unlock_tcpip_core()
+
+void host_lwip_assert(const char *message, const char *file, int line);
+sys_prot_t sys_arch_protect(void);
+void sys_arch_unprotect(sys_prot_t lev);
+void sys_lock_tcpip_core(void);
+void sys_unlock_tcpip_core(void);
+
+/* IP addresses --------------------------------------------------------------*/
+typedef struct ip4_addr {
+  u32_t addr;
+} ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+#define ip4_addr_get_u32(src_ipaddr)      ((src_ipaddr)->addr)
+#define ip4_addr_set_u32(dest_ipaddr, src_u32) ((dest_ipaddr)->addr = (src_u32))
+#define ip_addr_set_zero_ip4(ipaddr)      ((ipaddr)->addr = 0)
+#define IP4_ADDR(ipaddr, a, b, c, d)      ((ipaddr)->addr = PP_HTONL(((u32_t)((a) & 0xff) << 24) | \
+                                          ((u32_t)((b) & 0xff) << 16) | ((u32_t)((c) & 0xff) << 8) | (u32_t)((d) & 0xff)))
+#define IP_ADDR4(ipaddr, a, b, c, d)      IP4_ADDR(ipaddr, a, b, c, d)
+#define ip_addr_copy(dest, src)           ((dest) = (src))
+#define ip4_addr_isany_val(addr1)         ((addr1).addr == 0)
+#define ip4_addr_isany(addr1)             (((addr1) == NULL) || ((addr1)->addr == 0))
+#define ip_addr_isany(ipaddr)             ip4_addr_isany(ipaddr)
+#define ip4_addr_ismulticast(addr1)       (((addr1)->addr & PP_HTONL(0xf0000000UL)) == PP_HTONL(0xe0000000UL))
+#define ip_addr_ismulticast(ipaddr)       ip4_addr_ismulticast(ipaddr)
+#define ip4_addr_cmp(addr1, addr2)        ((addr1)->addr == (addr2)->addr)
+#define ip4_addr_netcmp(addr1, addr2, mask) (((addr1)->addr & (mask)->addr) == ((addr2)->addr & (mask)->addr))
+#define ip_2_ip4(ipaddr)                  (ipaddr)
+
+extern const ip_addr_t ip_addr_any;
+extern const ip_addr_t ip_addr_broadcast;
+#define IP_ADDR_ANY           (&ip_addr_any)
+#define IP4_ADDR_ANY          (&ip_addr_any)
+#define IP4_ADDR_ANY4         (&ip_addr_any)
+
+/* pbuf ----------------------------------------------------------------------*/
+typedef enum {
+  PBUF_TRANSPORT = 74,
+  PBUF_IP = 54,
+  PBUF_LINK = 14,
+  PBUF_RAW_TX = 0,
+  PBUF_RAW = 0
+} pbuf_layer;
+
+typedef enum {
+  PBUF_RAM = 0x280,
+  PBUF_ROM = 0x01,
+  PBUF_REF = 0x41,
+  PBUF_POOL = 0x182
+} pbuf_type;
+
+#define PBUF_FLAG_PUSH        0x01U
+#define PBUF_FLAG_IS_CUSTOM   0x02U
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;
+  u16_t len;
+  u8_t type_internal;
+  u8_t flags;
+  u8_t ref;
+  u8_t if_idx;
+};
+
+typedef void (*pbuf_free_custom_fn)(struct pbuf *p);
+
+struct pbuf_custom {
+  struct pbuf pbuf;
+  pbuf_free_custom_fn custom_free_function;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+struct pbuf *pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type,
+                                 struct pbuf_custom *p, void *payload_mem, u16_t payload_mem_len);
+u8_t pbuf_free(struct pbuf *p);
+void pbuf_ref(struct pbuf *p);
+u16_t pbuf_clen(const struct pbuf *p);
+void pbuf_cat(struct pbuf *head, struct pbuf *tail);
+void pbuf_chain(struct pbuf *head, struct pbuf *tail);
+void pbuf_realloc(struct pbuf *p, u16_t size);
+u8_t pbuf_remove_header(struct pbuf *p, size_t header_size);
+u8_t pbuf_add_header(struct pbuf *p, size_t header_size);
+u8_t pbuf_header(struct pbuf *p, s16_t header_size);
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
+err_t pbuf_copy(struct pbuf *p_to, const struct pbuf *p_from);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len);
+err_t pbuf_take_at(struct pbuf *buf, const void *dataptr, u16_t len, u16_t offset);
+u8_t pbuf_get_at(const struct pbuf *p, u16_t offset);
+/* Host build: "pbuf" from pbuf_alloc() in use */
+u32_t host_pbuf_used(void);
+
+/* Memory ------------------------------------------------------------------- */
+/* Fixed size pool, in static memory as DMA sees 32-bit addresses only */
+typedef struct host_memp {
+  void *free;
+  u8_t *base;
+  u32_t size;
+  u32_t num;
+  u32_t used;
+} host_memp_t;
+
+#define LWIP_MEMPOOL_DECLARE(name, num, size, desc) \
+  static u8_t memp_memory_##name[(num) * LWIP_MEM_ALIGN_SIZE(size)] __attribute__((aligned(4))); \
+  static host_memp_t memp_##name = { NULL, memp_memory_##name, LWIP_MEM_ALIGN_SIZE(size), (num), 0 };
+#define LWIP_MEMPOOL_INIT(name)           host_memp_init(&memp_##name)
+#define LWIP_MEMPOOL_ALLOC(name)          host_memp_alloc(&memp_##name)
+#define LWIP_MEMPOOL_FREE(name, x)        host_memp_free(&memp_##name, (x))
+
+void host_memp_init(host_memp_t *pool);
+void *host_memp_alloc(host_memp_t *pool);
+void host_memp_free(host_memp_t *pool, void *mem);
+void *mem_malloc(size_t size);
+void mem_free(void *rmem);
+
+/* netif ---------------------------------------------------------------------*/
+struct netif;
+
+typedef enum {
+  NETIF_DEL_MAC_FILTER = 0,
+  NETIF_ADD_MAC_FILTER = 1
+} netif_mac_filter_action;
+
+typedef err_t (*netif_init_fn)(struct netif *netif);
+typedef err_t (*netif_input_fn)(struct pbuf *p, struct netif *inp);
+typedef err_t (*netif_output_fn)(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr);
+typedef err_t (*netif_linkoutput_fn)(struct netif *netif, struct pbuf *p);
+typedef void (*netif_status_callback_fn)(struct netif *netif);
+typedef err_t (*netif_igmp_mac_filter_fn)(struct netif *netif, const ip4_addr_t *group, netif_mac_filter_action action);
+
+#define NETIF_FLAG_UP         0x01U
+#define NETIF_FLAG_BROADCAST  0x02U
+#define NETIF_FLAG_LINK_UP    0x04U
+#define NETIF_FLAG_ETHARP     0x08U
+#define NETIF_FLAG_ETHERNET   0x10U
+#define NETIF_FLAG_IGMP       0x20U
+#define NETIF_FLAG_MLD6       0x40U
+
+#define LWIP_NETIF_CLIENT_DATA_INDEX_DHCP 0
+#define LWIP_NUM_NETIF_CLIENT_DATA        1
+
+struct netif {
+  struct netif *next;
+  ip_addr_t ip_addr;
+  ip_addr_t netmask;
+  ip_addr_t gw;
+  netif_input_fn input;
+  netif_output_fn output;
+  netif_linkoutput_fn linkoutput;
+  netif_status_callback_fn status_callback;
+  netif_status_callback_fn link_callback;
+  void *state;
+  void *client_data[LWIP_NUM_NETIF_CLIENT_DATA];
+  const char *hostname;
+  u16_t mtu;
+  u8_t hwaddr[6];
+  u8_t hwaddr_len;
+  u8_t flags;
+  char name[2];
+  u8_t num;
+  netif_igmp_mac_filter_fn igmp_mac_filter;
+};
+
+#define netif_is_up(netif)                (((netif)->flags & NETIF_FLAG_UP) ? (u8_t)1 : (u8_t)0)
+#define netif_is_link_up(netif)           (((netif)->flags & NETIF_FLAG_LINK_UP) ? (u8_t)1 : (u8_t)0)
+#define netif_set_igmp_mac_filter(netif, function) do { if ((netif) != NULL) { (netif)->igmp_mac_filter = function; } } while (0)
+#define netif_get_client_data(netif, id)  (netif)->client_data[(id)]
+#define netif_ip4_addr(netif)             ((const ip4_addr_t *)&((netif)->ip_addr))
+#define netif_ip4_netmask(netif)          ((const ip4_addr_t *)&((netif)->netmask))
+#define netif_ip4_gw(netif)               ((const ip4_addr_t *)&((netif)->gw))
+
+extern struct netif *netif_default;
+
+struct netif *netif_add(struct netif *netif, const ip4_addr_t *ipaddr, const ip4_addr_t *netmask,
+                        const ip4_addr_t *gw, void *state, netif_init_fn init, netif_input_fn input);
+void netif_set_default(struct netif *netif);
+void netif_set_up(struct netif *netif);
+void netif_set_down(struct netif *netif);
+void netif_set_link_up(struct netif *netif);
+void netif_set_link_down(struct netif *netif);
+void netif_set_status_callback(struct netif *netif, netif_status_callback_fn status_callback);
+void netif_set_link_callback(struct netif *netif, netif_status_callback_fn link_callback);
+
+/* tcpip_thread --------------------------------------------------------------*/
+typedef void (*tcpip_init_done_fn)(void *arg);
+typedef void (*tcpip_callback_fn)(void *ctx);
+struct tcpip_callback_msg;
+
+void tcpip_init(tcpip_init_done_fn tcpip_init_done, void *arg);
+err_t tcpip_input(struct pbuf *p, struct netif *inp);
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx);
+err_t tcpip_try_callback(tcpip_callback_fn function, void *ctx);
+struct tcpip_callback_msg *tcpip_callbackmsg_new(tcpip_callback_fn function, void *ctx);
+void tcpip_callbackmsg_delete(struct tcpip_callback_msg *msg);
+err_t tcpip_callbackmsg_trycallback(struct tcpip_callback_msg *msg);
+err_t tcpip_callbackmsg_trycallback_fromisr(struct tcpip_callback_msg *msg);
+
+/* Host build: tcpip_thread mailbox. Messages are run by host_tcpip_poll(),
+   called by the test in place of tcpip_thread. */
+u32_t host_tcpip_poll(u32_t max);
+/* Mailbox size, TCPIP_MBOX_SIZE by default */
+void host_tcpip_set_mbox_size(u32_t size);
+/* Frames from tcpip_input() are passed to this function in tcpip_thread, the
+   default one frees them */
+void host_tcpip_set_input(netif_input_fn input);
+u32_t host_tcpip_mbox_drop(void);
+
+/* sys -----------------------------------------------------------------------*/
+typedef void (*lwip_thread_fn)(void *arg);
+typedef struct host_thread *sys_thread_t;
+typedef struct host_sem *sys_sem_t;
+
+#define SYS_ARCH_TIMEOUT      0xffffffffUL
+
+u32_t sys_now(void);
+void sys_msleep(u32_t ms);
+sys_thread_t sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio);
+err_t sys_sem_new(sys_sem_t *sem, u8_t count);
+void sys_sem_signal(sys_sem_t *sem);
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout);
+void sys_sem_free(sys_sem_t *sem);
+
+typedef void (*sys_timeout_handler)(void *arg);
+void sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg);
+void sys_untimeout(sys_timeout_handler handler, void *arg);
+void sys_check_timeouts(void);
+
+/* Protocol headers ----------------------------------------------------------*/
+#define ETH_HWADDR_LEN        6
+#define SIZEOF_ETH_HDR        14
+#define SIZEOF_VLAN_HDR       4
+#define ETHTYPE_IP            0x0800U
+#define ETHTYPE_ARP           0x0806U
+#define ETHTYPE_VLAN          0x8100U
+#define ETHTYPE_IPV6          0x86DDU
+#define ETHTYPE_PTP           0x88F7U
+
+struct eth_addr {
+  u8_t addr[ETH_HWADDR_LEN];
+} __attribute__((packed));
+
+struct eth_hdr {
+  struct eth_addr dest;
+  struct eth_addr src;
+  u16_t type;
+} __attribute__((packed));
+
+struct eth_vlan_hdr {
+  u16_t prio_vid;
+  u16_t tpid;
+} __attribute__((packed));
+
+#define IP_HLEN               20
+#define IP_PROTO_ICMP         1
+#define IP_PROTO_IGMP         2
+#define IP_PROTO_UDP          17
+#define IP_PROTO_TCP          6
+#define IP_RF                 0x8000U
+#define IP_DF                 0x4000U
+#define IP_MF                 0x2000U
+#define IP_OFFMASK            0x1fffU
+
+struct ip_hdr {
+  u8_t _v_hl;
+  u8_t _tos;
+  u16_t _len;
+  u16_t _id;
+  u16_t _offset;
+  u8_t _ttl;
+  u8_t _proto;
+  u16_t _chksum;
+  ip4_addr_t src;
+  ip4_addr_t dest;
+} __attribute__((packed));
+
+#define IPH_V(hdr)            ((hdr)->_v_hl >> 4)
+#define IPH_HL(hdr)           ((hdr)->_v_hl & 0x0f)
+#define IPH_HL_BYTES(hdr)     ((u8_t)(IPH_HL(hdr) * 4))
+#define IPH_TOS(hdr)          ((hdr)->_tos)
+#define IPH_LEN(hdr)          ((hdr)->_len)
+#define IPH_ID(hdr)           ((hdr)->_id)
+#define IPH_OFFSET(hdr)       ((hdr)->_offset)
+#define IPH_TTL(hdr)          ((hdr)->_ttl)
+#define IPH_PROTO(hdr)        ((hdr)->_proto)
+#define IPH_CHKSUM(hdr)       ((hdr)->_chksum)
+#define IPH_LEN_SET(hdr, len) (hdr)->_len = (len)
+#define IPH_ID_SET(hdr, id)   (hdr)->_id = (id)
+#define IPH_CHKSUM_SET(hdr, chksum) (hdr)->_chksum = (chksum)
+
+#define TCP_HLEN              20
+#define TCP_FIN               0x01U
+#define TCP_SYN               0x02U
+#define TCP_RST               0x04U
+#define TCP_PSH               0x08U
+#define TCP_ACK               0x10U
+#define TCP_URG               0x20U
+
+struct tcp_hdr {
+  u16_t src;
+  u16_t dest;
+  u32_t seqno;
+  u32_t ackno;
+  u16_t _hdrlen_rsvd_flags;
+  u16_t wnd;
+  u16_t chksum;
+  u16_t urgp;
+} __attribute__((packed));
+
+#define TCPH_HDRLEN(phdr)       ((u16_t)(lwip_ntohs((phdr)->_hdrlen_rsvd_flags) >> 12))
+#define TCPH_HDRLEN_BYTES(phdr) ((u8_t)(TCPH_HDRLEN(phdr) << 2))
+#define TCPH_FLAGS(phdr)        ((u8_t)((lwip_ntohs((phdr)->_hdrlen_rsvd_flags) & 0x3fU)))
+#define TCPH_SET_FLAG(phdr, flags) (phdr)->_hdrlen_rsvd_flags = ((phdr)->_hdrlen_rsvd_flags | lwip_htons(flags))
+
+#define UDP_HLEN              8
+
+struct udp_hdr {
+  u16_t src;
+  u16_t dest;
+  u16_t len;
+  u16_t chksum;
+} __attribute__((packed));
+
+u16_t inet_chksum(const void *dataptr, u16_t len);
+
+/* Ethernet and ARP ----------------------------------------------------------*/
+err_t ethernet_input(struct pbuf *p, struct netif *netif);
+err_t etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr);
+err_t etharp_request(struct netif *netif, const ip4_addr_t *ipaddr);
+
+/* IGMP ----------------------------------------------------------------------*/
+void igmp_init(void);
+void igmp_start(struct netif *netif);
+
+/* DHCP ----------------------------------------------------------------------*/
+#define DHCP_COARSE_TIMER_MSECS 60000U
+#define DHCP_FINE_TIMER_MSECS   500U
+
+typedef enum {
+  DHCP_STATE_OFF             = 0,
+  DHCP_STATE_REQUESTING      = 1,
+  DHCP_STATE_INIT            = 2,
+  DHCP_STATE_REBOOTING       = 3,
+  DHCP_STATE_REBINDING       = 4,
+  DHCP_STATE_RENEWING        = 5,
+  DHCP_STATE_SELECTING       = 6,
+  DHCP_STATE_INFORMING       = 7,
+  DHCP_STATE_CHECKING        = 8,
+  DHCP_STATE_PERMANENT       = 9,
+  DHCP_STATE_BOUND           = 10,
+  DHCP_STATE_RELEASING       = 11,
+  DHCP_STATE_BACKING_OFF     = 12
+} dhcp_state_enum_t;
+
+struct dhcp {
+  u8_t state;
+  u8_t tries;
+  ip_addr_t server_ip_addr;
+};
+
+err_t dhcp_start(struct netif *netif);
+void dhcp_inform(struct netif *netif);
+void dhcp_release_and_stop(struct netif *netif);
+u8_t dhcp_supplied_address(const struct netif *netif);
+
+/* DNS -----------------------------------------------------------------------*/
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);
+const ip_addr_t *dns_getserver(u8_t numdns);
+
+/* UDP -----------------------------------------------------------------------*/
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+/* TCP -----------------------------------------------------------------------*/
+struct tcp_pcb;
+typedef err_t (*tcp_accept_fn)(void *arg, struct tcp_pcb *newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *tpcb);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *tpcb, err_t err);
+
+#define TCP_PRIO_MIN          1
+#define TCP_PRIO_NORMAL       64
+#define TCP_PRIO_MAX          127
+#define TCP_WRITE_FLAG_COPY   0x01U
+#define TCP_WRITE_FLAG_MORE   0x02U
+
+/* Host build: only the callbacks, data acknowledged and send buffer */
+struct tcp_pcb {
+  void *callback_arg;
+  tcp_accept_fn accept;
+  tcp_recv_fn recv;
+  tcp_sent_fn sent;
+  tcp_poll_fn poll;
+  tcp_err_fn errf;
+  u8_t prio;
+  u8_t pollinterval;
+  u16_t mss;
+  u16_t snd_buf;
+  u32_t recved;
+};
+
+#define tcp_mss(pcb)          ((pcb)->mss)
+#define tcp_sndbuf(pcb)       ((pcb)->snd_buf)
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept);
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio);
+void tcp_recved(struct tcp_pcb *pcb, u16_t len);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+err_t tcp_close(struct tcp_pcb *pcb);
+void tcp_abort(struct tcp_pcb *pcb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_LWIP_H__ */
@@ -0,0 +1,49 @@
+/***************************************************************************//**
+ * @file    log.h
+ * @brief   Host build: RT-Thread log macros
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * Messages are printed to stderr when "host_log_level" is at or above their
+ * level, it is 0 (nothing) by default.
+ ******************************************************************************/
+/* No include guard: LOG_TAG is defined per file before including this one */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#ifndef LOG_TAG
+#define LOG_TAG               "HOST"
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef HOST_LOG_ERROR
+#define HOST_LOG_ERROR        1
+#define HOST_LOG_WARNING      2
+#define HOST_LOG_INFO         3
+#define HOST_LOG_DEBUG        4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+extern int host_log_level;
+
+/* Exported functions ------------------------------------------------------- */
+void host_log(int level, const char *tag, const char *fmt, ...)
+  __attribute__((format(printf, 3, 4)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* HOST_LOG_ERROR */
+
+/* Exported macro ------------------------------------------------------------*/
+#undef LOG_E
+#undef LOG_W
+#undef LOG_I
+#undef LOG_D
+#define LOG_E(...)            host_log(HOST_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOG_W(...)            host_log(HOST_LOG_WARNING, LOG_TAG, __VA_ARGS__)
+#define LOG_I(...)            host_log(HOST_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOG_D(...)            host_log(HOST_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
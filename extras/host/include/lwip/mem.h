@@ -0,0 +1,2 @@
+/* Host build: see host_lwip.h */
+#include "host_lwip.h"
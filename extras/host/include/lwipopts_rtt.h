@@ -0,0 +1,23 @@
+/***************************************************************************//**
+ * @file    lwipopts_rtt.h
+ * @brief   Host build: LwIP options
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * The library defaults, then the build configuration passed with "-D".
+ ******************************************************************************/
+#ifndef __LWIPOPTS_RTT_H__
+#define __LWIPOPTS_RTT_H__
+
+#include "lwipopts_default.h"
+
+/* Benchmark counters and fault injection are what the host build is for */
+#ifndef ETH_BENCHMARK
+#define ETH_BENCHMARK 1
+#endif
+
+/* Polling mode (RX by ethernetif_input() from the caller) */
+#ifdef HOST_ETH_POLLING
+#undef ETH_INPUT_USE_IT
+#endif
+
+#endif /* __LWIPOPTS_RTT_H__ */
@@ -0,0 +1,59 @@
+/***************************************************************************//**
+ * @file    rtthread.h
+ * @brief   Host build: RT-Thread subset used by the driver
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#ifndef __HOST_RTTHREAD_H__
+#define __HOST_RTTHREAD_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define RT_TICK_PER_SECOND    1000
+#define RT_EOK                0
+#define RT_ERROR              1
+#define RT_ETIMEOUT           2
+#define RT_WAITING_FOREVER    -1
+#define RT_WAITING_NO         0
+#define RT_IPC_FLAG_FIFO      0x00
+#define RT_IPC_FLAG_PRIO      0x01
+#define RT_EVENT_FLAG_AND     0x01
+#define RT_EVENT_FLAG_OR      0x02
+#define RT_EVENT_FLAG_CLEAR   0x04
+
+/* Exported types ------------------------------------------------------------*/
+typedef int32_t   rt_int32_t;
+typedef uint32_t  rt_uint32_t;
+typedef uint8_t   rt_uint8_t;
+typedef uint32_t  rt_tick_t;
+typedef long      rt_err_t;
+
+/* Event set on a mutex and a condition variable */
+struct rt_event {
+  const char *name;
+  rt_uint32_t set;
+  void *impl;
+};
+typedef struct rt_event *rt_event_t;
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t rt_event_init(rt_event_t event, const char *name, rt_uint8_t flag);
+rt_err_t rt_event_send(rt_event_t event, rt_uint32_t set);
+rt_err_t rt_event_recv(rt_event_t event, rt_uint32_t set, rt_uint8_t option,
+                       rt_int32_t timeout, rt_uint32_t *recved);
+rt_tick_t rt_tick_get(void);
+rt_int32_t rt_tick_from_millisecond(rt_int32_t ms);
+rt_err_t rt_thread_delay(rt_tick_t tick);
+rt_err_t rt_thread_mdelay(rt_int32_t ms);
+int rt_kprintf(const char *fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_RTTHREAD_H__ */
@@ -0,0 +1,573 @@
+/***************************************************************************//**
+ * @file    stm32_def.h
+ * @brief   Host build: STM32 HAL subset for the ETH model
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#ifndef __STM32_DEF_H__
+#define __STM32_DEF_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "host_cycles.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define STM32_CORE_VERSION    0x01090000
+
+#define __IO                  volatile
+#define __ALIGN_BEGIN
+#define __ALIGN_END           __attribute__((aligned(4)))
+#define __weak                __attribute__((weak))
+#define UNUSED(x)             ((void)(x))
+#define RESET                 0U
+#define assert_param(expr)    ((void)0U)
+#define __DMB()               __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DSB()               __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* Clocks */
+#define __HAL_RCC_ETH_CLK_ENABLE()    do {} while (0)
+#define __HAL_RCC_SYSCFG_CLK_ENABLE() do {} while (0)
+#define GPIO_SPEED_FREQ_HIGH  2U
+
+/* Ethernet buffers (stm32f4xx_hal_conf.h) */
+#ifndef ETH_RXBUFNB
+#define ETH_RXBUFNB           4U
+#endif
+#ifndef ETH_TXBUFNB
+#define ETH_TXBUFNB           4U
+#endif
+#define ETH_MAX_PACKET_SIZE   1524U
+#define ETH_RX_BUF_SIZE       ETH_MAX_PACKET_SIZE
+#define ETH_TX_BUF_SIZE       ETH_MAX_PACKET_SIZE
+#define MAC_ADDR0             0x00U
+#define MAC_ADDR1             0x80U
+#define MAC_ADDR2             0xE1U
+#define MAC_ADDR3             0x00U
+#define MAC_ADDR4             0x00U
+#define MAC_ADDR5             0x00U
+
+/* PHY (stm32f4xx_hal_conf.h, LAN8742A) */
+#define LAN8742A_PHY_ADDRESS  0x00U
+#define PHY_RESET_DELAY       0x000000FFU
+#define PHY_CONFIG_DELAY      0x00000FFFU
+#define PHY_READ_TO           0x0000FFFFU
+#define PHY_WRITE_TO          0x0000FFFFU
+#define PHY_BCR               ((uint16_t)0x00U)
+#define PHY_BSR               ((uint16_t)0x01U)
+#define PHY_RESET             ((uint16_t)0x8000U)
+#define PHY_LOOPBACK          ((uint16_t)0x4000U)
+#define PHY_FULLDUPLEX_100M   ((uint16_t)0x2100U)
+#define PHY_HALFDUPLEX_100M   ((uint16_t)0x2000U)
+#define PHY_FULLDUPLEX_10M    ((uint16_t)0x0100U)
+#define PHY_HALFDUPLEX_10M    ((uint16_t)0x0000U)
+#define PHY_AUTONEGOTIATION   ((uint16_t)0x1000U)
+#define PHY_RESTART_AUTONEGOTIATION ((uint16_t)0x0200U)
+#define PHY_POWERDOWN         ((uint16_t)0x0800U)
+#define PHY_ISOLATE           ((uint16_t)0x0400U)
+#define PHY_AUTONEGO_COMPLETE ((uint16_t)0x0020U)
+#define PHY_LINKED_STATUS     ((uint16_t)0x0004U)
+#define PHY_JABBER_DETECTION  ((uint16_t)0x0002U)
+#define PHY_SR                ((uint16_t)0x1FU)
+#define PHY_SPEED_STATUS      ((uint16_t)0x0004U)
+#define PHY_DUPLEX_STATUS     ((uint16_t)0x0010U)
+#define PHY_ISFR              ((uint16_t)0x1DU)
+#define PHY_ISFR_INT4         ((uint16_t)0x0010U)
+#define PHY_IMR               ((uint16_t)0x1EU)
+
+/* ETH init */
+#define ETH_AUTONEGOTIATION_ENABLE    0x00000001U
+#define ETH_AUTONEGOTIATION_DISABLE   0x00000000U
+#define ETH_SPEED_10M                 0x00000000U
+#define ETH_SPEED_100M                0x00004000U
+#define ETH_MODE_FULLDUPLEX           0x00000800U
+#define ETH_MODE_HALFDUPLEX           0x00000000U
+#define ETH_RXPOLLING_MODE            0x00000000U
+#define ETH_RXINTERRUPT_MODE          0x00000001U
+#define ETH_CHECKSUM_BY_HARDWARE      0x00000000U
+#define ETH_CHECKSUM_BY_SOFTWARE      0x00000001U
+#define SYSCFG_PMC_MII_RMII_SEL       0x00800000U
+#define ETH_MEDIA_INTERFACE_MII       0x00000000U
+#define ETH_MEDIA_INTERFACE_RMII      SYSCFG_PMC_MII_RMII_SEL
+#define IS_ETH_SPEED(SPEED)           (((SPEED) == ETH_SPEED_10M) || ((SPEED) == ETH_SPEED_100M))
+#define IS_ETH_DUPLEX_MODE(MODE)      (((MODE) == ETH_MODE_FULLDUPLEX) || ((MODE) == ETH_MODE_HALFDUPLEX))
+
+/* MAC and DMA init, values not used by the model */
+#define ETH_WATCHDOG_ENABLE                       0x00000000U
+#define ETH_JABBER_ENABLE                         0x00000000U
+#define ETH_INTERFRAMEGAP_96BIT                   0x00000000U
+#define ETH_CARRIERSENCE_ENABLE                   0x00000000U
+#define ETH_RECEIVEOWN_ENABLE                     0x00000000U
+#define ETH_LOOPBACKMODE_DISABLE                  0x00000000U
+#define ETH_CHECKSUMOFFLAOD_ENABLE                0x00000400U
+#define ETH_CHECKSUMOFFLAOD_DISABLE               0x00000000U
+#define ETH_RETRYTRANSMISSION_DISABLE             0x00000200U
+#define ETH_AUTOMATICPADCRCSTRIP_DISABLE          0x00000000U
+#define ETH_BACKOFFLIMIT_10                       0x00000000U
+#define ETH_DEFFERRALCHECK_DISABLE                0x00000000U
+#define ETH_RECEIVEAll_DISABLE                    0x00000000U
+#define ETH_SOURCEADDRFILTER_DISABLE              0x00000000U
+#define ETH_PASSCONTROLFRAMES_BLOCKALL            0x00000040U
+#define ETH_BROADCASTFRAMESRECEPTION_ENABLE       0x00000000U
+#define ETH_DESTINATIONADDRFILTER_NORMAL          0x00000000U
+#define ETH_PROMISCUOUS_MODE_DISABLE              0x00000000U
+#define ETH_MULTICASTFRAMESFILTER_PERFECT         0x00000000U
+#define ETH_UNICASTFRAMESFILTER_PERFECT           0x00000000U
+#define ETH_ZEROQUANTAPAUSE_DISABLE               0x00000080U
+#define ETH_PAUSELOWTHRESHOLD_MINUS4              0x00000000U
+#define ETH_UNICASTPAUSEFRAMEDETECT_DISABLE       0x00000000U
+#define ETH_RECEIVEFLOWCONTROL_DISABLE            0x00000000U
+#define ETH_TRANSMITFLOWCONTROL_DISABLE           0x00000000U
+#define ETH_VLANTAGCOMPARISON_16BIT               0x00000000U
+#define ETH_DROPTCPIPCHECKSUMERRORFRAME_ENABLE    0x00000000U
+#define ETH_RECEIVESTOREFORWARD_ENABLE            0x02000000U
+#define ETH_FLUSHRECEIVEDFRAME_ENABLE             0x00000000U
+#define ETH_TRANSMITSTOREFORWARD_ENABLE           0x00200000U
+#define ETH_TRANSMITTHRESHOLDCONTROL_64BYTES      0x00000000U
+#define ETH_FORWARDERRORFRAMES_DISABLE            0x00000000U
+#define ETH_FORWARDUNDERSIZEDGOODFRAMES_DISABLE   0x00000000U
+#define ETH_RECEIVEDTHRESHOLDCONTROL_64BYTES      0x00000000U
+#define ETH_SECONDFRAMEOPERARTE_ENABLE            0x00000004U
+#define ETH_ADDRESSALIGNEDBEATS_ENABLE            0x02000000U
+#define ETH_FIXEDBURST_ENABLE                     0x00010000U
+#define ETH_RXDMABURSTLENGTH_32BEAT               0x00400000U
+#define ETH_TXDMABURSTLENGTH_32BEAT               0x00002000U
+#define ETH_DMAENHANCEDDESCRIPTOR_ENABLE          0x00000080U
+#define ETH_DMAARBITRATION_ROUNDROBIN_RXTX_1_1    0x00000000U
+
+/* MAC registers */
+#define ETH_MACCR_FES         0x00004000U
+#define ETH_MACCR_DM          0x00000800U
+#define ETH_MACCR_TE          0x00000008U
+#define ETH_MACCR_RE          0x00000004U
+#define ETH_MACFFR_RA         0x80000000U
+#define ETH_MACFFR_HPF        0x00000400U
+#define ETH_MACFFR_SAF        0x00000200U
+#define ETH_MACFFR_SAIF       0x00000100U
+#define ETH_MACFFR_PCF        0x000000C0U
+#define ETH_MACFFR_PCF_BlockAll                 0x00000040U
+#define ETH_MACFFR_PCF_ForwardAll               0x00000080U
+#define ETH_MACFFR_PCF_ForwardPassedAddrFilter  0x000000C0U
+#define ETH_MACFFR_BFD        0x00000020U
+#define ETH_MACFFR_PAM        0x00000010U
+#define ETH_MACFFR_DAIF       0x00000008U
+#define ETH_MACFFR_HM         0x00000004U
+#define ETH_MACFFR_HU         0x00000002U
+#define ETH_MACFFR_PM         0x00000001U
+#define ETH_MACMIIAR_PA       0x0000F800U
+#define ETH_MACMIIAR_MR       0x000007C0U
+#define ETH_MACMIIAR_CR       0x0000001CU
+#define ETH_MACMIIAR_CR_MASK  0xFFFFFFE3U
+#define ETH_MACMIIAR_CR_Div42   0x00000000U
+#define ETH_MACMIIAR_CR_Div62   0x00000004U
+#define ETH_MACMIIAR_CR_Div16   0x00000008U
+#define ETH_MACMIIAR_CR_Div26   0x0000000CU
+#define ETH_MACMIIAR_CR_Div102  0x00000010U
+#define ETH_MACMIIAR_MW       0x00000002U
+#define ETH_MACMIIAR_MB       0x00000001U
+#define ETH_MACVLANTR_VLANTC  0x00010000U
+#define ETH_MACVLANTR_VLANTI  0x0000FFFFU
+#define ETH_MACA1HR_AE        0x80000000U
+#define ETH_MACA1HR_SA        0x40000000U
+#define ETH_MACA1HR_MBC       0x3F000000U
+#define ETH_MACIMR_TSTIM      0x00000200U
+
+/* PTP registers */
+#define ETH_PTPTSCR_TSE       0x00000001U
+#define ETH_PTPTSCR_TSFCU     0x00000002U
+#define ETH_PTPTSCR_TSSTI     0x00000004U
+#define ETH_PTPTSCR_TSSTU     0x00000008U
+#define ETH_PTPTSCR_TSITE     0x00000010U
+#define ETH_PTPTSCR_TSARU     0x00000020U
+#define ETH_PTPTSCR_TSSARFE   0x00000100U
+#define ETH_PTPTSCR_TSSSR     0x00000200U
+#define ETH_PTPTSCR_TSPTPPSV2E  0x00000400U
+#define ETH_PTPTSCR_TSSPTPOEFE  0x00000800U
+#define ETH_PTPTSCR_TSSIPV4FE 0x00002000U
+#define ETH_PTPTSCR_TSSEME    0x00004000U
+#define ETH_PTPTSLUR_TSUPNS   0x80000000U
+
+/* DMA registers */
+#define ETH_DMABMR_SR         0x00000001U
+#define ETH_DMABMR_EDE        0x00000080U
+#define ETH_DMAOMR_SR         0x00000002U
+#define ETH_DMAOMR_ST         0x00002000U
+#define ETH_DMAOMR_FTF        0x00100000U
+#define ETH_DMARSWTR_RSWTC    0x000000FFU
+
+#define ETH_DMASR_TSTS        0x20000000U
+#define ETH_DMASR_NIS         0x00010000U
+#define ETH_DMASR_AIS         0x00008000U
+#define ETH_DMASR_ERS         0x00004000U
+#define ETH_DMASR_FBES        0x00002000U
+#define ETH_DMASR_ETS         0x00000400U
+#define ETH_DMASR_RWTS        0x00000200U
+#define ETH_DMASR_RPSS        0x00000100U
+#define ETH_DMASR_RBUS        0x00000080U
+#define ETH_DMASR_RS          0x00000040U
+#define ETH_DMASR_TUS         0x00000020U
+#define ETH_DMASR_ROS         0x00000010U
+#define ETH_DMASR_TJTS        0x00000008U
+#define ETH_DMASR_TBUS        0x00000004U
+#define ETH_DMASR_TPSS        0x00000002U
+#define ETH_DMASR_TS          0x00000001U
+
+#define ETH_DMAIER_NISE       0x00010000U
+#define ETH_DMAIER_AISE       0x00008000U
+#define ETH_DMAIER_RBUIE      0x00000080U
+#define ETH_DMAIER_RIE        0x00000040U
+#define ETH_DMAIER_TUIE       0x00000020U
+#define ETH_DMAIER_ROIE       0x00000010U
+#define ETH_DMAIER_TBUIE      0x00000004U
+#define ETH_DMAIER_TIE        0x00000001U
+
+#define ETH_DMA_FLAG_NIS      ETH_DMASR_NIS
+#define ETH_DMA_FLAG_AIS      ETH_DMASR_AIS
+#define ETH_DMA_FLAG_R        ETH_DMASR_RS
+#define ETH_DMA_FLAG_T        ETH_DMASR_TS
+#define ETH_DMA_IT_NIS        ETH_DMASR_NIS
+#define ETH_DMA_IT_AIS        ETH_DMASR_AIS
+#define ETH_DMA_IT_RBU        ETH_DMASR_RBUS
+#define ETH_DMA_IT_R          ETH_DMASR_RS
+#define ETH_DMA_IT_TU         ETH_DMASR_TUS
+#define ETH_DMA_IT_RO         ETH_DMASR_ROS
+#define ETH_DMA_IT_TBU        ETH_DMASR_TBUS
+#define ETH_DMA_IT_T          ETH_DMASR_TS
+
+/* DMA descriptors */
+#define ETH_DMATXDESC_OWN     0x80000000U
+#define ETH_DMATXDESC_IC      0x40000000U
+#define ETH_DMATXDESC_LS      0x20000000U
+#define ETH_DMATXDESC_FS      0x10000000U
+#define ETH_DMATXDESC_DC      0x08000000U
+#define ETH_DMATXDESC_DP      0x04000000U
+#define ETH_DMATXDESC_TTSE    0x02000000U
+#define ETH_DMATXDESC_CIC     0x00C00000U
+#define ETH_DMATXDESC_CIC_TCPUDPICMP_FULL 0x00C00000U
+#define ETH_DMATXDESC_TER     0x00200000U
+#define ETH_DMATXDESC_TCH     0x00100000U
+#define ETH_DMATXDESC_TTSS    0x00020000U
+#define ETH_DMATXDESC_ES      0x00008000U
+#define ETH_DMATXDESC_UF      0x00000002U
+#define ETH_DMATXDESC_TBS1    0x00001FFFU
+
+#define ETH_DMARXDESC_OWN     0x80000000U
+#define ETH_DMARXDESC_AFM     0x40000000U
+#define ETH_DMARXDESC_FL      0x3FFF0000U
+#define ETH_DMARXDESC_ES      0x00008000U
+#define ETH_DMARXDESC_VLAN    0x00000400U
+#define ETH_DMARXDESC_FS      0x00000200U
+#define ETH_DMARXDESC_LS      0x00000100U
+#define ETH_DMARXDESC_IPV4HCE 0x00000080U
+#define ETH_DMARXDESC_FRAMELENGTHSHIFT 16U
+#define ETH_DMARXDESC_DIC     0x80000000U
+#define ETH_DMARXDESC_RCH     0x00004000U
+#define ETH_DMARXDESC_RBS1    0x00001FFFU
+
+/* Exported macro ------------------------------------------------------------*/
+#define __HAL_LOCK(__HANDLE__)    do { (__HANDLE__)->Lock = HAL_LOCKED; } while (0)
+#define __HAL_UNLOCK(__HANDLE__)  do { (__HANDLE__)->Lock = HAL_UNLOCKED; } while (0)
+#define __HAL_ETH_DMA_ENABLE_IT(__HANDLE__, __INTERRUPT__)  ((__HANDLE__)->Instance->DMAIER |= (__INTERRUPT__))
+#define __HAL_ETH_DMA_DISABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DMAIER &= ~(__INTERRUPT__))
+#define __HAL_ETH_DMA_GET_FLAG(__HANDLE__, __FLAG__)        (((__HANDLE__)->Instance->DMASR & (__FLAG__)) == (__FLAG__))
+#define __HAL_ETH_DMA_CLEAR_IT(__HANDLE__, __INTERRUPT__)   ((__HANDLE__)->Instance->DMASR = (__INTERRUPT__))
+
+/* Exported types ------------------------------------------------------------*/
+#ifdef __cplusplus
+/* Register of the ETH model with side effects. Reads return the value,
+   writes go through eth_model_write(), so the model sees poll demands,
+   write-1-to-clear status bits and MDIO commands as the hardware does. Other
+   registers are plain memory. */
+class eth_reg {
+
+  public:
+    operator uint32_t() const
+    {
+      return __atomic_load_n(&value, __ATOMIC_RELAXED);
+    }
+
+    eth_reg &operator=(uint32_t v)
+    {
+      eth_model_write(this, v);
+      return *this;
+    }
+
+    eth_reg &operator|=(uint32_t v)
+    {
+      return *this = (uint32_t)*this | v;
+    }
+
+    eth_reg &operator&=(uint32_t v)
+    {
+      return *this = (uint32_t)*this & v;
+    }
+
+    eth_reg &operator=(const eth_reg &) = delete;
+
+    uint32_t value;
+
+  private:
+    static void eth_model_write(eth_reg *reg, uint32_t v);
+};
+
+/* DWT cycle counter backed by the host cycle counter */
+class dwt_cyccnt {
+
+  public:
+    operator uint32_t() const
+    {
+      return (uint32_t)host_cycles();
+    }
+};
+
+typedef struct {
+  __IO uint32_t MACCR;
+  __IO uint32_t MACFFR;
+  __IO uint32_t MACHTHR;
+  __IO uint32_t MACHTLR;
+  eth_reg MACMIIAR;
+  __IO uint32_t MACMIIDR;
+  __IO uint32_t MACFCR;
+  __IO uint32_t MACVLANTR;
+  uint32_t RESERVED0[2];
+  __IO uint32_t MACRWUFFR;
+  __IO uint32_t MACPMTCSR;
+  uint32_t RESERVED1;
+  __IO uint32_t MACDBGR;
+  __IO uint32_t MACSR;
+  __IO uint32_t MACIMR;
+  __IO uint32_t MACA0HR;
+  __IO uint32_t MACA0LR;
+  __IO uint32_t MACA1HR;
+  __IO uint32_t MACA1LR;
+  __IO uint32_t MACA2HR;
+  __IO uint32_t MACA2LR;
+  __IO uint32_t MACA3HR;
+  __IO uint32_t MACA3LR;
+  eth_reg PTPTSCR;
+  __IO uint32_t PTPSSIR;
+  __IO uint32_t PTPTSHR;
+  __IO uint32_t PTPTSLR;
+  __IO uint32_t PTPTSHUR;
+  __IO uint32_t PTPTSLUR;
+  __IO uint32_t PTPTSAR;
+  __IO uint32_t PTPTTHR;
+  __IO uint32_t PTPTTLR;
+  __IO uint32_t PTPTSSR;
+  eth_reg DMABMR;
+  eth_reg DMATPDR;
+  eth_reg DMARPDR;
+  eth_reg DMARDLAR;
+  eth_reg DMATDLAR;
+  eth_reg DMASR;
+  eth_reg DMAOMR;
+  eth_reg DMAIER;
+  __IO uint32_t DMAMFBOCR;
+  __IO uint32_t DMARSWTR;
+  __IO uint32_t DMACHTDR;
+  __IO uint32_t DMACHRDR;
+  __IO uint32_t DMACHTBAR;
+  __IO uint32_t DMACHRBAR;
+} ETH_TypeDef;
+
+typedef struct {
+  volatile uint32_t CTRL;
+  dwt_cyccnt CYCCNT;
+} DWT_Type;
+#endif /* __cplusplus */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+  HAL_UNLOCKED = 0x00U,
+  HAL_LOCKED   = 0x01U
+} HAL_LockTypeDef;
+
+typedef enum {
+  HAL_ETH_STATE_RESET       = 0x00U,
+  HAL_ETH_STATE_READY       = 0x01U,
+  HAL_ETH_STATE_BUSY        = 0x02U,
+  HAL_ETH_STATE_BUSY_TX     = 0x12U,
+  HAL_ETH_STATE_BUSY_RX     = 0x22U,
+  HAL_ETH_STATE_BUSY_TX_RX  = 0x32U,
+  HAL_ETH_STATE_BUSY_WR     = 0x42U,
+  HAL_ETH_STATE_BUSY_RD     = 0x82U,
+  HAL_ETH_STATE_TIMEOUT     = 0x03U,
+  HAL_ETH_STATE_ERROR       = 0x04U
+} HAL_ETH_StateTypeDef;
+
+typedef struct {
+  __IO uint32_t Status;
+  uint32_t ControlBufferSize;
+  uint32_t Buffer1Addr;
+  uint32_t Buffer2NextDescAddr;
+  uint32_t ExtendedStatus;
+  uint32_t Reserved1;
+  uint32_t TimeStampLow;
+  uint32_t TimeStampHigh;
+} ETH_DMADescTypeDef;
+
+typedef struct {
+  ETH_DMADescTypeDef *FSRxDesc;
+  ETH_DMADescTypeDef *LSRxDesc;
+  uint32_t SegCount;
+  uint32_t length;
+  uint32_t buffer;
+} ETH_DMARxFrameInfos;
+
+typedef struct {
+  uint32_t AutoNegotiation;
+  uint32_t Speed;
+  uint32_t DuplexMode;
+  uint16_t PhyAddress;
+  uint8_t *MACAddr;
+  uint32_t RxMode;
+  uint32_t ChecksumMode;
+  uint32_t MediaInterface;
+} ETH_InitTypeDef;
+
+typedef struct {
+  uint32_t Watchdog;
+  uint32_t Jabber;
+  uint32_t InterFrameGap;
+  uint32_t CarrierSense;
+  uint32_t ReceiveOwn;
+  uint32_t LoopbackMode;
+  uint32_t ChecksumOffload;
+  uint32_t RetryTransmission;
+  uint32_t AutomaticPadCRCStrip;
+  uint32_t BackOffLimit;
+  uint32_t DeferralCheck;
+  uint32_t ReceiveAll;
+  uint32_t SourceAddrFilter;
+  uint32_t PassControlFrames;
+  uint32_t BroadcastFramesReception;
+  uint32_t DestinationAddrFilter;
+  uint32_t PromiscuousMode;
+  uint32_t MulticastFramesFilter;
+  uint32_t UnicastFramesFilter;
+  uint32_t HashTableHigh;
+  uint32_t HashTableLow;
+  uint32_t PauseTime;
+  uint32_t ZeroQuantaPause;
+  uint32_t PauseLowThreshold;
+  uint32_t UnicastPauseFrameDetect;
+  uint32_t ReceiveFlowControl;
+  uint32_t TransmitFlowControl;
+  uint32_t VLANTagComparison;
+  uint32_t VLANTagIdentifier;
+} ETH_MACInitTypeDef;
+
+typedef struct {
+  uint32_t DropTCPIPChecksumErrorFrame;
+  uint32_t ReceiveStoreForward;
+  uint32_t FlushReceivedFrame;
+  uint32_t TransmitStoreForward;
+  uint32_t TransmitThresholdControl;
+  uint32_t ForwardErrorFrames;
+  uint32_t ForwardUndersizedGoodFrames;
+  uint32_t ReceiveThresholdControl;
+  uint32_t SecondFrameOperate;
+  uint32_t AddressAlignedBeats;
+  uint32_t FixedBurst;
+  uint32_t RxDMABurstLength;
+  uint32_t TxDMABurstLength;
+  uint32_t EnhancedDescriptorFormat;
+  uint32_t DescriptorSkipLength;
+  uint32_t DMAArbitration;
+} ETH_DMAInitTypeDef;
+
+#ifdef __cplusplus
+typedef struct {
+  ETH_TypeDef *Instance;
+  ETH_InitTypeDef Init;
+  uint32_t LinkStatus;
+  ETH_DMADescTypeDef *RxDesc;
+  ETH_DMADescTypeDef *TxDesc;
+  ETH_DMARxFrameInfos RxFrameInfos;
+  __IO HAL_ETH_StateTypeDef State;
+  HAL_LockTypeDef Lock;
+} ETH_HandleTypeDef;
+#endif
+
+typedef struct {
+  volatile uint32_t MEMRMP;
+  volatile uint32_t PMC;
+} SYSCFG_TypeDef;
+
+typedef struct {
+  volatile uint32_t DEMCR;
+} CoreDebug_Type;
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24U)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0U)
+
+typedef struct {
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef struct {
+  volatile uint32_t MODER;
+} GPIO_TypeDef;
+
+typedef enum {
+  EXTI15_10_IRQn  = 40,
+  ETH_IRQn        = 61,
+} IRQn_Type;
+
+/* Exported variables --------------------------------------------------------*/
+extern uint32_t SystemCoreClock;
+extern SYSCFG_TypeDef eth_model_syscfg;
+extern CoreDebug_Type eth_model_coredebug;
+#define SYSCFG                (&eth_model_syscfg)
+#define CoreDebug             (&eth_model_coredebug)
+#ifdef __cplusplus
+extern ETH_TypeDef eth_model_regs;
+extern DWT_Type eth_model_dwt;
+#define ETH                   (&eth_model_regs)
+#define DWT                   (&eth_model_dwt)
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init);
+void HAL_NVIC_SetPriority(IRQn_Type irqn, uint32_t preempt, uint32_t sub);
+void HAL_NVIC_EnableIRQ(IRQn_Type irqn);
+
+#ifdef __cplusplus
+HAL_StatusTypeDef HAL_ETH_Init(ETH_HandleTypeDef *heth);
+void HAL_ETH_MspInit(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef HAL_ETH_DMATxDescListInit(ETH_HandleTypeDef *heth, ETH_DMADescTypeDef *DMATxDescTab, uint8_t *TxBuff, uint32_t TxBuffCount);
+HAL_StatusTypeDef HAL_ETH_DMARxDescListInit(ETH_HandleTypeDef *heth, ETH_DMADescTypeDef *DMARxDescTab, uint8_t *RxBuff, uint32_t RxBuffCount);
+HAL_StatusTypeDef HAL_ETH_GetReceivedFrame_IT(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef HAL_ETH_ReadPHYRegister(ETH_HandleTypeDef *heth, uint16_t PHYReg, uint32_t *RegValue);
+HAL_StatusTypeDef HAL_ETH_WritePHYRegister(ETH_HandleTypeDef *heth, uint16_t PHYReg, uint32_t RegValue);
+HAL_StatusTypeDef HAL_ETH_Start(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef HAL_ETH_Stop(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef HAL_ETH_ConfigMAC(ETH_HandleTypeDef *heth, ETH_MACInitTypeDef *macconf);
+HAL_StatusTypeDef HAL_ETH_ConfigDMA(ETH_HandleTypeDef *heth, ETH_DMAInitTypeDef *dmaconf);
+void HAL_ETH_IRQHandler(ETH_HandleTypeDef *heth);
+void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth);
+void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth);
+void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *heth);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32_DEF_H__ */
@@ -0,0 +1,1045 @@
+/***************************************************************************//**
+ * @file    eth_model.cpp
+ * @brief   Host build: STM32F4 ETH MAC, DMA and PHY model
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "eth_model.h"
+#include "PeripheralPins.h"
+
+/* Private define ------------------------------------------------------------*/
+/* DMASR status bits, cleared by writing 1 */
+#define DMASR_W1C             0x0001E7FFU
+/* Sources of normal and abnormal interrupt summary */
+#define DMASR_NORMAL          (ETH_DMASR_TS | ETH_DMASR_TBUS | ETH_DMASR_RS | ETH_DMASR_ERS)
+#define DMASR_ABNORMAL        (ETH_DMASR_TPSS | ETH_DMASR_TJTS | ETH_DMASR_ROS | ETH_DMASR_TUS | \
+                               ETH_DMASR_RBUS | ETH_DMASR_RPSS | ETH_DMASR_RWTS | ETH_DMASR_ETS | \
+                               ETH_DMASR_FBES)
+/* Update bits of PTPTSCR, done at once */
+#define PTPTSCR_UPDATE        (ETH_PTPTSCR_TSSTI | ETH_PTPTSCR_TSSTU | ETH_PTPTSCR_TSARU)
+/* Interrupt handler calls before giving up on a source never cleared */
+#define IRQ_STORM             64U
+/* Preamble, SFD, FCS and inter frame gap */
+#define WIRE_OVERHEAD         (8U + 4U + 12U)
+#define WIRE_MIN_FRAME        60U
+#define MAX_FRAME             1536U
+#define RX_FIFO_SLOTS         8U
+
+/* PHY registers and bits */
+#define PHY_IDR1              2U
+#define PHY_IDR2              3U
+#define PHY_BSR_DEFAULT       0x7809U   /* 10/100 half/full, AN able, extended */
+#define PHY_BCR_DEFAULT       (PHY_AUTONEGOTIATION | PHY_FULLDUPLEX_100M)
+
+#define LAN8742A_ISFR         29U
+#define LAN8742A_IMR          30U
+#define LAN8742A_SR           31U
+#define LAN8742A_INT4         0x0010U
+#define LAN8742A_INT6         0x0040U
+#define LAN8742A_SR_AUTODONE  0x1000U
+#define LAN8742A_SR_10M       0x0004U
+#define LAN8742A_SR_100M      0x0008U
+#define LAN8742A_SR_FULL      0x0010U
+
+#define DP83848_PHYSTS        0x10U
+#define DP83848_MICR          0x11U
+#define DP83848_MISR          0x12U
+#define DP83848_PHYSTS_LINK   0x0001U
+#define DP83848_PHYSTS_10M    0x0002U
+#define DP83848_PHYSTS_FULL   0x0004U
+#define DP83848_PHYSTS_ANDONE 0x0010U
+#define DP83848_MISR_ANC      0x0800U
+#define DP83848_MISR_LINK     0x2000U
+
+#define KSZ8081_ICSR          0x1BU
+#define KSZ8081_PC1           0x1EU
+#define KSZ8081_ICSR_UP       0x0001U
+#define KSZ8081_ICSR_DOWN     0x0004U
+#define KSZ8081_PC1_100M      0x0002U
+#define KSZ8081_PC1_FULL      0x0004U
+#define KSZ8081_PC1_10M       0x0001U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum {
+  DMA_STOPPED = 0,
+  DMA_RUNNING,
+  DMA_SUSPENDED,
+} dma_state_t;
+
+typedef struct {
+  uint16_t len;
+  uint8_t data[MAX_FRAME];
+} rx_slot_t;
+
+typedef struct {
+  uint32_t kind;
+  uint8_t link;
+  uint8_t an_done;
+  uint8_t speed_100m;
+  uint8_t full_duplex;
+  uint16_t bcr;
+  uint16_t irq_flags;           /* Vendor interrupt flags, cleared on read */
+  uint16_t irq_mask;            /* Vendor interrupt enables */
+  uint16_t micr;
+} phy_model_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t phy_ids[] = {
+  0x0007C130UL,                 /* LAN8742A */
+  0x20005C90UL,                 /* DP83848 */
+  0x00221560UL,                 /* KSZ8081 */
+  0x01234560UL,                 /* Unknown */
+};
+
+static uint64_t now_ns;
+static uint8_t line_rate;
+static uint64_t tx_free_ns;
+static uint32_t faults;
+static eth_model_sink_t tx_sink;
+static void *tx_sink_arg;
+static eth_model_stats_t stats;
+
+static dma_state_t rx_state;
+static dma_state_t tx_state;
+static uint32_t rx_desc;        /* Current descriptor addresses */
+static uint32_t tx_desc;
+
+static rx_slot_t rx_fifo[RX_FIFO_SLOTS];
+static uint32_t rx_fifo_head;
+static uint32_t rx_fifo_count;
+static uint32_t rx_fifo_bytes;
+
+static uint8_t rwt_running;     /* Receive watchdog */
+static uint64_t rwt_expire_ns;
+
+static uint8_t irq_held;
+static uint8_t irq_active;
+
+static uint8_t mdio_busy;
+static uint64_t mdio_done_ns;
+static uint32_t mdio_count;
+
+static uint8_t rx_recovering;
+static uint64_t rx_recover_cycles;
+static uint64_t rx_recover_ns;
+static uint8_t tx_recovering;
+static uint64_t tx_recover_cycles;
+static uint64_t tx_recover_ns;
+
+static phy_model_t phy;
+static uint8_t tx_buf[MAX_FRAME * 2];
+
+/* Exported variables --------------------------------------------------------*/
+ETH_TypeDef eth_model_regs;
+DWT_Type eth_model_dwt;
+SYSCFG_TypeDef eth_model_syscfg;
+CoreDebug_Type eth_model_coredebug;
+uint32_t SystemCoreClock = 168000000U;
+extern "C" const PinMap PinMap_Ethernet[] = {
+  {NC, NULL, 0},
+};
+
+extern "C" void ETH_IRQHandler(void) __attribute__((weak));
+
+/* Private functions ---------------------------------------------------------*/
+static ETH_DMADescTypeDef *desc_ptr(uint32_t addr) {
+  return (ETH_DMADescTypeDef *)(uintptr_t)addr;
+}
+
+static void addr_check(const void *ptr, const char *what) {
+  if ((uintptr_t)ptr > 0xFFFFFFFFUL) {
+    fprintf(stderr, "eth_model: %s at %p is beyond 32-bit DMA address space (link with -no-pie)\n",
+      what, ptr);
+    abort();
+  }
+}
+
+static void irq_update(void) {
+  uint32_t loops = 0;
+  uint32_t sr;
+  uint32_t ier;
+
+  while (1) {
+    sr = eth_model_regs.DMASR.value;
+    ier = eth_model_regs.DMAIER.value;
+    /* Summary bits are latched while an enabled source is set */
+    if (sr & ier & DMASR_NORMAL) {
+      sr |= ETH_DMASR_NIS;
+    }
+    if (sr & ier & DMASR_ABNORMAL) {
+      sr |= ETH_DMASR_AIS;
+    }
+    eth_model_regs.DMASR.value = sr;
+
+    if (!(((sr & ETH_DMASR_NIS) && (ier & ETH_DMAIER_NISE)) ||
+          ((sr & ETH_DMASR_AIS) && (ier & ETH_DMAIER_AISE)))) {
+      return;
+    }
+    /* Line asserted: taken once unmasked and not in the handler already */
+    if (irq_held || irq_active || (ETH_IRQHandler == NULL)) {
+      return;
+    }
+    if (loops++ >= IRQ_STORM) {
+      stats.irq_storm++;
+      return;
+    }
+    irq_active = 1;
+    stats.irq++;
+    ETH_IRQHandler();
+    irq_active = 0;
+  }
+}
+
+static void rx_recover_done(void) {
+  uint64_t cycles;
+
+  if (!rx_recovering) {
+    return;
+  }
+  rx_recovering = 0;
+  cycles = host_cycles() - rx_recover_cycles;
+  stats.rx_recover_cnt++;
+  stats.rx_recover_cycles += cycles;
+  stats.rx_recover_ns += now_ns - rx_recover_ns;
+  if (cycles > stats.rx_recover_max) {
+    stats.rx_recover_max = cycles;
+  }
+}
+
+static void tx_recover_done(void) {
+  uint64_t cycles;
+
+  if (!tx_recovering) {
+    return;
+  }
+  tx_recovering = 0;
+  cycles = host_cycles() - tx_recover_cycles;
+  stats.tx_recover_cnt++;
+  stats.tx_recover_cycles += cycles;
+  stats.tx_recover_ns += now_ns - tx_recover_ns;
+  if (cycles > stats.tx_recover_max) {
+    stats.tx_recover_max = cycles;
+  }
+}
+
+/* Fetch the current RX descriptor, suspend if not owned by DMA */
+static uint8_t rx_fetch(void) {
+  if (rx_state != DMA_RUNNING) {
+    return 0;
+  }
+  if (desc_ptr(rx_desc)->Status & ETH_DMARXDESC_OWN) {
+    return 1;
+  }
+  rx_state = DMA_SUSPENDED;
+  eth_model_regs.DMASR.value |= ETH_DMASR_RBUS;
+  stats.rx_rbus++;
+  if (!rx_recovering) {
+    rx_recovering = 1;
+    rx_recover_cycles = host_cycles();
+    rx_recover_ns = now_ns;
+  }
+  return 0;
+}
+
+/* Write a frame to RX descriptors, from the current one */
+static void rx_write(const uint8_t *frame, uint16_t len) {
+  ETH_DMADescTypeDef *desc;
+  ETH_DMADescTypeDef *first = desc_ptr(rx_desc);
+  uint32_t size;
+  uint32_t offset = 0;
+  uint8_t ioc = 1;
+
+  while (1) {
+    desc = desc_ptr(rx_desc);
+    size = desc->ControlBufferSize & ETH_DMARXDESC_RBS1;
+    if (size > (uint32_t)(len - offset)) {
+      size = len - offset;
+    }
+    memcpy(desc_ptr(desc->Buffer1Addr), frame + offset, size);
+    offset += size;
+    if (desc->ControlBufferSize & ETH_DMARXDESC_DIC) {
+      ioc = 0;
+    }
+    rx_desc = desc->Buffer2NextDescAddr;
+    if (offset >= len) {
+      desc->TimeStampLow = (uint32_t)(now_ns % 1000000000ULL);
+      desc->TimeStampHigh = (uint32_t)(now_ns / 1000000000ULL);
+      desc->Status = ETH_DMARXDESC_LS | (((uint32_t)len + 4U) << ETH_DMARXDESC_FRAMELENGTHSHIFT) |
+                     ((desc == first) ? ETH_DMARXDESC_FS : 0);
+      break;
+    }
+    desc->Status = (desc == first) ? ETH_DMARXDESC_FS : 0;
+    if (!(desc_ptr(rx_desc)->Status & ETH_DMARXDESC_OWN)) {
+      /* Out of descriptors in the middle of frame: truncated */
+      desc->Status |= ETH_DMARXDESC_LS | ETH_DMARXDESC_ES |
+                      ((offset + 4U) << ETH_DMARXDESC_FRAMELENGTHSHIFT);
+      break;
+    }
+  }
+  stats.rx_frames++;
+  stats.rx_bytes += len;
+
+  if (ioc) {
+    eth_model_regs.DMASR.value |= ETH_DMASR_RS;
+    rwt_running = 0;
+  } else if ((eth_model_regs.DMARSWTR & ETH_DMARSWTR_RSWTC) && !rwt_running) {
+    /* Receive watchdog counts in unit of 256 HCLK cycles */
+    rwt_running = 1;
+    rwt_expire_ns = now_ns + (uint64_t)(eth_model_regs.DMARSWTR & ETH_DMARSWTR_RSWTC) * 256U *
+                    1000000000ULL / SystemCoreClock;
+  }
+}
+
+/* Move frames from MAC RX FIFO to RX descriptors */
+static void rx_drain(void) {
+  rx_slot_t *slot;
+
+  while (rx_fifo_count && rx_fetch()) {
+    slot = &rx_fifo[rx_fifo_head];
+    rx_write(slot->data, slot->len);
+    rx_fifo_head = (rx_fifo_head + 1) % RX_FIFO_SLOTS;
+    rx_fifo_count--;
+    rx_fifo_bytes -= slot->len;
+  }
+  /* Fetch the next descriptor at once, as the hardware does */
+  (void)rx_fetch();
+}
+
+/* Fetch the current TX descriptor, suspend if not owned by DMA */
+static uint8_t tx_fetch(void) {
+  if (tx_state != DMA_RUNNING) {
+    return 0;
+  }
+  if (desc_ptr(tx_desc)->Status & ETH_DMATXDESC_OWN) {
+    return 1;
+  }
+  tx_state = DMA_SUSPENDED;
+  eth_model_regs.DMASR.value |= ETH_DMASR_TBUS;
+  stats.tx_tbus++;
+  return 0;
+}
+
+/* Send the frame of the current TX descriptors */
+static void tx_send(void) {
+  ETH_DMADescTypeDef *desc;
+  uint32_t len = 0;
+  uint32_t size;
+  uint32_t ic = 0;
+  uint32_t bits;
+  uint8_t underflow = (faults & ETH_MODEL_FAULT_TUS) != 0;
+
+  faults &= ~ETH_MODEL_FAULT_TUS;
+  while (1) {
+    desc = desc_ptr(tx_desc);
+    size = desc->ControlBufferSize & ETH_DMATXDESC_TBS1;
+    if ((len + size) <= sizeof(tx_buf)) {
+      memcpy(tx_buf + len, desc_ptr(desc->Buffer1Addr), size);
+      len += size;
+    }
+    ic = desc->Status & ETH_DMATXDESC_IC;
+    tx_desc = desc->Buffer2NextDescAddr;
+    if ((desc->Status & ETH_DMATXDESC_LS) || underflow ||
+        !(desc_ptr(tx_desc)->Status & ETH_DMATXDESC_OWN)) {
+      break;
+    }
+    desc->Status &= ~ETH_DMATXDESC_OWN;
+  }
+
+  if (underflow) {
+    /* The frame is lost, and TX DMA suspended */
+    desc->Status |= ETH_DMATXDESC_ES | ETH_DMATXDESC_UF;
+    desc->Status &= ~ETH_DMATXDESC_OWN;
+    /* Skip the rest of the frame */
+    while (!(desc->Status & ETH_DMATXDESC_LS) && (desc_ptr(tx_desc)->Status & ETH_DMATXDESC_OWN)) {
+      desc = desc_ptr(tx_desc);
+      tx_desc = desc->Buffer2NextDescAddr;
+      desc->Status &= ~ETH_DMATXDESC_OWN;
+    }
+    tx_state = DMA_SUSPENDED;
+    eth_model_regs.DMASR.value |= ETH_DMASR_TUS;
+    stats.tx_tus++;
+    stats.tx_err++;
+    tx_recovering = 1;
+    tx_recover_cycles = host_cycles();
+    tx_recover_ns = now_ns;
+    return;
+  }
+
+  if (desc->Status & ETH_DMATXDESC_TTSE) {
+    desc->TimeStampLow = (uint32_t)(now_ns % 1000000000ULL);
+    desc->TimeStampHigh = (uint32_t)(now_ns / 1000000000ULL);
+    desc->Status |= ETH_DMATXDESC_TTSS;
+  }
+  desc->Status &= ~ETH_DMATXDESC_OWN;
+  if (ic) {
+    eth_model_regs.DMASR.value |= ETH_DMASR_TS;
+  }
+  stats.tx_frames++;
+  stats.tx_bytes += len;
+
+  if (line_rate) {
+    bits = ((len < WIRE_MIN_FRAME) ? WIRE_MIN_FRAME : len) + WIRE_OVERHEAD;
+    bits *= 8U;
+    if (tx_free_ns < now_ns) {
+      tx_free_ns = now_ns;
+    }
+    tx_free_ns += (eth_model_regs.MACCR & ETH_MACCR_FES) ? (bits * 10U) : (bits * 100U);
+  }
+  if (tx_sink != NULL) {
+    tx_sink(tx_buf, (uint16_t)len, tx_sink_arg);
+  }
+}
+
+static void tx_run(uint64_t until) {
+  while (tx_fetch()) {
+    if (line_rate && (tx_free_ns > until)) {
+      break;
+    }
+    tx_send();
+  }
+}
+
+static void dma_reset(void) {
+  memset((void *)&eth_model_regs, 0, sizeof(eth_model_regs));
+  /* Reset value, with the software reset (SR) already done */
+  eth_model_regs.DMABMR.value = 0x00002100U;
+  eth_model_regs.MACCR = 0x00008000U;
+  eth_model_regs.MACA0HR = 0x8000FFFFU;
+  eth_model_regs.MACA0LR = 0xFFFFFFFFU;
+  rx_state = DMA_STOPPED;
+  tx_state = DMA_STOPPED;
+  rx_desc = 0;
+  tx_desc = 0;
+  rx_fifo_head = rx_fifo_count = rx_fifo_bytes = 0;
+  rwt_running = 0;
+  mdio_busy = 0;
+  rx_recovering = 0;
+  tx_recovering = 0;
+}
+
+static uint16_t phy_read(uint16_t reg, uint8_t side_effect) {
+  uint16_t value = 0;
+
+  switch (reg) {
+    case PHY_BCR:
+      return phy.bcr;
+    case PHY_BSR:
+      return PHY_BSR_DEFAULT | (phy.link ? PHY_LINKED_STATUS : 0) |
+             ((phy.link && phy.an_done) ? PHY_AUTONEGO_COMPLETE : 0);
+    case PHY_IDR1:
+      return (uint16_t)(phy_ids[phy.kind] >> 16);
+    case PHY_IDR2:
+      /* Revision 1 */
+      return (uint16_t)(phy_ids[phy.kind] & 0xFFFFU) | 0x1U;
+    default:
+      break;
+  }
+
+  switch (phy.kind) {
+    case ETH_MODEL_PHY_LAN8742A:
+      if (reg == LAN8742A_ISFR) {
+        value = phy.irq_flags;
+        if (side_effect) {
+          phy.irq_flags = 0;
+        }
+      } else if (reg == LAN8742A_IMR) {
+        value = phy.irq_mask;
+      } else if (reg == LAN8742A_SR) {
+        if (phy.link && phy.an_done) {
+          value = LAN8742A_SR_AUTODONE | (phy.speed_100m ? LAN8742A_SR_100M : LAN8742A_SR_10M) |
+                  (phy.full_duplex ? LAN8742A_SR_FULL : 0);
+        }
+      }
+      break;
+
+    case ETH_MODEL_PHY_DP83848:
+      if (reg == DP83848_PHYSTS) {
+        if (phy.link) {
+          value = DP83848_PHYSTS_LINK;
+          if (phy.an_done) {
+            value |= DP83848_PHYSTS_ANDONE | (phy.speed_100m ? 0 : DP83848_PHYSTS_10M) |
+                     (phy.full_duplex ? DP83848_PHYSTS_FULL : 0);
+          }
+        }
+      } else if (reg == DP83848_MICR) {
+        value = phy.micr;
+      } else if (reg == DP83848_MISR) {
+        value = phy.irq_flags | phy.irq_mask;
+        if (side_effect) {
+          phy.irq_flags = 0;
+        }
+      }
+      break;
+
+    case ETH_MODEL_PHY_KSZ8081:
+      if (reg == KSZ8081_ICSR) {
+        value = phy.irq_flags | phy.irq_mask;
+        if (side_effect) {
+          phy.irq_flags = 0;
+        }
+      } else if (reg == KSZ8081_PC1) {
+        if (phy.link && phy.an_done) {
+          value = (phy.speed_100m ? KSZ8081_PC1_100M : KSZ8081_PC1_10M) |
+                  (phy.full_duplex ? KSZ8081_PC1_FULL : 0);
+        }
+      }
+      break;
+
+    default:
+      break;
+  }
+  return value;
+}
+
+static void phy_write(uint16_t reg, uint16_t value) {
+  if (reg == PHY_BCR) {
+    if (value & PHY_RESET) {
+      /* Reset done at once, auto-negotiation restarts with the link */
+      phy.bcr = PHY_BCR_DEFAULT;
+      phy.irq_flags = 0;
+      phy.irq_mask = 0;
+      phy.micr = 0;
+      return;
+    }
+    phy.bcr = value;
+    return;
+  }
+
+  switch (phy.kind) {
+    case ETH_MODEL_PHY_LAN8742A:
+      if (reg == LAN8742A_IMR) {
+        phy.irq_mask = value;
+      }
+      break;
+    case ETH_MODEL_PHY_DP83848:
+      if (reg == DP83848_MICR) {
+        phy.micr = value;
+      } else if (reg == DP83848_MISR) {
+        phy.irq_mask = value & 0x00FFU;
+      }
+      break;
+    case ETH_MODEL_PHY_KSZ8081:
+      if (reg == KSZ8081_ICSR) {
+        phy.irq_mask = value & 0xFF00U;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void mdio_complete(void) {
+  uint32_t miiar = eth_model_regs.MACMIIAR.value;
+  uint16_t reg = (uint16_t)((miiar & ETH_MACMIIAR_MR) >> 6U);
+
+  if (miiar & ETH_MACMIIAR_MW) {
+    phy_write(reg, (uint16_t)eth_model_regs.MACMIIDR);
+  } else {
+    eth_model_regs.MACMIIDR = phy_read(reg, 1);
+  }
+  eth_model_regs.MACMIIAR.value = miiar & ~ETH_MACMIIAR_MB;
+  mdio_busy = 0;
+}
+
+/* Register write with the side effects of the hardware */
+void eth_reg::eth_model_write(eth_reg *reg, uint32_t v) {
+  ETH_TypeDef *regs = &eth_model_regs;
+  uint32_t old = reg->value;
+
+  if (reg == &regs->DMASR) {
+    reg->value = old & ~(v & DMASR_W1C);
+    irq_update();
+
+  } else if (reg == &regs->DMAIER) {
+    reg->value = v;
+    irq_update();
+
+  } else if (reg == &regs->DMARPDR) {
+    if (rx_state == DMA_SUSPENDED) {
+      rx_state = DMA_RUNNING;
+      if (desc_ptr(rx_desc)->Status & ETH_DMARXDESC_OWN) {
+        rx_recover_done();
+      }
+      rx_drain();
+      irq_update();
+    }
+
+  } else if (reg == &regs->DMATPDR) {
+    if (tx_state == DMA_SUSPENDED) {
+      tx_state = DMA_RUNNING;
+      tx_recover_done();
+      (void)tx_fetch();
+      irq_update();
+    }
+
+  } else if (reg == &regs->DMARDLAR) {
+    reg->value = v;
+    if (rx_state == DMA_STOPPED) {
+      rx_desc = v;
+    }
+
+  } else if (reg == &regs->DMATDLAR) {
+    reg->value = v;
+    if (tx_state == DMA_STOPPED) {
+      tx_desc = v;
+    }
+
+  } else if (reg == &regs->DMAOMR) {
+    reg->value = v & ~ETH_DMAOMR_FTF;
+    if ((v & ETH_DMAOMR_ST) && (tx_state == DMA_STOPPED)) {
+      tx_state = DMA_RUNNING;
+      (void)tx_fetch();
+    } else if (!(v & ETH_DMAOMR_ST)) {
+      tx_state = DMA_STOPPED;
+    }
+    if ((v & ETH_DMAOMR_SR) && (rx_state == DMA_STOPPED)) {
+      rx_state = DMA_RUNNING;
+      rx_drain();
+    } else if (!(v & ETH_DMAOMR_SR)) {
+      rx_state = DMA_STOPPED;
+    }
+    irq_update();
+
+  } else if (reg == &regs->DMABMR) {
+    if (v & ETH_DMABMR_SR) {
+      dma_reset();
+      if (faults & ETH_MODEL_FAULT_RESET) {
+        /* No clock from PHY: reset never done */
+        regs->DMABMR.value |= ETH_DMABMR_SR;
+      }
+      return;
+    }
+    reg->value = v;
+
+  } else if (reg == &regs->MACMIIAR) {
+    reg->value = v;
+    if (v & ETH_MACMIIAR_MB) {
+      mdio_busy = 1;
+      mdio_done_ns = now_ns + ETH_MODEL_MDIO_NS;
+      mdio_count++;
+    }
+
+  } else if (reg == &regs->PTPTSCR) {
+    reg->value = v & ~PTPTSCR_UPDATE;
+
+  } else {
+    reg->value = v;
+  }
+}
+
+/* Exported functions ------------------------------------------------------- */
+void eth_model_reset(void) {
+  dma_reset();
+  memset(&eth_model_syscfg, 0, sizeof(eth_model_syscfg));
+  memset(&eth_model_coredebug, 0, sizeof(eth_model_coredebug));
+  eth_model_dwt.CTRL = 0;
+  memset(&stats, 0, sizeof(stats));
+  now_ns = 0;
+  tx_free_ns = 0;
+  faults = 0;
+  irq_held = 0;
+  irq_active = 0;
+  mdio_count = 0;
+  eth_model_phy_config(ETH_MODEL_PHY_LAN8742A, 1, 1, 1, 1);
+}
+
+void eth_model_step(uint64_t ns) {
+  uint64_t until = now_ns + ns;
+
+  if (mdio_busy && (mdio_done_ns <= until)) {
+    mdio_complete();
+  }
+  if (rwt_running && (rwt_expire_ns <= until)) {
+    rwt_running = 0;
+    eth_model_regs.DMASR.value |= ETH_DMASR_RS;
+  }
+  if (line_rate) {
+    while (tx_fetch() && (tx_free_ns <= until)) {
+      now_ns = (tx_free_ns > now_ns) ? tx_free_ns : now_ns;
+      tx_send();
+      irq_update();
+    }
+  } else {
+    tx_run(until);
+  }
+  now_ns = until;
+  irq_update();
+}
+
+uint64_t eth_model_now(void) {
+  return now_ns;
+}
+
+int eth_model_rx(const uint8_t *frame, uint16_t len) {
+  rx_slot_t *slot;
+
+  if ((len == 0) || (len > MAX_FRAME) ||
+      !(eth_model_regs.MACCR & ETH_MACCR_RE) || (rx_state == DMA_STOPPED)) {
+    stats.rx_missed++;
+    return -1;
+  }
+  if ((rx_fifo_count >= RX_FIFO_SLOTS) || ((rx_fifo_bytes + len) > ETH_MODEL_RX_FIFO)) {
+    stats.rx_missed++;
+    return -1;
+  }
+
+  slot = &rx_fifo[(rx_fifo_head + rx_fifo_count) % RX_FIFO_SLOTS];
+  memcpy(slot->data, frame, len);
+  slot->len = len;
+  rx_fifo_count++;
+  rx_fifo_bytes += len;
+  rx_drain();
+  irq_update();
+  return 0;
+}
+
+void eth_model_set_tx_sink(eth_model_sink_t sink, void *arg) {
+  tx_sink = sink;
+  tx_sink_arg = arg;
+}
+
+void eth_model_set_line_rate(uint8_t enable) {
+  line_rate = enable;
+  tx_free_ns = now_ns;
+}
+
+void eth_model_irq_hold(uint8_t hold) {
+  irq_held = hold;
+  if (!hold) {
+    irq_update();
+  }
+}
+
+void eth_model_inject(uint32_t fault) {
+  faults |= fault;
+}
+
+void eth_model_get_stats(eth_model_stats_t *snapshot) {
+  memcpy(snapshot, &stats, sizeof(stats));
+}
+
+void eth_model_clear_stats(void) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+void eth_model_phy_config(uint32_t kind, uint8_t link, uint8_t an_done, uint8_t speed_100m, uint8_t full_duplex) {
+  memset(&phy, 0, sizeof(phy));
+  phy.kind = (kind <= ETH_MODEL_PHY_UNKNOWN) ? kind : ETH_MODEL_PHY_UNKNOWN;
+  phy.link = link;
+  phy.an_done = an_done;
+  phy.speed_100m = speed_100m;
+  phy.full_duplex = full_duplex;
+  phy.bcr = PHY_BCR_DEFAULT;
+}
+
+void eth_model_phy_link(uint8_t up) {
+  phy.link = up;
+  phy.an_done = up;
+  switch (phy.kind) {
+    case ETH_MODEL_PHY_LAN8742A:
+      phy.irq_flags |= up ? LAN8742A_INT6 : LAN8742A_INT4;
+      break;
+    case ETH_MODEL_PHY_DP83848:
+      phy.irq_flags |= DP83848_MISR_LINK | (up ? DP83848_MISR_ANC : 0);
+      break;
+    case ETH_MODEL_PHY_KSZ8081:
+      phy.irq_flags |= up ? KSZ8081_ICSR_UP : KSZ8081_ICSR_DOWN;
+      break;
+    default:
+      break;
+  }
+}
+
+uint32_t eth_model_mdio_count(void) {
+  return mdio_count;
+}
+
+uint16_t eth_model_phy_peek(uint16_t reg) {
+  return phy_read(reg, 0);
+}
+
+/* HAL ---------------------------------------------------------------------- */
+extern "C" {
+
+uint32_t HAL_RCC_GetHCLKFreq(void) {
+  return SystemCoreClock;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init) {
+  (void)port;
+  (void)init;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type irqn, uint32_t preempt, uint32_t sub) {
+  (void)irqn;
+  (void)preempt;
+  (void)sub;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irqn) {
+  (void)irqn;
+}
+
+uint32_t pinmap_function(PinName pin, const PinMap *map) {
+  (void)pin;
+  (void)map;
+  return 0;
+}
+
+GPIO_TypeDef *set_GPIO_Port_Clock(uint32_t port_idx) {
+  (void)port_idx;
+  return NULL;
+}
+
+void pinMode(uint32_t pin, uint32_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode) {
+  (void)pin;
+  (void)callback;
+  (void)mode;
+}
+
+} /* extern "C" */
+
+HAL_StatusTypeDef HAL_ETH_ReadPHYRegister(ETH_HandleTypeDef *heth, uint16_t PHYReg, uint32_t *RegValue) {
+  (void)heth;
+  *RegValue = phy_read(PHYReg, 1);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_WritePHYRegister(ETH_HandleTypeDef *heth, uint16_t PHYReg, uint32_t RegValue) {
+  (void)heth;
+  phy_write(PHYReg, (uint16_t)RegValue);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_ConfigMAC(ETH_HandleTypeDef *heth, ETH_MACInitTypeDef *macconf) {
+  ETH_TypeDef *regs = heth->Instance;
+  uint32_t maccr = regs->MACCR & (ETH_MACCR_TE | ETH_MACCR_RE);
+
+  maccr |= heth->Init.Speed | heth->Init.DuplexMode;
+  if (macconf != NULL) {
+    maccr |= macconf->ChecksumOffload | macconf->RetryTransmission;
+    regs->MACFFR = macconf->ReceiveAll | macconf->SourceAddrFilter | macconf->PassControlFrames |
+                   macconf->BroadcastFramesReception | macconf->DestinationAddrFilter |
+                   macconf->PromiscuousMode | macconf->MulticastFramesFilter |
+                   macconf->UnicastFramesFilter;
+    regs->MACHTHR = macconf->HashTableHigh;
+    regs->MACHTLR = macconf->HashTableLow;
+    regs->MACVLANTR = macconf->VLANTagComparison | macconf->VLANTagIdentifier;
+  } else {
+    maccr |= regs->MACCR & ~(ETH_MACCR_TE | ETH_MACCR_RE | ETH_MACCR_FES | ETH_MACCR_DM);
+  }
+  regs->MACCR = maccr;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_ConfigDMA(ETH_HandleTypeDef *heth, ETH_DMAInitTypeDef *dmaconf) {
+  ETH_TypeDef *regs = heth->Instance;
+
+  regs->DMAOMR = (regs->DMAOMR & (ETH_DMAOMR_ST | ETH_DMAOMR_SR)) |
+                 dmaconf->DropTCPIPChecksumErrorFrame | dmaconf->ReceiveStoreForward |
+                 dmaconf->FlushReceivedFrame | dmaconf->TransmitStoreForward |
+                 dmaconf->TransmitThresholdControl | dmaconf->ForwardErrorFrames |
+                 dmaconf->ForwardUndersizedGoodFrames | dmaconf->ReceiveThresholdControl |
+                 dmaconf->SecondFrameOperate;
+  regs->DMABMR = dmaconf->AddressAlignedBeats | dmaconf->FixedBurst | dmaconf->RxDMABurstLength |
+                 dmaconf->TxDMABurstLength | dmaconf->EnhancedDescriptorFormat |
+                 (dmaconf->DescriptorSkipLength << 2) | dmaconf->DMAArbitration;
+  return HAL_OK;
+}
+
+/* MAC and DMA defaults of HAL_ETH_Init(), MAC address and RX interrupt */
+static void hal_macdma_config(ETH_HandleTypeDef *heth) {
+  ETH_TypeDef *regs = heth->Instance;
+  uint8_t *mac = heth->Init.MACAddr;
+
+  regs->MACCR = (regs->MACCR & (ETH_MACCR_TE | ETH_MACCR_RE)) | heth->Init.Speed |
+                heth->Init.DuplexMode | ETH_RETRYTRANSMISSION_DISABLE |
+                ((heth->Init.ChecksumMode == ETH_CHECKSUM_BY_HARDWARE) ? ETH_CHECKSUMOFFLAOD_ENABLE : 0);
+  regs->MACFFR = ETH_PASSCONTROLFRAMES_BLOCKALL;
+  regs->DMAOMR = (regs->DMAOMR & (ETH_DMAOMR_ST | ETH_DMAOMR_SR)) | ETH_RECEIVESTOREFORWARD_ENABLE |
+                 ETH_TRANSMITSTOREFORWARD_ENABLE | ETH_SECONDFRAMEOPERARTE_ENABLE;
+  regs->DMABMR = ETH_ADDRESSALIGNEDBEATS_ENABLE | ETH_FIXEDBURST_ENABLE | ETH_RXDMABURSTLENGTH_32BEAT |
+                 ETH_TXDMABURSTLENGTH_32BEAT | ETH_DMAENHANCEDDESCRIPTOR_ENABLE;
+  if (heth->Init.RxMode == ETH_RXINTERRUPT_MODE) {
+    __HAL_ETH_DMA_ENABLE_IT(heth, ETH_DMA_IT_NIS | ETH_DMA_IT_R);
+  }
+  if (mac != NULL) {
+    regs->MACA0HR = ((uint32_t)mac[5] << 8) | mac[4];
+    regs->MACA0LR = ((uint32_t)mac[3] << 24) | ((uint32_t)mac[2] << 16) | ((uint32_t)mac[1] << 8) | mac[0];
+  }
+}
+
+/* As the legacy HAL, without the waits: a missing link or auto-negotiation
+   not done times out at once */
+HAL_StatusTypeDef HAL_ETH_Init(ETH_HandleTypeDef *heth) {
+  uint32_t regvalue = 0;
+
+  if (heth->State == HAL_ETH_STATE_RESET) {
+    heth->Lock = HAL_UNLOCKED;
+    HAL_ETH_MspInit(heth);
+  }
+  SYSCFG->PMC &= ~(SYSCFG_PMC_MII_RMII_SEL);
+  SYSCFG->PMC |= heth->Init.MediaInterface;
+
+  heth->Instance->DMABMR |= ETH_DMABMR_SR;
+  if (heth->Instance->DMABMR & ETH_DMABMR_SR) {
+    heth->State = HAL_ETH_STATE_TIMEOUT;
+    return HAL_TIMEOUT;
+  }
+  heth->Instance->MACMIIAR = ETH_MACMIIAR_CR_Div102;
+
+  (void)HAL_ETH_WritePHYRegister(heth, PHY_BCR, PHY_RESET);
+  if (heth->Init.AutoNegotiation != ETH_AUTONEGOTIATION_DISABLE) {
+    (void)HAL_ETH_ReadPHYRegister(heth, PHY_BSR, &regvalue);
+    if (!(regvalue & PHY_LINKED_STATUS) || !(regvalue & PHY_AUTONEGO_COMPLETE)) {
+      hal_macdma_config(heth);
+      heth->State = HAL_ETH_STATE_READY;
+      return HAL_TIMEOUT;
+    }
+    (void)HAL_ETH_ReadPHYRegister(heth, PHY_SR, &regvalue);
+    heth->Init.DuplexMode = (regvalue & PHY_DUPLEX_STATUS) ? ETH_MODE_FULLDUPLEX : ETH_MODE_HALFDUPLEX;
+    heth->Init.Speed = (regvalue & PHY_SPEED_STATUS) ? ETH_SPEED_10M : ETH_SPEED_100M;
+  } else {
+    (void)HAL_ETH_WritePHYRegister(heth, PHY_BCR,
+      (uint16_t)(heth->Init.DuplexMode >> 3) | (uint16_t)(heth->Init.Speed >> 1));
+  }
+
+  hal_macdma_config(heth);
+  heth->State = HAL_ETH_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_Start(ETH_HandleTypeDef *heth) {
+  heth->State = HAL_ETH_STATE_BUSY;
+  heth->Instance->MACCR |= ETH_MACCR_TE;
+  heth->Instance->MACCR |= ETH_MACCR_RE;
+  heth->Instance->DMAOMR |= ETH_DMAOMR_FTF;
+  heth->Instance->DMAOMR |= ETH_DMAOMR_ST;
+  heth->Instance->DMAOMR |= ETH_DMAOMR_SR;
+  heth->State = HAL_ETH_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_Stop(ETH_HandleTypeDef *heth) {
+  heth->State = HAL_ETH_STATE_BUSY;
+  heth->Instance->DMAOMR &= ~ETH_DMAOMR_ST;
+  heth->Instance->DMAOMR &= ~ETH_DMAOMR_SR;
+  heth->Instance->MACCR &= ~ETH_MACCR_RE;
+  heth->Instance->DMAOMR |= ETH_DMAOMR_FTF;
+  heth->Instance->MACCR &= ~ETH_MACCR_TE;
+  heth->State = HAL_ETH_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_DMATxDescListInit(ETH_HandleTypeDef *heth, ETH_DMADescTypeDef *DMATxDescTab,
+                                            uint8_t *TxBuff, uint32_t TxBuffCount) {
+  ETH_DMADescTypeDef *desc;
+  uint32_t i;
+
+  addr_check(DMATxDescTab, "TX descriptors");
+  heth->TxDesc = DMATxDescTab;
+  for (i = 0; i < TxBuffCount; i++) {
+    desc = DMATxDescTab + i;
+    desc->Status = ETH_DMATXDESC_TCH;
+    desc->Buffer1Addr = (uint32_t)(uintptr_t)(&TxBuff[i * ETH_TX_BUF_SIZE]);
+    if (heth->Init.ChecksumMode == ETH_CHECKSUM_BY_HARDWARE) {
+      desc->Status |= ETH_DMATXDESC_CIC_TCPUDPICMP_FULL;
+    }
+    desc->Buffer2NextDescAddr = (uint32_t)(uintptr_t)((i < (TxBuffCount - 1)) ? (desc + 1) : DMATxDescTab);
+  }
+  heth->Instance->DMATDLAR = (uint32_t)(uintptr_t)DMATxDescTab;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_DMARxDescListInit(ETH_HandleTypeDef *heth, ETH_DMADescTypeDef *DMARxDescTab,
+                                            uint8_t *RxBuff, uint32_t RxBuffCount) {
+  ETH_DMADescTypeDef *desc;
+  uint32_t i;
+
+  addr_check(DMARxDescTab, "RX descriptors");
+  addr_check(RxBuff, "RX buffers");
+  heth->RxDesc = DMARxDescTab;
+  for (i = 0; i < RxBuffCount; i++) {
+    desc = DMARxDescTab + i;
+    desc->Status = ETH_DMARXDESC_OWN;
+    desc->ControlBufferSize = ETH_DMARXDESC_RCH | ETH_RX_BUF_SIZE;
+    desc->Buffer1Addr = (uint32_t)(uintptr_t)(&RxBuff[i * ETH_RX_BUF_SIZE]);
+    if (heth->Init.RxMode == ETH_RXINTERRUPT_MODE) {
+      desc->ControlBufferSize &= ~ETH_DMARXDESC_DIC;
+    }
+    desc->Buffer2NextDescAddr = (uint32_t)(uintptr_t)((i < (RxBuffCount - 1)) ? (desc + 1) : DMARxDescTab);
+  }
+  heth->Instance->DMARDLAR = (uint32_t)(uintptr_t)DMARxDescTab;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_GetReceivedFrame_IT(ETH_HandleTypeDef *heth) {
+  uint32_t scanned = 0;
+
+  heth->State = HAL_ETH_STATE_BUSY;
+  while (((heth->RxDesc->Status & ETH_DMARXDESC_OWN) == (uint32_t)RESET) && (scanned < ETH_RXBUFNB)) {
+    scanned++;
+    if ((heth->RxDesc->Status & (ETH_DMARXDESC_FS | ETH_DMARXDESC_LS)) == ETH_DMARXDESC_FS) {
+      heth->RxFrameInfos.FSRxDesc = heth->RxDesc;
+      heth->RxFrameInfos.SegCount = 1;
+      heth->RxDesc = desc_ptr(heth->RxDesc->Buffer2NextDescAddr);
+    } else if ((heth->RxDesc->Status & (ETH_DMARXDESC_FS | ETH_DMARXDESC_LS)) == (uint32_t)RESET) {
+      heth->RxFrameInfos.SegCount++;
+      heth->RxDesc = desc_ptr(heth->RxDesc->Buffer2NextDescAddr);
+    } else {
+      heth->RxFrameInfos.LSRxDesc = heth->RxDesc;
+      heth->RxFrameInfos.SegCount++;
+      if (heth->RxFrameInfos.SegCount == 1) {
+        heth->RxFrameInfos.FSRxDesc = heth->RxDesc;
+      }
+      heth->RxFrameInfos.length = ((heth->RxDesc->Status & ETH_DMARXDESC_FL) >> ETH_DMARXDESC_FRAMELENGTHSHIFT) - 4U;
+      heth->RxFrameInfos.buffer = heth->RxFrameInfos.FSRxDesc->Buffer1Addr;
+      heth->RxDesc = desc_ptr(heth->RxDesc->Buffer2NextDescAddr);
+      heth->State = HAL_ETH_STATE_READY;
+      return HAL_OK;
+    }
+  }
+  heth->State = HAL_ETH_STATE_READY;
+  return HAL_ERROR;
+}
+
+void HAL_ETH_IRQHandler(ETH_HandleTypeDef *heth) {
+  if (__HAL_ETH_DMA_GET_FLAG(heth, ETH_DMA_FLAG_R)) {
+    HAL_ETH_RxCpltCallback(heth);
+    __HAL_ETH_DMA_CLEAR_IT(heth, ETH_DMA_IT_R);
+    heth->State = HAL_ETH_STATE_READY;
+  } else if (__HAL_ETH_DMA_GET_FLAG(heth, ETH_DMA_FLAG_T)) {
+    HAL_ETH_TxCpltCallback(heth);
+    __HAL_ETH_DMA_CLEAR_IT(heth, ETH_DMA_IT_T);
+    heth->State = HAL_ETH_STATE_READY;
+  }
+  __HAL_ETH_DMA_CLEAR_IT(heth, ETH_DMA_IT_NIS);
+  if (__HAL_ETH_DMA_GET_FLAG(heth, ETH_DMA_FLAG_AIS)) {
+    HAL_ETH_ErrorCallback(heth);
+    __HAL_ETH_DMA_CLEAR_IT(heth, ETH_DMA_FLAG_AIS);
+    heth->State = HAL_ETH_STATE_READY;
+  }
+}
+
+__weak void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth) {
+  (void)heth;
+}
+
+__weak void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth) {
+  (void)heth;
+}
+
+__weak void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *heth) {
+  (void)heth;
+}
+
+__weak void HAL_ETH_MspInit(ETH_HandleTypeDef *heth) {
+  (void)heth;
+}
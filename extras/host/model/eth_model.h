@@ -0,0 +1,110 @@
+/***************************************************************************//**
+ * @file    eth_model.h
+ * @brief   Host build: STM32F4 ETH MAC, DMA and PHY model
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * The model owns the ETH registers (ETH), and implements the legacy HAL_ETH_xxx
+ * functions the driver uses, so the driver code runs unchanged on it:
+ *  - RX DMA: frames from eth_model_rx() are written to the descriptors owned
+ *    by DMA, as the hardware does (FS, LS, FL with FCS, OWN cleared). RS is
+ *    raised unless the descriptor has DIC, then the receive watchdog
+ *    (DMARSWTR) raises it. The next descriptor is fetched at once, RX DMA is
+ *    suspended with RBUS if it's not owned by DMA, frames then wait in the
+ *    2 KB MAC FIFO, or are missed once it's full
+ *  - TX DMA: resumed by start or poll demand, sends the frames of the owned
+ *    descriptors during eth_model_step(), at line rate if enabled. Suspended
+ *    with TBUS at the first descriptor not owned by DMA, or with TUS on an
+ *    injected underflow
+ *  - Interrupt: level triggered from DMASR and DMAIER, NIS and AIS latched
+ *    while an enabled source is set. ETH_IRQHandler() is called in line from
+ *    the register write or model function raising it, and never nested
+ *  - MDIO: an MDIO operation started in MACMIIAR completes
+ *    ETH_MODEL_MDIO_NS later (virtual time), the blocking HAL functions
+ *    complete at once
+ *  - PHY: LAN8742A, DP83848, KSZ8081 or an unknown one, with the basic and
+ *    vendor status and interrupt registers
+ *
+ * Time is virtual (ns), advanced by eth_model_step(). The model is not
+ * thread-safe: the driver and the test run it from one thread, as CPU and
+ * DMA of one MCU.
+ ******************************************************************************/
+#ifndef __ETH_MODEL_H__
+#define __ETH_MODEL_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32_def.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* PHY kinds */
+#define ETH_MODEL_PHY_LAN8742A    0U
+#define ETH_MODEL_PHY_DP83848     1U
+#define ETH_MODEL_PHY_KSZ8081     2U
+#define ETH_MODEL_PHY_UNKNOWN     3U
+
+/* Faults for eth_model_inject() */
+#define ETH_MODEL_FAULT_TUS       0x01U   /* Underflow on the next TX frame */
+#define ETH_MODEL_FAULT_RESET     0x02U   /* DMA software reset never done */
+
+/* MAC RX FIFO size (bytes) */
+#define ETH_MODEL_RX_FIFO         2048U
+/* MDIO operation time: 64 bits at 2.5 MHz */
+#define ETH_MODEL_MDIO_NS         25600U
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*eth_model_sink_t)(const uint8_t *frame, uint16_t len, void *arg);
+
+typedef struct {
+  uint32_t rx_frames;           /* Frames written to RX descriptors */
+  uint64_t rx_bytes;
+  uint32_t rx_missed;           /* Frames dropped as RX FIFO full or DMA stopped */
+  uint32_t rx_rbus;             /* RX DMA suspended: buffer unavailable */
+  uint32_t tx_frames;           /* Frames sent */
+  uint64_t tx_bytes;
+  uint32_t tx_tbus;             /* TX DMA suspended: buffer unavailable */
+  uint32_t tx_tus;              /* TX DMA suspended: underflow */
+  uint32_t tx_err;              /* Frames lost on underflow */
+  uint32_t irq;                 /* ETH_IRQHandler() calls */
+  uint32_t irq_storm;           /* Interrupts left pending as never cleared */
+  /* RX DMA suspended (RBUS) until resumed by poll demand */
+  uint32_t rx_recover_cnt;
+  uint64_t rx_recover_cycles;
+  uint64_t rx_recover_max;
+  uint64_t rx_recover_ns;
+  /* TX DMA suspended (TUS) until resumed by poll demand */
+  uint32_t tx_recover_cnt;
+  uint64_t tx_recover_cycles;
+  uint64_t tx_recover_max;
+  uint64_t tx_recover_ns;
+} eth_model_stats_t;
+
+/* Exported functions ------------------------------------------------------- */
+/* Power on reset, with a LAN8742A PHY linked at 100M full duplex */
+void eth_model_reset(void);
+/* Advance virtual time */
+void eth_model_step(uint64_t ns);
+uint64_t eth_model_now(void);
+
+/* Receive a frame (without FCS) from the wire, return 0 if not missed */
+int eth_model_rx(const uint8_t *frame, uint16_t len);
+/* Get transmitted frames */
+void eth_model_set_tx_sink(eth_model_sink_t sink, void *arg);
+/* Send TX frames at line rate (virtual time), else at once */
+void eth_model_set_line_rate(uint8_t enable);
+
+/* Hold the interrupt line (as masked by CPU), released with 0 */
+void eth_model_irq_hold(uint8_t hold);
+void eth_model_inject(uint32_t fault);
+
+void eth_model_get_stats(eth_model_stats_t *stats);
+void eth_model_clear_stats(void);
+
+/* PHY setup, before the driver is initialized */
+void eth_model_phy_config(uint32_t kind, uint8_t link, uint8_t an_done, uint8_t speed_100m, uint8_t full_duplex);
+/* Link change, raising the PHY interrupt flags of it */
+void eth_model_phy_link(uint8_t up);
+/* MDIO operations started by MACMIIAR */
+uint32_t eth_model_mdio_count(void);
+/* PHY register value, without the side effect of reading it */
+uint16_t eth_model_phy_peek(uint16_t reg);
+
+#endif /* __ETH_MODEL_H__ */
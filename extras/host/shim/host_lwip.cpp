@@ -0,0 +1,761 @@
+/***************************************************************************//**
+ * @file    host_lwip.cpp
+ * @brief   Host build: LwIP subset used by the driver
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * "pbuf" are from a static pool (below 4 GB, as DMA addresses are 32-bit)
+ * and thread-safe. tcpip_thread is replaced by host_tcpip_poll(), which runs
+ * the messages of its mailbox with TCPIP core locked.
+ ******************************************************************************/
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "host_lwip.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PBUF_BLOCK_NUM        512U
+#define PBUF_BLOCK_DATA       1600U
+#define PBUF_HDR_SIZE         LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf))
+#define MBOX_MAX              256U
+#define TIMEOUT_NUM           8U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef union pbuf_block {
+  union pbuf_block *next;
+  u8_t mem[PBUF_HDR_SIZE + PBUF_BLOCK_DATA];
+} pbuf_block_t;
+
+struct tcpip_callback_msg {
+  tcpip_callback_fn function;
+  void *ctx;
+};
+
+typedef struct {
+  tcpip_callback_fn function;   /* NULL for a frame */
+  void *ctx;
+  struct pbuf *p;
+  struct netif *inp;
+} mbox_msg_t;
+
+typedef struct {
+  sys_timeout_handler handler;
+  void *arg;
+  u32_t time;
+} host_timeout_t;
+
+/* Private variables ---------------------------------------------------------*/
+static pbuf_block_t pbuf_pool[PBUF_BLOCK_NUM] __attribute__((aligned(8)));
+static pbuf_block_t *pbuf_free_list;
+static u32_t pbuf_in_use;
+static u8_t pbuf_ready;
+static pthread_mutex_t pbuf_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static mbox_msg_t mbox[MBOX_MAX];
+static u32_t mbox_size = TCPIP_MBOX_SIZE;
+static u32_t mbox_head;
+static u32_t mbox_count;
+static u32_t mbox_drop;
+static pthread_mutex_t mbox_mutex = PTHREAD_MUTEX_INITIALIZER;
+static netif_input_fn mbox_input = ethernet_input;
+
+static host_timeout_t timeouts[TIMEOUT_NUM];
+
+/* Exported variables --------------------------------------------------------*/
+const ip_addr_t ip_addr_any = { 0 };
+const ip_addr_t ip_addr_broadcast = { 0xFFFFFFFFUL };
+struct netif *netif_default;
+static struct netif *netif_list;
+
+/* Private functions ---------------------------------------------------------*/
+static struct pbuf *pbuf_block_alloc(void) {
+  pbuf_block_t *block;
+  u32_t i;
+
+  pthread_mutex_lock(&pbuf_mutex);
+  if (!pbuf_ready) {
+    for (i = 0; i < PBUF_BLOCK_NUM; i++) {
+      pbuf_pool[i].next = (i < (PBUF_BLOCK_NUM - 1)) ? &pbuf_pool[i + 1] : NULL;
+    }
+    pbuf_free_list = &pbuf_pool[0];
+    pbuf_ready = 1;
+  }
+  block = pbuf_free_list;
+  if (block != NULL) {
+    pbuf_free_list = block->next;
+    pbuf_in_use++;
+  }
+  pthread_mutex_unlock(&pbuf_mutex);
+  return (struct pbuf *)block;
+}
+
+static void pbuf_block_free(struct pbuf *p) {
+  pbuf_block_t *block = (pbuf_block_t *)p;
+
+  pthread_mutex_lock(&pbuf_mutex);
+  block->next = pbuf_free_list;
+  pbuf_free_list = block;
+  pbuf_in_use--;
+  pthread_mutex_unlock(&pbuf_mutex);
+}
+
+static u8_t *pbuf_block_data(struct pbuf *p) {
+  return (u8_t *)p + PBUF_HDR_SIZE;
+}
+
+static u8_t pbuf_is_block(const struct pbuf *p) {
+  return ((const u8_t *)p >= (const u8_t *)pbuf_pool) &&
+         ((const u8_t *)p < (const u8_t *)&pbuf_pool[PBUF_BLOCK_NUM]) &&
+         !(p->flags & PBUF_FLAG_IS_CUSTOM);
+}
+
+/* Exported functions ------------------------------------------------------- */
+void host_lwip_assert(const char *message, const char *file, int line) {
+  fprintf(stderr, "Assertion \"%s\" failed at %s:%d\n", message, file, line);
+  abort();
+}
+
+/* pbuf --------------------------------------------------------------------- */
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+  struct pbuf *p;
+  struct pbuf *q;
+  struct pbuf *last = NULL;
+  struct pbuf *head = NULL;
+  u32_t offset = LWIP_MEM_ALIGN_SIZE((u32_t)layer);
+  u32_t left = length;
+  u32_t len;
+
+  if ((type == PBUF_REF) || (type == PBUF_ROM)) {
+    p = pbuf_block_alloc();
+    if (p == NULL) {
+      return NULL;
+    }
+    memset(p, 0, sizeof(*p));
+    p->len = p->tot_len = length;
+    p->type_internal = (u8_t)type;
+    p->ref = 1;
+    return p;
+  }
+
+  do {
+    q = pbuf_block_alloc();
+    if (q == NULL) {
+      if (head != NULL) {
+        pbuf_free(head);
+      }
+      return NULL;
+    }
+    len = LWIP_MIN(left, PBUF_BLOCK_DATA - offset);
+    memset(q, 0, sizeof(*q));
+    q->payload = pbuf_block_data(q) + offset;
+    q->len = (u16_t)len;
+    q->tot_len = (u16_t)left;
+    q->type_internal = (u8_t)type;
+    q->ref = 1;
+    if (last == NULL) {
+      head = q;
+    } else {
+      last->next = q;
+    }
+    last = q;
+    left -= len;
+    offset = 0;
+  } while (left > 0);
+  return head;
+}
+
+struct pbuf *pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type,
+                                 struct pbuf_custom *p, void *payload_mem, u16_t payload_mem_len) {
+  u32_t offset = LWIP_MEM_ALIGN_SIZE((u32_t)l);
+
+  if ((offset + length) > payload_mem_len) {
+    return NULL;
+  }
+  p->pbuf.next = NULL;
+  p->pbuf.payload = (payload_mem != NULL) ? ((u8_t *)payload_mem + offset) : NULL;
+  p->pbuf.len = p->pbuf.tot_len = length;
+  p->pbuf.type_internal = (u8_t)type;
+  p->pbuf.flags = PBUF_FLAG_IS_CUSTOM;
+  p->pbuf.ref = 1;
+  p->pbuf.if_idx = 0;
+  return &p->pbuf;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+  struct pbuf *q;
+  u8_t count = 0;
+
+  while (p != NULL) {
+    if (__atomic_sub_fetch(&p->ref, 1, __ATOMIC_ACQ_REL) != 0) {
+      break;
+    }
+    q = p->next;
+    if (p->flags & PBUF_FLAG_IS_CUSTOM) {
+      ((struct pbuf_custom *)p)->custom_free_function(p);
+    } else {
+      pbuf_block_free(p);
+    }
+    count++;
+    p = q;
+  }
+  return count;
+}
+
+void pbuf_ref(struct pbuf *p) {
+  if (p != NULL) {
+    (void)__atomic_add_fetch(&p->ref, 1, __ATOMIC_RELAXED);
+  }
+}
+
+u16_t pbuf_clen(const struct pbuf *p) {
+  u16_t len = 0;
+
+  while (p != NULL) {
+    len++;
+    p = p->next;
+  }
+  return len;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail) {
+  struct pbuf *p;
+
+  for (p = head; p->next != NULL; p = p->next) {
+    p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+  }
+  p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+  p->next = tail;
+}
+
+void pbuf_chain(struct pbuf *head, struct pbuf *tail) {
+  pbuf_cat(head, tail);
+  pbuf_ref(tail);
+}
+
+void pbuf_realloc(struct pbuf *p, u16_t size) {
+  struct pbuf *q = p;
+  u16_t rem = size;
+
+  if (size >= p->tot_len) {
+    return;
+  }
+  while (rem > q->len) {
+    rem = (u16_t)(rem - q->len);
+    q->tot_len = (u16_t)(q->tot_len - (p->tot_len - size));
+    q = q->next;
+  }
+  q->len = rem;
+  q->tot_len = rem;
+  if (q->next != NULL) {
+    pbuf_free(q->next);
+  }
+  q->next = NULL;
+}
+
+u8_t pbuf_remove_header(struct pbuf *p, size_t header_size) {
+  if ((p == NULL) || (header_size > p->len)) {
+    return 1;
+  }
+  p->payload = (u8_t *)p->payload + header_size;
+  p->len = (u16_t)(p->len - header_size);
+  p->tot_len = (u16_t)(p->tot_len - header_size);
+  return 0;
+}
+
+u8_t pbuf_add_header(struct pbuf *p, size_t header_size) {
+  if ((p == NULL) || !pbuf_is_block(p) || (p->payload == NULL) ||
+      (((u8_t *)p->payload - header_size) < pbuf_block_data(p))) {
+    return 1;
+  }
+  p->payload = (u8_t *)p->payload - header_size;
+  p->len = (u16_t)(p->len + header_size);
+  p->tot_len = (u16_t)(p->tot_len + header_size);
+  return 0;
+}
+
+u8_t pbuf_header(struct pbuf *p, s16_t header_size) {
+  if (header_size < 0) {
+    return pbuf_remove_header(p, (size_t)-header_size);
+  }
+  return pbuf_add_header(p, (size_t)header_size);
+}
+
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size) {
+  struct pbuf *p = q;
+  struct pbuf *f;
+  u16_t free_left = size;
+
+  while (free_left && (p != NULL)) {
+    if (free_left >= p->len) {
+      f = p;
+      free_left = (u16_t)(free_left - p->len);
+      p = p->next;
+      f->next = NULL;
+      pbuf_free(f);
+    } else {
+      (void)pbuf_remove_header(p, free_left);
+      free_left = 0;
+    }
+  }
+  return p;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset) {
+  const struct pbuf *p;
+  u16_t left = 0;
+  u16_t buf_copy_len;
+  u16_t copied_total = 0;
+
+  for (p = buf; (len != 0) && (p != NULL); p = p->next) {
+    if ((offset != 0) && (offset >= p->len)) {
+      offset = (u16_t)(offset - p->len);
+      continue;
+    }
+    buf_copy_len = (u16_t)(p->len - offset);
+    if (buf_copy_len > len) {
+      buf_copy_len = len;
+    }
+    memcpy((u8_t *)dataptr + left, (const u8_t *)p->payload + offset, buf_copy_len);
+    copied_total = (u16_t)(copied_total + buf_copy_len);
+    left = (u16_t)(left + buf_copy_len);
+    len = (u16_t)(len - buf_copy_len);
+    offset = 0;
+  }
+  return copied_total;
+}
+
+err_t pbuf_copy(struct pbuf *p_to, const struct pbuf *p_from) {
+  u16_t offset = 0;
+  struct pbuf *q;
+
+  if ((p_to == NULL) || (p_from == NULL) || (p_to->tot_len < p_from->tot_len)) {
+    return ERR_ARG;
+  }
+  for (q = p_to; (q != NULL) && (offset < p_from->tot_len); q = q->next) {
+    offset = (u16_t)(offset + pbuf_copy_partial(p_from, q->payload,
+      LWIP_MIN(q->len, (u16_t)(p_from->tot_len - offset)), offset));
+  }
+  return ERR_OK;
+}
+
+err_t pbuf_take_at(struct pbuf *buf, const void *dataptr, u16_t len, u16_t offset) {
+  struct pbuf *p;
+  u16_t copied = 0;
+  u16_t n;
+
+  if ((buf == NULL) || ((u32_t)offset + len > buf->tot_len)) {
+    return ERR_MEM;
+  }
+  for (p = buf; (p != NULL) && (copied < len); p = p->next) {
+    if (offset >= p->len) {
+      offset = (u16_t)(offset - p->len);
+      continue;
+    }
+    n = LWIP_MIN((u16_t)(p->len - offset), (u16_t)(len - copied));
+    memcpy((u8_t *)p->payload + offset, (const u8_t *)dataptr + copied, n);
+    copied = (u16_t)(copied + n);
+    offset = 0;
+  }
+  return ERR_OK;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len) {
+  return pbuf_take_at(buf, dataptr, len, 0);
+}
+
+u8_t pbuf_get_at(const struct pbuf *p, u16_t offset) {
+  while (p != NULL) {
+    if (offset < p->len) {
+      return ((const u8_t *)p->payload)[offset];
+    }
+    offset = (u16_t)(offset - p->len);
+    p = p->next;
+  }
+  return 0;
+}
+
+u32_t host_pbuf_used(void) {
+  u32_t used;
+
+  pthread_mutex_lock(&pbuf_mutex);
+  used = pbuf_in_use;
+  pthread_mutex_unlock(&pbuf_mutex);
+  return used;
+}
+
+u16_t inet_chksum(const void *dataptr, u16_t len) {
+  const u8_t *data = (const u8_t *)dataptr;
+  u32_t acc = 0;
+
+  while (len > 1) {
+    acc += ((u32_t)data[0] << 8) | data[1];
+    data += 2;
+    len = (u16_t)(len - 2);
+  }
+  if (len) {
+    acc += (u32_t)data[0] << 8;
+  }
+  while (acc >> 16) {
+    acc = (acc & 0xFFFFUL) + (acc >> 16);
+  }
+  return lwip_htons((u16_t)~acc);
+}
+
+/* Memory ------------------------------------------------------------------- */
+void host_memp_init(host_memp_t *pool) {
+  u32_t i;
+  void **elem;
+
+  pool->free = NULL;
+  for (i = pool->num; i > 0; i--) {
+    elem = (void **)(pool->base + (i - 1) * pool->size);
+    *elem = pool->free;
+    pool->free = elem;
+  }
+  pool->used = 0;
+}
+
+void *host_memp_alloc(host_memp_t *pool) {
+  void **elem;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  elem = (void **)pool->free;
+  if (elem != NULL) {
+    pool->free = *elem;
+    pool->used++;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return elem;
+}
+
+void host_memp_free(host_memp_t *pool, void *mem) {
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  *(void **)mem = pool->free;
+  pool->free = mem;
+  pool->used--;
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+void *mem_malloc(size_t size) {
+  return malloc(size);
+}
+
+void mem_free(void *rmem) {
+  free(rmem);
+}
+
+/* netif -------------------------------------------------------------------- */
+struct netif *netif_add(struct netif *netif, const ip4_addr_t *ipaddr, const ip4_addr_t *netmask,
+                        const ip4_addr_t *gw, void *state, netif_init_fn init, netif_input_fn input) {
+  memset(netif, 0, sizeof(*netif));
+  netif->ip_addr = (ipaddr != NULL) ? *ipaddr : ip_addr_any;
+  netif->netmask = (netmask != NULL) ? *netmask : ip_addr_any;
+  netif->gw = (gw != NULL) ? *gw : ip_addr_any;
+  netif->state = state;
+  netif->input = input;
+  if (init(netif) != ERR_OK) {
+    return NULL;
+  }
+  netif->next = netif_list;
+  netif_list = netif;
+  return netif;
+}
+
+void netif_set_default(struct netif *netif) {
+  netif_default = netif;
+}
+
+void netif_set_up(struct netif *netif) {
+  if (!(netif->flags & NETIF_FLAG_UP)) {
+    netif->flags |= NETIF_FLAG_UP;
+    if (netif->status_callback != NULL) {
+      netif->status_callback(netif);
+    }
+  }
+}
+
+void netif_set_down(struct netif *netif) {
+  if (netif->flags & NETIF_FLAG_UP) {
+    netif->flags &= ~NETIF_FLAG_UP;
+    if (netif->status_callback != NULL) {
+      netif->status_callback(netif);
+    }
+  }
+}
+
+void netif_set_link_up(struct netif *netif) {
+  if (!(netif->flags & NETIF_FLAG_LINK_UP)) {
+    netif->flags |= NETIF_FLAG_LINK_UP;
+    if (netif->link_callback != NULL) {
+      netif->link_callback(netif);
+    }
+  }
+}
+
+void netif_set_link_down(struct netif *netif) {
+  if (netif->flags & NETIF_FLAG_LINK_UP) {
+    netif->flags &= ~NETIF_FLAG_LINK_UP;
+    if (netif->link_callback != NULL) {
+      netif->link_callback(netif);
+    }
+  }
+}
+
+void netif_set_status_callback(struct netif *netif, netif_status_callback_fn status_callback) {
+  netif->status_callback = status_callback;
+}
+
+void netif_set_link_callback(struct netif *netif, netif_status_callback_fn link_callback) {
+  netif->link_callback = link_callback;
+}
+
+/* tcpip_thread ------------------------------------------------------------- */
+static err_t mbox_post(tcpip_callback_fn function, void *ctx, struct pbuf *p, struct netif *inp) {
+  mbox_msg_t *msg;
+
+  pthread_mutex_lock(&mbox_mutex);
+  if (mbox_count >= mbox_size) {
+    mbox_drop++;
+    pthread_mutex_unlock(&mbox_mutex);
+    return ERR_MEM;
+  }
+  msg = &mbox[(mbox_head + mbox_count) % MBOX_MAX];
+  msg->function = function;
+  msg->ctx = ctx;
+  msg->p = p;
+  msg->inp = inp;
+  mbox_count++;
+  pthread_mutex_unlock(&mbox_mutex);
+  return ERR_OK;
+}
+
+void tcpip_init(tcpip_init_done_fn tcpip_init_done, void *arg) {
+  if (tcpip_init_done != NULL) {
+    tcpip_init_done(arg);
+  }
+}
+
+err_t tcpip_input(struct pbuf *p, struct netif *inp) {
+  return mbox_post(NULL, NULL, p, inp);
+}
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx) {
+  return mbox_post(function, ctx, NULL, NULL);
+}
+
+err_t tcpip_try_callback(tcpip_callback_fn function, void *ctx) {
+  return mbox_post(function, ctx, NULL, NULL);
+}
+
+struct tcpip_callback_msg *tcpip_callbackmsg_new(tcpip_callback_fn function, void *ctx) {
+  struct tcpip_callback_msg *msg = (struct tcpip_callback_msg *)malloc(sizeof(*msg));
+
+  if (msg != NULL) {
+    msg->function = function;
+    msg->ctx = ctx;
+  }
+  return msg;
+}
+
+void tcpip_callbackmsg_delete(struct tcpip_callback_msg *msg) {
+  free(msg);
+}
+
+err_t tcpip_callbackmsg_trycallback(struct tcpip_callback_msg *msg) {
+  return mbox_post(msg->function, msg->ctx, NULL, NULL);
+}
+
+err_t tcpip_callbackmsg_trycallback_fromisr(struct tcpip_callback_msg *msg) {
+  return mbox_post(msg->function, msg->ctx, NULL, NULL);
+}
+
+u32_t host_tcpip_poll(u32_t max) {
+  mbox_msg_t msg;
+  u32_t done = 0;
+  u32_t i;
+
+  LOCK_TCPIP_CORE();
+  for (i = 0; i < TIMEOUT_NUM; i++) {
+    if ((timeouts[i].handler != NULL) && ((s32_t)(sys_now() - timeouts[i].time) >= 0)) {
+      sys_timeout_handler handler = timeouts[i].handler;
+
+      timeouts[i].handler = NULL;
+      handler(timeouts[i].arg);
+    }
+  }
+  while ((max == 0) || (done < max)) {
+    pthread_mutex_lock(&mbox_mutex);
+    if (mbox_count == 0) {
+      pthread_mutex_unlock(&mbox_mutex);
+      break;
+    }
+    msg = mbox[mbox_head];
+    mbox_head = (mbox_head + 1) % MBOX_MAX;
+    mbox_count--;
+    pthread_mutex_unlock(&mbox_mutex);
+
+    if (msg.function != NULL) {
+      msg.function(msg.ctx);
+    } else if (mbox_input(msg.p, msg.inp) != ERR_OK) {
+      pbuf_free(msg.p);
+    }
+    done++;
+  }
+  UNLOCK_TCPIP_CORE();
+  return done;
+}
+
+void host_tcpip_set_mbox_size(u32_t size) {
+  mbox_size = LWIP_MIN(size, MBOX_MAX);
+}
+
+void host_tcpip_set_input(netif_input_fn input) {
+  mbox_input = (input != NULL) ? input : ethernet_input;
+}
+
+u32_t host_tcpip_mbox_drop(void) {
+  return mbox_drop;
+}
+
+void sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg) {
+  u32_t i;
+
+  for (i = 0; i < TIMEOUT_NUM; i++) {
+    if (timeouts[i].handler == NULL) {
+      timeouts[i].handler = handler;
+      timeouts[i].arg = arg;
+      timeouts[i].time = sys_now() + msecs;
+      return;
+    }
+  }
+  LWIP_ASSERT("sys_timeout: no free slot", 0);
+}
+
+void sys_untimeout(sys_timeout_handler handler, void *arg) {
+  u32_t i;
+
+  for (i = 0; i < TIMEOUT_NUM; i++) {
+    if ((timeouts[i].handler == handler) && (timeouts[i].arg == arg)) {
+      timeouts[i].handler = NULL;
+    }
+  }
+}
+
+void sys_check_timeouts(void) {
+  (void)host_tcpip_poll(0);
+}
+
+/* Protocols: stubs --------------------------------------------------------- */
+err_t ethernet_input(struct pbuf *p, struct netif *netif) {
+  LWIP_UNUSED_ARG(netif);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+err_t etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr) {
+  LWIP_UNUSED_ARG(ipaddr);
+  return netif->linkoutput(netif, q);
+}
+
+err_t etharp_request(struct netif *netif, const ip4_addr_t *ipaddr) {
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(ipaddr);
+  return ERR_OK;
+}
+
+void igmp_init(void) {
+}
+
+void igmp_start(struct netif *netif) {
+  LWIP_UNUSED_ARG(netif);
+}
+
+err_t dhcp_start(struct netif *netif) {
+  LWIP_UNUSED_ARG(netif);
+  return ERR_OK;
+}
+
+void dhcp_inform(struct netif *netif) {
+  LWIP_UNUSED_ARG(netif);
+}
+
+void dhcp_release_and_stop(struct netif *netif) {
+  LWIP_UNUSED_ARG(netif);
+}
+
+u8_t dhcp_supplied_address(const struct netif *netif) {
+  LWIP_UNUSED_ARG(netif);
+  return 0;
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg) {
+  LWIP_UNUSED_ARG(hostname);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(found);
+  LWIP_UNUSED_ARG(callback_arg);
+  return ERR_VAL;
+}
+
+const ip_addr_t *dns_getserver(u8_t numdns) {
+  LWIP_UNUSED_ARG(numdns);
+  return &ip_addr_any;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) {
+  pcb->callback_arg = arg;
+}
+
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept) {
+  pcb->accept = accept;
+}
+
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) {
+  pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) {
+  pcb->sent = sent;
+}
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval) {
+  pcb->poll = poll;
+  pcb->pollinterval = interval;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) {
+  pcb->errf = err;
+}
+
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio) {
+  pcb->prio = prio;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+  __atomic_add_fetch(&pcb->recved, len, __ATOMIC_RELAXED);
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags) {
+  LWIP_UNUSED_ARG(dataptr);
+  LWIP_UNUSED_ARG(apiflags);
+  if (len > pcb->snd_buf) {
+    return ERR_MEM;
+  }
+  return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+  LWIP_UNUSED_ARG(pcb);
+  return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+  LWIP_UNUSED_ARG(pcb);
+  return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+  LWIP_UNUSED_ARG(pcb);
+}
@@ -0,0 +1,321 @@
+/***************************************************************************//**
+ * @file    host_rtt.cpp
+ * @brief   Host build: RT-Thread and LwIP "sys" layer on POSIX threads
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * One tick is 1 ms of the monotonic clock.
+ ******************************************************************************/
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <rtthread.h>
+#include "host_lwip.h"
+#include "stm32_def.h"
+#include "Arduino.h"
+#include "log.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} host_cond_t;
+
+struct host_sem {
+  host_cond_t c;
+  u32_t count;
+};
+
+struct host_thread {
+  pthread_t id;
+  lwip_thread_fn fn;
+  void *arg;
+};
+
+/* Private variables ---------------------------------------------------------*/
+static pthread_mutex_t protect_mutex;
+static pthread_mutex_t core_mutex;
+static pthread_once_t mutex_once = PTHREAD_ONCE_INIT;
+
+/* Exported variables --------------------------------------------------------*/
+int host_log_level;
+
+/* Private functions ---------------------------------------------------------*/
+static void mutex_init(void) {
+  pthread_mutexattr_t attr;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&protect_mutex, &attr);
+  pthread_mutex_init(&core_mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000U + (uint64_t)ts.tv_nsec / 1000000U;
+}
+
+static void cond_init(host_cond_t *c) {
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&c->cond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(&c->mutex, NULL);
+}
+
+/* Wait with mutex locked, "ms" < 0 for ever, return 0 on timeout */
+static int cond_wait(host_cond_t *c, int32_t ms) {
+  struct timespec ts;
+
+  if (ms < 0) {
+    pthread_cond_wait(&c->cond, &c->mutex);
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ts.tv_sec += ms / 1000;
+  ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  return pthread_cond_timedwait(&c->cond, &c->mutex, &ts) != ETIMEDOUT;
+}
+
+static void *thread_entry(void *arg) {
+  struct host_thread *thread = (struct host_thread *)arg;
+
+  thread->fn(thread->arg);
+  return NULL;
+}
+
+/* Exported functions ------------------------------------------------------- */
+extern "C" {
+
+void host_log(int level, const char *tag, const char *fmt, ...) {
+  va_list args;
+
+  if (level > host_log_level) {
+    return;
+  }
+  va_start(args, fmt);
+  fprintf(stderr, "[%s] ", tag);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+/* HAL and Arduino time ----------------------------------------------------- */
+uint32_t HAL_GetTick(void) {
+  static uint64_t start;
+
+  if (start == 0) {
+    start = now_ms() - 1;
+  }
+  return (uint32_t)(now_ms() - start);
+}
+
+void HAL_Delay(uint32_t delay) {
+  sys_msleep(delay);
+}
+
+uint32_t millis(void) {
+  return HAL_GetTick();
+}
+
+/* RT-Thread ---------------------------------------------------------------- */
+rt_err_t rt_event_init(rt_event_t event, const char *name, rt_uint8_t flag) {
+  host_cond_t *c = (host_cond_t *)malloc(sizeof(host_cond_t));
+
+  (void)flag;
+  if (c == NULL) {
+    return -RT_ERROR;
+  }
+  cond_init(c);
+  event->name = name;
+  event->set = 0;
+  event->impl = c;
+  return RT_EOK;
+}
+
+rt_err_t rt_event_send(rt_event_t event, rt_uint32_t set) {
+  host_cond_t *c = (host_cond_t *)event->impl;
+
+  pthread_mutex_lock(&c->mutex);
+  event->set |= set;
+  pthread_cond_broadcast(&c->cond);
+  pthread_mutex_unlock(&c->mutex);
+  return RT_EOK;
+}
+
+rt_err_t rt_event_recv(rt_event_t event, rt_uint32_t set, rt_uint8_t option,
+                       rt_int32_t timeout, rt_uint32_t *recved) {
+  host_cond_t *c = (host_cond_t *)event->impl;
+  uint64_t deadline = now_ms() + ((timeout > 0) ? (uint64_t)timeout : 0);
+  rt_err_t ret = RT_EOK;
+  int32_t left;
+
+  pthread_mutex_lock(&c->mutex);
+  while (1) {
+    if ((option & RT_EVENT_FLAG_AND) ? ((event->set & set) == set) : ((event->set & set) != 0)) {
+      break;
+    }
+    if (timeout == RT_WAITING_NO) {
+      ret = -RT_ETIMEOUT;
+      break;
+    }
+    left = (timeout < 0) ? -1 : (int32_t)(deadline - now_ms());
+    if ((timeout > 0) && ((left <= 0) || !cond_wait(c, left))) {
+      if ((event->set & set) == 0) {
+        ret = -RT_ETIMEOUT;
+        break;
+      }
+    } else if (timeout < 0) {
+      (void)cond_wait(c, -1);
+    }
+  }
+  if (ret == RT_EOK) {
+    if (recved != NULL) {
+      *recved = event->set & set;
+    }
+    if (option & RT_EVENT_FLAG_CLEAR) {
+      event->set &= ~set;
+    }
+  }
+  pthread_mutex_unlock(&c->mutex);
+  return ret;
+}
+
+rt_tick_t rt_tick_get(void) {
+  return HAL_GetTick();
+}
+
+rt_int32_t rt_tick_from_millisecond(rt_int32_t ms) {
+  return ms;
+}
+
+rt_err_t rt_thread_delay(rt_tick_t tick) {
+  sys_msleep(tick);
+  return RT_EOK;
+}
+
+rt_err_t rt_thread_mdelay(rt_int32_t ms) {
+  sys_msleep((u32_t)ms);
+  return RT_EOK;
+}
+
+int rt_kprintf(const char *fmt, ...) {
+  va_list args;
+  int ret;
+
+  va_start(args, fmt);
+  ret = vprintf(fmt, args);
+  va_end(args);
+  return ret;
+}
+
+/* LwIP sys ----------------------------------------------------------------- */
+sys_prot_t sys_arch_protect(void) {
+  pthread_once(&mutex_once, mutex_init);
+  pthread_mutex_lock(&protect_mutex);
+  return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t lev) {
+  (void)lev;
+  pthread_mutex_unlock(&protect_mutex);
+}
+
+void sys_lock_tcpip_core(void) {
+  pthread_once(&mutex_once, mutex_init);
+  pthread_mutex_lock(&core_mutex);
+}
+
+void sys_unlock_tcpip_core(void) {
+  pthread_mutex_unlock(&core_mutex);
+}
+
+void sys_msleep(u32_t ms) {
+  struct timespec ts;
+
+  ts.tv_sec = ms / 1000U;
+  ts.tv_nsec = (long)(ms % 1000U) * 1000000L;
+  while (nanosleep(&ts, &ts) != 0) {
+  }
+}
+
+sys_thread_t sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio) {
+  struct host_thread *t = (struct host_thread *)malloc(sizeof(struct host_thread));
+
+  (void)name;
+  (void)stacksize;
+  (void)prio;
+  if (t == NULL) {
+    return NULL;
+  }
+  t->fn = thread;
+  t->arg = arg;
+  if (pthread_create(&t->id, NULL, thread_entry, t) != 0) {
+    free(t);
+    return NULL;
+  }
+  pthread_detach(t->id);
+  return t;
+}
+
+err_t sys_sem_new(sys_sem_t *sem, u8_t count) {
+  struct host_sem *s = (struct host_sem *)malloc(sizeof(struct host_sem));
+
+  if (s == NULL) {
+    return ERR_MEM;
+  }
+  cond_init(&s->c);
+  s->count = count;
+  *sem = s;
+  return ERR_OK;
+}
+
+void sys_sem_signal(sys_sem_t *sem) {
+  struct host_sem *s = *sem;
+
+  pthread_mutex_lock(&s->c.mutex);
+  s->count++;
+  pthread_cond_signal(&s->c.cond);
+  pthread_mutex_unlock(&s->c.mutex);
+}
+
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout) {
+  struct host_sem *s = *sem;
+  uint64_t start = now_ms();
+  int32_t left;
+
+  pthread_mutex_lock(&s->c.mutex);
+  while (s->count == 0) {
+    left = (timeout == 0) ? -1 : (int32_t)(start + timeout - now_ms());
+    if ((timeout != 0) && ((left <= 0) || !cond_wait(&s->c, left))) {
+      if (s->count == 0) {
+        pthread_mutex_unlock(&s->c.mutex);
+        return SYS_ARCH_TIMEOUT;
+      }
+    } else if (timeout == 0) {
+      (void)cond_wait(&s->c, -1);
+    }
+  }
+  s->count--;
+  pthread_mutex_unlock(&s->c.mutex);
+  return (u32_t)(now_ms() - start);
+}
+
+void sys_sem_free(sys_sem_t *sem) {
+  free(*sem);
+  *sem = NULL;
+}
+
+} /* extern "C" */
@@ -0,0 +1,218 @@
+/***************************************************************************//**
+ * @file    test_phy.cpp
+ * @brief   Host build: PHY probe and PHY state machine tests
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * Runs ethernetif_phy_probe() and ethernetif_phy_step() against the MDIO
+ * register model of each supported PHY. The driver keeps its state in static
+ * variables, so each case runs in its own process.
+ ******************************************************************************/
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "host_lwip.h"
+#include "eth_model.h"
+#include "ethernetif.h"
+#include "ethernetif_phy.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    exit(1); \
+  } \
+} while (0)
+
+/* PHY state machine runs at most this many MDIO operations per check */
+#define PHY_STEP_MAX          16U
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t phy_kinds[] = {
+  ETH_MODEL_PHY_LAN8742A, ETH_MODEL_PHY_DP83848, ETH_MODEL_PHY_KSZ8081,
+};
+static const ethernetif_phy_ops_t *const phy_ops[] = {
+  &ethernetif_phy_lan8742a, &ethernetif_phy_dp83848, &ethernetif_phy_ksz8081,
+};
+static uint32_t link_up_cnt;
+static uint32_t link_down_cnt;
+extern struct netif gnetif;
+
+/* Private functions ---------------------------------------------------------*/
+static void link_changed(struct netif *netif) {
+  if (netif_is_link_up(netif)) {
+    link_up_cnt++;
+  } else {
+    link_down_cnt++;
+  }
+  ethernetif_update_config(netif);
+}
+
+/* Initialize the driver on a PHY, return 1 if the link is up at once */
+static uint8_t driver_start(uint32_t kind, uint8_t link, uint8_t an_done, uint8_t speed_100m, uint8_t full_duplex) {
+  eth_model_reset();
+  eth_model_phy_config(kind, link, an_done, speed_100m, full_duplex);
+  ethernetif_event_init();
+  CHECK(netif_add(&gnetif, NULL, NULL, NULL, NULL, ethernetif_init, tcpip_input) != NULL);
+  netif_set_link_callback(&gnetif, link_changed);
+  return netif_is_link_up(&gnetif) ? 1 : 0;
+}
+
+/* Check the link as ethernet thread does, one MDIO operation per step */
+static void phy_check(void) {
+  uint32_t i;
+
+  ethernetif_set_link(&gnetif);
+  for (i = 0; i < PHY_STEP_MAX; i++) {
+    if (ethernetif_phy_step(&gnetif) == ETH_WAIT_FOREVER) {
+      return;
+    }
+    eth_model_step(ETH_MODEL_MDIO_NS);
+  }
+  CHECK(0);
+}
+
+static void test_probe_id(void) {
+  ETH_HandleTypeDef heth;
+  uint32_t i;
+
+  memset(&heth, 0, sizeof(heth));
+  heth.Instance = ETH;
+  heth.Init.PhyAddress = LAN8742A_PHY_ADDRESS;
+  for (i = 0; i < (sizeof(phy_kinds) / sizeof(phy_kinds[0])); i++) {
+    eth_model_reset();
+    eth_model_phy_config(phy_kinds[i], 1, 1, 1, 1);
+    CHECK(ethernetif_phy_probe(&heth, ETH_PHY_AUTO) == phy_ops[i]);
+    /* ID without revision number */
+    CHECK(((((uint32_t)eth_model_phy_peek(ETH_PHY_IDR1) << 16) | eth_model_phy_peek(ETH_PHY_IDR2)) &
+           ETH_PHY_ID_MASK) == phy_ops[i]->id);
+    /* A configured PHY is not probed */
+    CHECK(ethernetif_phy_probe(&heth, ETH_PHY_LAN8742A + i) == phy_ops[i]);
+  }
+}
+
+static void test_probe_unknown(void) {
+  ETH_HandleTypeDef heth;
+
+  memset(&heth, 0, sizeof(heth));
+  heth.Instance = ETH;
+  eth_model_reset();
+  eth_model_phy_config(ETH_MODEL_PHY_UNKNOWN, 1, 1, 1, 1);
+  CHECK(ethernetif_phy_probe(&heth, ETH_PHY_AUTO) == &ethernetif_phy_lan8742a);
+}
+
+/* The state machine never waits for MDIO */
+static void test_step_async(void) {
+  uint32_t mdio;
+
+  CHECK(driver_start(ETH_MODEL_PHY_LAN8742A, 1, 1, 1, 1));
+  ethernetif_set_link(&gnetif);
+  CHECK(ethernetif_phy_step(&gnetif) != ETH_WAIT_FOREVER);
+  mdio = eth_model_mdio_count();
+  CHECK(ethernetif_phy_step(&gnetif) != ETH_WAIT_FOREVER);
+  CHECK(ethernetif_phy_step(&gnetif) != ETH_WAIT_FOREVER);
+  CHECK(eth_model_mdio_count() == mdio);
+  eth_model_step(ETH_MODEL_MDIO_NS);
+  CHECK(ethernetif_phy_step(&gnetif) != ETH_WAIT_FOREVER);
+  CHECK(eth_model_mdio_count() == (mdio + 1));
+}
+
+/* Link up without auto-negotiation done: stays down until it's done */
+static void test_autoneg_pending(uint32_t kind) {
+  CHECK(!driver_start(kind, 1, 0, 1, 1));
+  phy_check();
+  CHECK(!netif_is_link_up(&gnetif));
+  CHECK(link_up_cnt == 0);
+
+  eth_model_phy_link(1);
+  phy_check();
+  CHECK(netif_is_link_up(&gnetif));
+  CHECK(link_up_cnt == 1);
+  CHECK(ethernetif_get_link_config() == (ETH_LINK_CONFIG_VALID | ETH_LINK_CONFIG_100M | ETH_LINK_CONFIG_FULL));
+}
+
+/* Link lost and back between two checks: only the PHY interrupt flag tells */
+static void test_link_down_irq(uint32_t kind) {
+  CHECK(driver_start(kind, 1, 1, 1, 1));
+  phy_check();
+  CHECK(netif_is_link_up(&gnetif));
+
+  eth_model_phy_link(0);
+  eth_model_phy_link(1);
+  CHECK(eth_model_phy_peek(PHY_BSR) & PHY_LINKED_STATUS);
+  phy_check();
+  CHECK(link_down_cnt == 1);
+  CHECK(link_up_cnt == 1);
+  CHECK(netif_is_link_up(&gnetif));
+
+  /* Flag cleared by reading it */
+  phy_check();
+  CHECK(link_down_cnt == 1);
+
+  eth_model_phy_link(0);
+  phy_check();
+  CHECK(!netif_is_link_up(&gnetif));
+  CHECK(link_down_cnt == 2);
+}
+
+/* Speed and duplex mode from the vendor status register */
+static void test_10m_half(uint32_t kind) {
+  CHECK(!driver_start(kind, 0, 0, 0, 0));
+  eth_model_phy_link(1);
+  phy_check();
+  CHECK(netif_is_link_up(&gnetif));
+  CHECK(ethernetif_get_link_config() == ETH_LINK_CONFIG_VALID);
+  CHECK(!(ETH->MACCR & ETH_MACCR_FES));
+  CHECK(!(ETH->MACCR & ETH_MACCR_DM));
+}
+
+static void test_100m_full(uint32_t kind) {
+  CHECK(!driver_start(kind, 0, 0, 1, 1));
+  eth_model_phy_link(1);
+  phy_check();
+  CHECK(netif_is_link_up(&gnetif));
+  CHECK(ethernetif_get_link_config() == (ETH_LINK_CONFIG_VALID | ETH_LINK_CONFIG_100M | ETH_LINK_CONFIG_FULL));
+  CHECK(ETH->MACCR & ETH_MACCR_FES);
+  CHECK(ETH->MACCR & ETH_MACCR_DM);
+}
+
+static int run(const char *name, void (*test)(uint32_t), uint32_t kind) {
+  pid_t pid;
+  int status;
+
+  fflush(stdout);
+  pid = fork();
+  if (pid == 0) {
+    test(kind);
+    exit(0);
+  }
+  (void)waitpid(pid, &status, 0);
+  status = (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) ? 0 : 1;
+  printf("%s %s\n", status ? "FAIL" : "ok  ", name);
+  return status;
+}
+
+/* Exported functions ------------------------------------------------------- */
+int main(void) {
+  static const char *const names[] = { "LAN8742A", "DP83848", "KSZ8081" };
+  char name[64];
+  int fail = 0;
+  uint32_t i;
+
+  fail += run("probe ID", [](uint32_t) { test_probe_id(); }, 0);
+  fail += run("probe unknown ID", [](uint32_t) { test_probe_unknown(); }, 0);
+  fail += run("step without waiting MDIO", [](uint32_t) { test_step_async(); }, 0);
+  for (i = 0; i < (sizeof(phy_kinds) / sizeof(phy_kinds[0])); i++) {
+    snprintf(name, sizeof(name), "%s: auto-negotiation not done", names[i]);
+    fail += run(name, test_autoneg_pending, phy_kinds[i]);
+    snprintf(name, sizeof(name), "%s: link down by IRQ flag", names[i]);
+    fail += run(name, test_link_down_irq, phy_kinds[i]);
+    snprintf(name, sizeof(name), "%s: 10M half duplex", names[i]);
+    fail += run(name, test_10m_half, phy_kinds[i]);
+    snprintf(name, sizeof(name), "%s: 100M full duplex", names[i]);
+    fail += run(name, test_100m_full, phy_kinds[i]);
+  }
+  printf("%d failed\n", fail);
+  return fail ? 1 : 0;
+}
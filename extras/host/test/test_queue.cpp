@@ -0,0 +1,336 @@
+/***************************************************************************//**
+ * @file    test_queue.cpp
+ * @brief   Host build: spsc_queue and received data stress tests, benchmark
+ * @author  onelife <onelife.real[at]gmail.com>
+ *
+ * - spsc_queue: a producer and a consumer thread pass a counting sequence,
+ *   single and batched, checked in order and without loss
+ * - TCP received data: tcpip_thread (producer) passes chained "pbuf" of a
+ *   byte sequence to tcp_recv_callback() of an accepted client, as LwIP
+ *   does, retrying the refused ones. The reader (consumer) takes them by
+ *   stm32_get_data() and stm32_borrow_data() / stm32_release_data(), checks
+ *   the sequence, and that "available" never counts more than what is queued
+ * - Benchmark: queue operations and received data throughput
+ ******************************************************************************/
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "host_lwip.h"
+#include "host_cycles.h"
+#include "queue.h"
+#include "stm32_eth.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    exit(1); \
+  } \
+} while (0)
+
+#define QUEUE_ITEMS           (1000U * 1000U)
+#define DATA_BYTES            (16U * 1024U * 1024U)
+/* Largest "pbuf" passed to tcp_recv_callback(), chained from several ones */
+#define SEG_MAX               4000U
+#define BENCH_OPS             (10U * 1000U * 1000U)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef spsc_queue<uint32_t, 250> test_queue_t;
+
+typedef struct {
+  struct tcp_struct *client;
+  struct tcp_pcb *pcb;
+  uint32_t bytes;
+  uint32_t refused;
+  uint32_t max_available;
+  double sec;
+} data_test_t;
+
+/* Private variables ---------------------------------------------------------*/
+static test_queue_t queue;
+
+/* Private functions ---------------------------------------------------------*/
+static double wall_time(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* xorshift, one per thread */
+static uint32_t rand_next(uint32_t *state) {
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static uint8_t seq_byte(uint32_t i) {
+  return (uint8_t)(i % 251U);
+}
+
+/* spsc_queue ------------------------------------------------------------- */
+static void *queue_producer(void *arg) {
+  uint32_t seed = 1;
+  uint32_t items[16];
+  uint32_t next = 0;
+  uint32_t n;
+  uint32_t i;
+  (void)arg;
+
+  while (next < QUEUE_ITEMS) {
+    if (queue.is_full()) {
+      /* Let the consumer run, even on one CPU */
+      sched_yield();
+    } else if (rand_next(&seed) & 1) {
+      if (queue.put(next)) {
+        next++;
+      }
+    } else {
+      n = 1 + (rand_next(&seed) % 16U);
+      if (n > (QUEUE_ITEMS - next)) {
+        n = QUEUE_ITEMS - next;
+      }
+      for (i = 0; i < n; i++) {
+        items[i] = next + i;
+      }
+      next += queue.put_n(items, n);
+    }
+  }
+  return NULL;
+}
+
+static void test_queue_threads(void) {
+  pthread_t producer;
+  uint32_t seed = 2;
+  uint32_t items[16];
+  uint32_t expect = 0;
+  uint32_t count;
+  uint32_t n;
+  uint32_t i;
+
+  queue.init();
+  CHECK(test_queue_t::capacity == 256);
+  CHECK(pthread_create(&producer, NULL, queue_producer, NULL) == 0);
+  while (expect < QUEUE_ITEMS) {
+    count = queue.count();
+    CHECK(count <= test_queue_t::capacity);
+    if (count == 0) {
+      sched_yield();
+    } else if (rand_next(&seed) & 1) {
+      if (!queue.is_empty()) {
+        CHECK(queue.get() == expect);
+        expect++;
+      }
+    } else {
+      n = queue.get_n(items, 1 + (rand_next(&seed) % 16U));
+      for (i = 0; i < n; i++) {
+        CHECK(items[i] == expect);
+        expect++;
+      }
+    }
+  }
+  pthread_join(producer, NULL);
+  CHECK(queue.is_empty());
+  CHECK(queue.get() == 0);
+}
+
+/* Received data ---------------------------------------------------------- */
+static struct pbuf *data_segment(uint32_t start, uint32_t len) {
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)len, PBUF_POOL);
+  struct pbuf *q;
+  uint32_t i = start;
+  uint32_t j;
+
+  if (p == NULL) {
+    return NULL;
+  }
+  for (q = p; q != NULL; q = q->next) {
+    for (j = 0; j < q->len; j++) {
+      ((uint8_t *)q->payload)[j] = seq_byte(i++);
+    }
+  }
+  return p;
+}
+
+/* tcpip_thread */
+static void *data_producer(void *arg) {
+  data_test_t *test = (data_test_t *)arg;
+  uint32_t seed = 3;
+  uint32_t sent = 0;
+  uint32_t len;
+  struct pbuf *p;
+  err_t err;
+
+  while (sent < test->bytes) {
+    len = 1 + (rand_next(&seed) % SEG_MAX);
+    if (len > (test->bytes - sent)) {
+      len = test->bytes - sent;
+    }
+    p = data_segment(sent, len);
+    if (p == NULL) {
+      /* Pool empty: reader still holds them */
+      sched_yield();
+      continue;
+    }
+    while (1) {
+      LOCK_TCPIP_CORE();
+      err = test->pcb->recv(test->pcb->callback_arg, test->pcb, p, ERR_OK);
+      UNLOCK_TCPIP_CORE();
+      if (err == ERR_OK) {
+        break;
+      }
+      /* Refused: LwIP passes it again later */
+      CHECK(err == ERR_MEM);
+      test->refused++;
+      sched_yield();
+    }
+    sent += len;
+  }
+  return NULL;
+}
+
+/* Application thread */
+static void data_consume(data_test_t *test) {
+  struct pbuf_data *data = &test->client->data;
+  const uint8_t *buf;
+  uint8_t copy[SEG_MAX];
+  uint32_t seed = 4;
+  uint32_t got = 0;
+  uint32_t available;
+  uint16_t n;
+  uint16_t i;
+
+  while (got < test->bytes) {
+    /* Never more than what is queued, nor wrapped below zero */
+    available = __atomic_load_n(&data->available, __ATOMIC_RELAXED);
+    CHECK(available <= ((test->pcb->recved - got) + SEG_MAX));
+    if (available > test->max_available) {
+      test->max_available = available;
+    }
+    if (available == 0) {
+      sched_yield();
+      continue;
+    }
+
+    switch (rand_next(&seed) % 3U) {
+      case 0:
+        n = stm32_borrow_data(data, &buf);
+        if (n == 0) {
+          break;
+        }
+        n = 1 + (rand_next(&seed) % n);
+        for (i = 0; i < n; i++) {
+          CHECK(buf[i] == seq_byte(got + i));
+        }
+        CHECK(stm32_release_data(data, n) == n);
+        got += n;
+        break;
+      case 1:
+        n = stm32_get_data(data, copy, 1 + (rand_next(&seed) % sizeof(copy)));
+        for (i = 0; i < n; i++) {
+          CHECK(copy[i] == seq_byte(got + i));
+        }
+        got += n;
+        break;
+      default:
+        n = stm32_get_data(data, copy, 1);
+        if (n) {
+          CHECK(copy[0] == seq_byte(got));
+          got++;
+        }
+        break;
+    }
+  }
+  CHECK(got == test->bytes);
+}
+
+static void data_run(data_test_t *test, uint32_t bytes) {
+  static struct tcp_struct *clients[MAX_CLIENT];
+  static struct tcp_pcb pcb;
+  pthread_t producer;
+  double start;
+
+  memset(clients, 0, sizeof(clients));
+  memset(&pcb, 0, sizeof(pcb));
+  memset(test, 0, sizeof(*test));
+  CHECK(tcp_accept_callback(clients, &pcb, ERR_OK) == ERR_OK);
+  CHECK(clients[0] != NULL);
+  CHECK(pcb.recv != NULL);
+  test->client = clients[0];
+  test->pcb = &pcb;
+  test->bytes = bytes;
+
+  start = wall_time();
+  CHECK(pthread_create(&producer, NULL, data_producer, test) == 0);
+  data_consume(test);
+  pthread_join(producer, NULL);
+  test->sec = wall_time() - start;
+
+  CHECK(test->client->data.available == 0);
+  CHECK(test->client->data.p == NULL);
+  CHECK(test->client->data.pbuf_queue.is_empty());
+  CHECK(pcb.recved == bytes);
+  CHECK(host_pbuf_used() == 0);
+  mem_free(test->client);
+}
+
+static void test_data_threads(void) {
+  data_test_t test;
+
+  data_run(&test, DATA_BYTES);
+  printf("  %u bytes, %u refused, available up to %u\n", test.bytes, test.refused, test.max_available);
+}
+
+/* Benchmark -------------------------------------------------------------- */
+static void bench_queue(void) {
+  uint64_t start;
+  uint32_t items[16];
+  uint32_t sum = 0;
+  uint32_t i;
+
+  queue.init();
+  start = host_cycles();
+  for (i = 0; i < BENCH_OPS; i++) {
+    (void)queue.put(i);
+    sum += queue.get();
+  }
+  printf("  put + get: %.1f cycles\n", (double)(host_cycles() - start) / BENCH_OPS);
+
+  for (i = 0; i < 16; i++) {
+    items[i] = i;
+  }
+  start = host_cycles();
+  for (i = 0; i < (BENCH_OPS / 16); i++) {
+    (void)queue.put_n(items, 16);
+    sum += queue.get_n(items, 16);
+  }
+  printf("  put_n + get_n of 16: %.1f cycles/item\n", (double)(host_cycles() - start) / BENCH_OPS);
+  CHECK(sum != 0);
+}
+
+static void bench_data(void) {
+  data_test_t test;
+
+  data_run(&test, DATA_BYTES);
+  printf("  received data, 2 threads: %.0f MB/s\n", test.bytes / test.sec / 1e6);
+}
+
+/* Exported functions ------------------------------------------------------- */
+int main(void) {
+  printf("spsc_queue, 2 threads\n");
+  test_queue_threads();
+  printf("TCP received data, 2 threads\n");
+  test_data_threads();
+  printf("Benchmark\n");
+  bench_queue();
+  bench_data();
+  printf("0 failed\n");
+  return 0;
+}
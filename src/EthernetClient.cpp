@@ -15,19 +15,20 @@ extern "C" {
 #include <log.h>
 
 EthernetClient::EthernetClient()
-  : _tcp_client(NULL)
+  : _tcp_client(NULL), _priority(0)
 {
 }
 
 /* Deprecated constructor. Keeps compatibility with W5100 architecture
 sketches but sock is ignored. */
 EthernetClient::EthernetClient(uint8_t sock)
-  : _tcp_client(NULL)
+  : _tcp_client(NULL), _priority(0)
 {
   UNUSED(sock);
 }
 
 EthernetClient::EthernetClient(struct tcp_struct *tcpClient)
+  : _priority(0)
 {
   _tcp_client = tcpClient;
 }
@@ -68,13 +69,14 @@ int EthernetClient::connect(IPAddress ip, uint16_t port)
   _tcp_client->data.p = NULL;
   _tcp_client->data.available = 0;
   _tcp_client->data.offset = 0;
-  queue_init(_tcp_client->data.pbuf_queue, _tcp_client->data._pbuf_queue);
+  _tcp_client->data.pbuf_queue.init();
   _tcp_client->is_accept = 0;
   _tcp_client->state = TCP_NONE;
 
   ip_addr_t ipaddr;
   err_t ret;
   LOCK_TCPIP_CORE();
+  _tcp_client->pcb->tos = ETH_TX_PRIO_TOS(_priority);
   tcp_arg(_tcp_client->pcb, _tcp_client);
   ret = tcp_connect(_tcp_client->pcb, u8_to_ip_addr(rawIPAddress(ip), &ipaddr), port, &tcp_connected_callback);
   UNLOCK_TCPIP_CORE();
@@ -118,35 +120,64 @@ size_t EthernetClient::write(const uint8_t *buf, size_t size)
   size_t max_send_size, bytes_to_send;
   size_t bytes_sent = 0;
   size_t bytes_left = size;
+  u16_t mss;
+  u8_t flags;
   err_t res;
 
+  /* Each pass queues what fits in send buffer, lwIP splits it into MSS
+  segments and builds the frames in tcp_output() */
   do {
+    LOCK_TCPIP_CORE();
+    /* The connection may be closed or reset while the lock is released */
+    if ((_tcp_client->pcb == NULL) ||
+        ((_tcp_client->state != TCP_ACCEPTED) &&
+         (_tcp_client->state != TCP_CONNECTED))) {
+      UNLOCK_TCPIP_CORE();
+      return bytes_sent;
+    }
     max_send_size = tcp_sndbuf(_tcp_client->pcb);
     bytes_to_send = bytes_left > max_send_size ? max_send_size : bytes_left;
+    flags = TCP_WRITE_FLAG_COPY;
+    if (bytes_to_send < bytes_left) {
+      /* Not all fits: keep segments full sized and unpushed, the rest waits
+      for ACK */
+      mss = tcp_mss(_tcp_client->pcb);
+      if (bytes_to_send > mss) {
+        bytes_to_send -= bytes_to_send % mss;
+      }
+      flags |= TCP_WRITE_FLAG_MORE;
+    }
 
     if (bytes_to_send > 0) {
-      LOCK_TCPIP_CORE();
-      res = tcp_write(_tcp_client->pcb, &buf[bytes_sent], bytes_to_send, TCP_WRITE_FLAG_COPY);
-      UNLOCK_TCPIP_CORE();
+      res = tcp_write(_tcp_client->pcb, &buf[bytes_sent], bytes_to_send, flags);
       if (res == ERR_OK) {
         bytes_sent += bytes_to_send;
         bytes_left = size - bytes_sent;
-      } else if (res != ERR_MEM) {
+      } else if (res == ERR_MEM) {
+        // send queue full, retry after ACK
+        bytes_to_send = 0;
+      } else {
         // other error, cannot continue
+        UNLOCK_TCPIP_CORE();
         LOG_E("Write err %d", res);
         return 0;
       }
     }
 
-    //Force to send data right now!
-    LOCK_TCPIP_CORE();
+    //Force to send data right now! Frames go to DMA with one TX poll demand
+    stm32_eth_tx_more(1);
     res = tcp_output(_tcp_client->pcb);
+    stm32_eth_tx_more(0);
     UNLOCK_TCPIP_CORE();
     if (ERR_OK != res) {
       LOG_E("Output err");
       return 0;
     }
 
+    if ((bytes_to_send == 0) && (bytes_sent != size)) {
+      /* Send buffer full, let tcpip_thread process ACK */
+      sys_msleep(1);
+    }
   } while (bytes_sent != size);
 
   return size;
@@ -163,8 +194,7 @@ int EthernetClient::available()
 int EthernetClient::read()
 {
   uint8_t b;
-  if ((_tcp_client != NULL) && (_tcp_client->data.p != NULL)) {
-    stm32_get_data(&(_tcp_client->data), &b, 1);
+  if ((_tcp_client != NULL) && (stm32_get_data(&(_tcp_client->data), &b, 1) == 1)) {
     return b;
   }
   // No data available
@@ -173,21 +203,51 @@ int EthernetClient::read()
 
 int EthernetClient::read(uint8_t *buf, size_t size)
 {
-  if ((_tcp_client != NULL) && (_tcp_client->data.p != NULL)) {
+  if ((_tcp_client != NULL) && (_tcp_client->data.available != 0)) {
     return stm32_get_data(&(_tcp_client->data), buf, size);
   }
   return -1;
 }
 
+int EthernetClient::borrow(const uint8_t **buf)
+{
+  if (_tcp_client != NULL) {
+    uint16_t len = stm32_borrow_data(&(_tcp_client->data), buf);
+    if (len > 0) {
+      return len;
+    }
+  }
+  return -1;
+}
+
+void EthernetClient::release(size_t size)
+{
+  if (_tcp_client != NULL) {
+    stm32_release_data(&(_tcp_client->data), size);
+  }
+}
+
+void EthernetClient::setPriority(uint8_t prio)
+{
+  _priority = (prio > ETH_TX_PRIO_HIGH) ? ETH_TX_PRIO_HIGH : prio;
+  if ((_tcp_client != NULL) && (_tcp_client->pcb != NULL)) {
+    LOCK_TCPIP_CORE();
+    _tcp_client->pcb->tos = ETH_TX_PRIO_TOS(_priority);
+    UNLOCK_TCPIP_CORE();
+  }
+}
+
 int EthernetClient::peek()
 {
-  uint8_t b;
+  const uint8_t *b;
   // Unlike recv, peek doesn't check to see if there's any data available, so we must
   if (!available()) {
     return -1;
   }
-  b = pbuf_get_at(_tcp_client->data.p, 0);
-  return b;
+  if (stm32_borrow_data(&(_tcp_client->data), &b) == 0) {
+    return -1;
+  }
+  return b[0];
 }
 
 void EthernetClient::flush()
@@ -22,6 +22,14 @@ class EthernetClient : public Client {
     virtual int read();
     virtual int read(uint8_t *buf, size_t size);
     virtual int peek();
+    // Zero-copy read: lend the next contiguous segment of received data,
+    // valid until release(). Returns segment length, or -1 if no data.
+    int borrow(const uint8_t **buf);
+    // Consume "size" bytes of the borrowed segment
+    void release(size_t size);
+    // Send in TX priority class "prio" (0 to ETH_TX_PRIO_HIGH), by the IP
+    // precedence of the connection
+    void setPriority(uint8_t prio);
     virtual void flush();
     virtual void stop();
     virtual uint8_t connected();
@@ -59,6 +67,7 @@ class EthernetClient : public Client {
 
   private:
     struct tcp_struct *_tcp_client;
+    uint8_t _priority;
 };
 
 #endif
@@ -0,0 +1,355 @@
+/***************************************************************************//**
+ * @file    EthernetPtp.cpp
+ * @brief   Arduino RTT-Ethernet library IEEE 1588 (PTP) slave clock
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#include "RttEthernet.h"
+#include "EthernetPtp.h"
+
+#if ETH_PTP
+
+#define PTP_NS_PER_SEC      1000000000LL
+#define PTP_VERSION         2
+#define PTP_HEADER_LEN      34
+#define PTP_TIMESTAMP_LEN   10
+#define PTP_DELAY_REQ_LEN   (PTP_HEADER_LEN + PTP_TIMESTAMP_LEN)
+#define PTP_DELAY_RESP_LEN  (PTP_HEADER_LEN + PTP_TIMESTAMP_LEN + 10)
+#define PTP_MSG_BUF_SIZE    64
+
+/* Message types */
+#define PTP_SYNC            0x0
+#define PTP_DELAY_REQ       0x1
+#define PTP_FOLLOW_UP       0x8
+#define PTP_DELAY_RESP      0x9
+
+/* Header fields */
+#define PTP_OFFSET_DOMAIN   4
+#define PTP_OFFSET_FLAGS    6
+#define PTP_OFFSET_CORR     8
+#define PTP_OFFSET_SOURCE   20
+#define PTP_OFFSET_SEQ      30
+#define PTP_OFFSET_CONTROL  32
+#define PTP_OFFSET_INTERVAL 33
+#define PTP_FLAG_TWO_STEP   0x02
+
+/* PI servo gains in 1/10, for Sync interval of about 1 s */
+#define PTP_SERVO_KP        7
+#define PTP_SERVO_KI        3
+
+/* Re-send Delay_Req if no response */
+#define PTP_DELAY_REQ_TIMEOUT 2000
+
+static const IPAddress ptp_multicast(224, 0, 1, 129);
+
+static int64_t ptp_ns(uint32_t sec, uint32_t nsec)
+{
+  return (int64_t)sec * PTP_NS_PER_SEC + nsec;
+}
+
+static uint16_t ptp_get16(const uint8_t *p)
+{
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+
+/* 48-bit seconds and 32-bit nanoseconds, big endian */
+static int64_t ptp_get_timestamp(const uint8_t *p)
+{
+  uint64_t sec = 0;
+  uint32_t nsec = 0;
+  int i;
+
+  for (i = 0; i < 6; i++) {
+    sec = (sec << 8) | p[i];
+  }
+  for (i = 6; i < 10; i++) {
+    nsec = (nsec << 8) | p[i];
+  }
+  return (int64_t)sec * PTP_NS_PER_SEC + nsec;
+}
+
+/* Correction field in ns multiplied by 2^16 */
+static int64_t ptp_get_correction(const uint8_t *msg)
+{
+  uint64_t corr = 0;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    corr = (corr << 8) | msg[PTP_OFFSET_CORR + i];
+  }
+  return (int64_t)corr / 65536;
+}
+
+/* Read a whole packet, and return its RX time stamp (-1 if not available) */
+static int ptp_receive(EthernetUDP &udp, uint8_t *msg, int64_t *rx)
+{
+  uint8_t dummy[16];
+  uint32_t sec, nsec;
+  int len;
+
+  if (udp.parsePacket() <= 0) {
+    return 0;
+  }
+  *rx = udp.rxTimestamp(sec, nsec) ? ptp_ns(sec, nsec) : -1;
+  len = udp.read(msg, PTP_MSG_BUF_SIZE);
+  /* Drop the rest */
+  while (udp.available() > 0) {
+    udp.read(dummy, sizeof(dummy));
+  }
+  return len;
+}
+
+EthernetPTP::EthernetPTP() : _domain(0), _hasMaster(false), _syncPending(false),
+  _delayReqSeq(0), _delayReqPending(false), _delayValid(false), _offset(0),
+  _integral(0), _synced(false)
+{
+}
+
+uint8_t EthernetPTP::begin(uint8_t domain)
+{
+  uint8_t *mac = Ethernet.MACAddress();
+
+  if (!_event.beginMulticast(ptp_multicast, PTP_EVENT_PORT) ||
+      !_general.beginMulticast(ptp_multicast, PTP_GENERAL_PORT)) {
+    stop();
+    return 0;
+  }
+
+  /* Clock identity EUI-64 from MAC address, port number 1 */
+  _portId[0] = mac[0];
+  _portId[1] = mac[1];
+  _portId[2] = mac[2];
+  _portId[3] = 0xFF;
+  _portId[4] = 0xFE;
+  _portId[5] = mac[3];
+  _portId[6] = mac[4];
+  _portId[7] = mac[5];
+  _portId[8] = 0;
+  _portId[9] = 1;
+
+  _domain = domain;
+  _hasMaster = false;
+  _syncPending = false;
+  _delayReqPending = false;
+  _delayValid = false;
+  _integral = 0;
+  _synced = false;
+  return 1;
+}
+
+void EthernetPTP::stop()
+{
+  _event.stop();
+  _general.stop();
+  _hasMaster = false;
+  _synced = false;
+}
+
+int EthernetPTP::maintain()
+{
+  uint8_t msg[PTP_MSG_BUF_SIZE];
+  int64_t rx;
+  int len;
+  int ret = 0;
+
+  len = ptp_receive(_event, msg, &rx);
+  if ((len >= PTP_HEADER_LEN) && (rx >= 0)) {
+    ret |= handleEvent(msg, len, rx);
+  }
+  len = ptp_receive(_general, msg, &rx);
+  if (len >= PTP_HEADER_LEN) {
+    ret |= handleGeneral(msg, len);
+  }
+
+  if (_delayReqPending && ((millis() - _delayReqTime) >= PTP_DELAY_REQ_TIMEOUT)) {
+    _delayReqPending = false;
+  }
+  return ret;
+}
+
+bool EthernetPTP::synchronized()
+{
+  return _synced;
+}
+
+int32_t EthernetPTP::offset()
+{
+  if (_offset > INT32_MAX) {
+    return INT32_MAX;
+  } else if (_offset < INT32_MIN) {
+    return INT32_MIN;
+  }
+  return (int32_t)_offset;
+}
+
+uint32_t EthernetPTP::delay()
+{
+  return _delayValid ? (uint32_t)_delay : 0;
+}
+
+void EthernetPTP::time(uint32_t &sec, uint32_t &nsec)
+{
+  ethernetif_timestamp_t ts;
+
+  ethernetif_ptp_get_time(&ts);
+  sec = ts.sec;
+  nsec = ts.nsec;
+}
+
+int EthernetPTP::handleEvent(const uint8_t *msg, int len, int64_t rx)
+{
+  if (((msg[0] & 0x0F) != PTP_SYNC) || ((msg[1] & 0x0F) != PTP_VERSION) ||
+      (msg[PTP_OFFSET_DOMAIN] != _domain)) {
+    return 0;
+  }
+
+  /* Follow the first master heard */
+  if (!_hasMaster) {
+    memcpy(_masterId, &msg[PTP_OFFSET_SOURCE], sizeof(_masterId));
+    _hasMaster = true;
+  } else if (memcmp(_masterId, &msg[PTP_OFFSET_SOURCE], sizeof(_masterId))) {
+    return 0;
+  }
+
+  _syncSeq = ptp_get16(&msg[PTP_OFFSET_SEQ]);
+  _syncCorr = ptp_get_correction(msg);
+  _t2 = rx;
+  if (msg[PTP_OFFSET_FLAGS] & PTP_FLAG_TWO_STEP) {
+    _syncPending = true;
+    return 0;
+  }
+
+  /* One-step: origin time stamp in Sync */
+  _syncPending = false;
+  if (len < (PTP_HEADER_LEN + PTP_TIMESTAMP_LEN)) {
+    return 0;
+  }
+  _t1 = ptp_get_timestamp(&msg[PTP_HEADER_LEN]) + _syncCorr;
+  return syncDone();
+}
+
+int EthernetPTP::handleGeneral(const uint8_t *msg, int len)
+{
+  uint8_t type = msg[0] & 0x0F;
+
+  if (((msg[1] & 0x0F) != PTP_VERSION) || (msg[PTP_OFFSET_DOMAIN] != _domain) ||
+      !_hasMaster || memcmp(_masterId, &msg[PTP_OFFSET_SOURCE], sizeof(_masterId))) {
+    return 0;
+  }
+
+  if (type == PTP_FOLLOW_UP) {
+    if (!_syncPending || (ptp_get16(&msg[PTP_OFFSET_SEQ]) != _syncSeq) ||
+        (len < (PTP_HEADER_LEN + PTP_TIMESTAMP_LEN))) {
+      return 0;
+    }
+    _syncPending = false;
+    _t1 = ptp_get_timestamp(&msg[PTP_HEADER_LEN]) + _syncCorr + ptp_get_correction(msg);
+    return syncDone();
+  }
+
+  if (type == PTP_DELAY_RESP) {
+    int64_t t4;
+    int64_t delay;
+
+    if (!_delayReqPending || (len < PTP_DELAY_RESP_LEN) ||
+        (ptp_get16(&msg[PTP_OFFSET_SEQ]) != _delayReqSeq) ||
+        memcmp(_portId, &msg[PTP_HEADER_LEN + PTP_TIMESTAMP_LEN], sizeof(_portId))) {
+      return 0;
+    }
+    _delayReqPending = false;
+    t4 = ptp_get_timestamp(&msg[PTP_HEADER_LEN]) - ptp_get_correction(msg);
+
+    /* Mean path delay, from the last Sync and this Delay_Req */
+    delay = ((_t2 - _t1) + (t4 - _t3)) / 2;
+    if (delay < 0) {
+      return 0;
+    }
+    if (_delayValid) {
+      _delay += (delay - _delay) / 8;
+    } else {
+      _delay = delay;
+      _delayValid = true;
+    }
+  }
+  return 0;
+}
+
+int EthernetPTP::syncDone()
+{
+  int ret = 0;
+
+  if (_delayValid) {
+    _offset = (_t2 - _t1) - _delay;
+    adjust(_offset);
+    ret = 1;
+  }
+  if (!_delayReqPending) {
+    sendDelayReq();
+  }
+  return ret;
+}
+
+void EthernetPTP::sendDelayReq()
+{
+  uint8_t msg[PTP_DELAY_REQ_LEN];
+  uint32_t sec, nsec;
+
+  memset(msg, 0, sizeof(msg));
+  msg[0] = PTP_DELAY_REQ;
+  msg[1] = PTP_VERSION;
+  msg[3] = PTP_DELAY_REQ_LEN;
+  msg[PTP_OFFSET_DOMAIN] = _domain;
+  memcpy(&msg[PTP_OFFSET_SOURCE], _portId, sizeof(_portId));
+  _delayReqSeq++;
+  msg[PTP_OFFSET_SEQ] = _delayReqSeq >> 8;
+  msg[PTP_OFFSET_SEQ + 1] = _delayReqSeq & 0xFF;
+  msg[PTP_OFFSET_CONTROL] = 1;
+  msg[PTP_OFFSET_INTERVAL] = 0x7F;
+
+  if (!_event.beginPacket(ptp_multicast, PTP_EVENT_PORT)) {
+    return;
+  }
+  _event.write(msg, sizeof(msg));
+  if (!_event.endPacket() || !_event.txTimestamp(sec, nsec)) {
+    return;
+  }
+  _t3 = ptp_ns(sec, nsec);
+  _delayReqPending = true;
+  _delayReqTime = millis();
+}
+
+void EthernetPTP::adjust(int64_t offset)
+{
+  int64_t ppb;
+
+  if ((offset > PTP_STEP_THRESHOLD) || (offset < -PTP_STEP_THRESHOLD)) {
+    /* Step, and measure path delay again with the new time */
+    (void)ethernetif_ptp_adjust_time(-offset);
+    _integral = 0;
+    _delayValid = false;
+    _delayReqPending = false;
+    _synced = false;
+    return;
+  }
+
+  /* PI servo: offset in ns per Sync interval is frequency error in ppb */
+  _integral += offset * PTP_SERVO_KI / 10;
+  if (_integral > PTP_MAX_PPB) {
+    _integral = PTP_MAX_PPB;
+  } else if (_integral < -PTP_MAX_PPB) {
+    _integral = -PTP_MAX_PPB;
+  }
+  ppb = -(offset * PTP_SERVO_KP / 10 + _integral);
+  if (ppb > PTP_MAX_PPB) {
+    ppb = PTP_MAX_PPB;
+  } else if (ppb < -PTP_MAX_PPB) {
+    ppb = -PTP_MAX_PPB;
+  }
+  if (ethernetif_ptp_adjust_freq((int32_t)ppb) != 0) {
+    _synced = false;
+    return;
+  }
+
+  _synced = (offset < PTP_SYNC_THRESHOLD) && (offset > -PTP_SYNC_THRESHOLD);
+}
+
+#endif /* ETH_PTP */
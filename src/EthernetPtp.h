@@ -0,0 +1,83 @@
+/***************************************************************************//**
+ * @file    EthernetPtp.h
+ * @brief   Arduino RTT-Ethernet library IEEE 1588 (PTP) slave clock header
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#ifndef ethernetptp_h
+#define ethernetptp_h
+
+#include "EthernetUdp.h"
+
+#if ETH_PTP
+
+/* PTPv2 over UDP/IPv4 */
+#define PTP_EVENT_PORT      319
+#define PTP_GENERAL_PORT    320
+
+/* Offset from master (ns) above which the clock is stepped instead of slewed */
+#ifndef PTP_STEP_THRESHOLD
+#define PTP_STEP_THRESHOLD  1000000
+#endif
+/* Maximum frequency adjustment (ppb) */
+#ifndef PTP_MAX_PPB
+#define PTP_MAX_PPB         500000
+#endif
+/* Offset from master (ns) below which the clock is reported synchronized */
+#ifndef PTP_SYNC_THRESHOLD
+#define PTP_SYNC_THRESHOLD  1000
+#endif
+
+// PTP slave only ordinary clock, end-to-end delay mechanism, disciplining
+// the MAC clock (hardware time stamps) to the first master heard
+class EthernetPTP {
+  public:
+    EthernetPTP();
+
+    // Start listening to PTP master of the domain.
+    // Returns 1 if successful, 0 if there are no sockets available to use
+    uint8_t begin(uint8_t domain = 0);
+    void stop();
+    // Process received PTP messages and adjust MAC clock, to be called
+    // frequently. Returns 1 if the clock was adjusted.
+    int maintain();
+
+    bool synchronized();
+    int32_t offset();   // the last offset from master in ns
+    uint32_t delay();   // the mean path delay in ns
+    void time(uint32_t &sec, uint32_t &nsec); // the current MAC clock time
+
+  private:
+    EthernetUDP _event;   // Sync and Delay_Req
+    EthernetUDP _general; // Follow_Up and Delay_Resp
+    uint8_t _domain;
+    uint8_t _portId[10];  // our clock identity and port number
+    uint8_t _masterId[10];
+    bool _hasMaster;
+
+    uint16_t _syncSeq;
+    bool _syncPending;    // two-step Sync waiting for Follow_Up
+    int64_t _syncCorr;
+    int64_t _t1;          // Sync sent by master
+    int64_t _t2;          // Sync received
+
+    uint16_t _delayReqSeq;
+    bool _delayReqPending;
+    unsigned long _delayReqTime;
+    int64_t _t3;          // Delay_Req sent
+
+    int64_t _delay;
+    bool _delayValid;
+    int64_t _offset;
+    int64_t _integral;    // servo integral term in ppb
+    bool _synced;
+
+    int handleEvent(const uint8_t *msg, int len, int64_t rx);
+    int handleGeneral(const uint8_t *msg, int len);
+    int syncDone();
+    void sendDelayReq();
+    void adjust(int64_t offset);
+};
+
+#endif /* ETH_PTP */
+
+#endif
@@ -34,7 +34,7 @@
 #include "lwip/tcpip.h"
 
 /* Constructor */
-EthernetUDP::EthernetUDP() {}
+EthernetUDP::EthernetUDP() : _priority(0) {}
 
 /* Start EthernetUDP socket, listening at local port PORT */
 uint8_t EthernetUDP::begin(uint16_t port)
@@ -52,10 +52,14 @@ uint8_t EthernetUDP::begin(IPAddress ip, uint16_t port, bool multicast)
 
   LOCK_TCPIP_CORE();
   _udp.pcb = udp_new();
+  if (_udp.pcb != NULL) {
+    _udp.pcb->tos = ETH_TX_PRIO_TOS(_priority);
+  }
   UNLOCK_TCPIP_CORE();
   if (_udp.pcb == NULL) {
     return 0;
   }
+  _udp.data.pbuf_queue.init();
 
   ip_addr_t ipaddr;
   err_t err;
@@ -74,12 +78,16 @@ uint8_t EthernetUDP::begin(IPAddress ip, uint16_t port, bool multicast)
   }
 
 #if LWIP_IGMP
-  err_t ret;
-  LOCK_TCPIP_CORE();
-  ret = igmp_joingroup(IP_ADDR_ANY, &ipaddr);
-  UNLOCK_TCPIP_CORE();
-  if ((multicast) && (ERR_OK != ret)) {
-    return 0;
+  if (multicast) {
+    /* Group membership is refcounted by lwIP, left in stop() */
+    LOCK_TCPIP_CORE();
+    err = igmp_joingroup(IP_ADDR_ANY, &ipaddr);
+    UNLOCK_TCPIP_CORE();
+    if (ERR_OK != err) {
+      stop();
+      return 0;
+    }
+    _multicastIP = ip;
   }
 #endif
   LOCK_TCPIP_CORE();
@@ -102,6 +110,16 @@ int EthernetUDP::available()
 /* Release any resources being used by this EthernetUDP instance */
 void EthernetUDP::stop()
 {
+#if LWIP_IGMP
+  if ((uint32_t)_multicastIP != 0) {
+    ip_addr_t ipaddr;
+    u8_to_ip_addr(rawIPAddress(_multicastIP), &ipaddr);
+    LOCK_TCPIP_CORE();
+    igmp_leavegroup(IP_ADDR_ANY, &ipaddr);
+    UNLOCK_TCPIP_CORE();
+    _multicastIP = IPAddress(0, 0, 0, 0);
+  }
+#endif
   if (_udp.pcb != NULL) {
     LOCK_TCPIP_CORE();
     udp_disconnect(_udp.pcb);
@@ -150,7 +168,17 @@ int EthernetUDP::endPacket()
   err_t ret;
 
   LOCK_TCPIP_CORE();
+#if ETH_PTP
+  uint32_t mark = stm32_eth_get_tx_mark();
+#endif
   ret = udp_sendto(_udp.pcb, _data, u8_to_ip_addr(rawIPAddress(_sendtoIP), &ipaddr), _sendtoPort);
+#if ETH_PTP
+  /* Frame is passed to driver in this context, unless waiting for ARP */
+  _txMark = stm32_eth_get_tx_mark();
+  if (_txMark == mark) {
+    _txMark = 0;
+  }
+#endif
   UNLOCK_TCPIP_CORE();
   if (ERR_OK != ret) {
     pbuf_free(_data);
@@ -193,6 +221,9 @@ int EthernetUDP::parsePacket()
     _remoteIP = IPAddress(ip_addr_to_u32(&(_udp.ip)));
     _remotePort = _udp.port;
     _remaining = _udp.data.available;
+#if ETH_PTP
+    _rxTimestamp = _udp.rx_ts;
+#endif
 
     return _remaining;
   }
@@ -248,6 +279,41 @@ int EthernetUDP::read(unsigned char *buffer, size_t len)
 
 }
 
+int EthernetUDP::borrow(const uint8_t **buf)
+{
+  if ((_udp.data.p == NULL) || (_remaining == 0)) {
+    return -1;
+  }
+
+  uint16_t len = stm32_borrow_data(&(_udp.data), buf);
+  if (len == 0) {
+    return -1;
+  }
+  return (len > _remaining) ? _remaining : len;
+}
+
+void EthernetUDP::release(size_t size)
+{
+  if ((_udp.data.p == NULL) || (_remaining == 0)) {
+    return;
+  }
+
+  if (size > _remaining) {
+    size = _remaining;
+  }
+  _remaining -= stm32_release_data(&(_udp.data), size);
+}
+
+void EthernetUDP::setPriority(uint8_t prio)
+{
+  _priority = (prio > ETH_TX_PRIO_HIGH) ? ETH_TX_PRIO_HIGH : prio;
+  if (_udp.pcb != NULL) {
+    LOCK_TCPIP_CORE();
+    _udp.pcb->tos = ETH_TX_PRIO_TOS(_priority);
+    UNLOCK_TCPIP_CORE();
+  }
+}
+
 int EthernetUDP::peek()
 {
   uint8_t b;
@@ -266,6 +332,37 @@ void EthernetUDP::flush()
   // TODO: we should wait for TX buffer to be emptied
 }
 
+#if ETH_PTP
+int EthernetUDP::rxTimestamp(uint32_t &sec, uint32_t &nsec)
+{
+  if ((_rxTimestamp.sec == 0) && (_rxTimestamp.nsec == 0)) {
+    return 0;
+  }
+  sec = _rxTimestamp.sec;
+  nsec = _rxTimestamp.nsec;
+  return 1;
+}
+
+int EthernetUDP::txTimestamp(uint32_t &sec, uint32_t &nsec, unsigned long timeout)
+{
+  ethernetif_timestamp_t ts;
+  unsigned long start = millis();
+
+  if (_txMark == 0) {
+    return 0;
+  }
+  while (stm32_eth_get_tx_timestamp(_txMark, &ts) != 0) {
+    if ((millis() - start) >= timeout) {
+      return 0;
+    }
+    sys_msleep(1);
+  }
+  sec = ts.sec;
+  nsec = ts.nsec;
+  return 1;
+}
+#endif
+
 /* Start EthernetUDP socket, listening at local port PORT */
 uint8_t EthernetUDP::beginMulticast(IPAddress ip, uint16_t port)
 {
@@ -51,6 +51,12 @@ class EthernetUDP : public UDP {
     uint16_t _remotePort; // remote port for the incoming packet whilst it's being processed
     IPAddress _sendtoIP;  // the remote IP address set by beginPacket
     uint16_t _sendtoPort; // the remote port set by beginPacket
+    IPAddress _multicastIP; // the multicast group joined by begin, 0.0.0.0 if none
+    uint8_t _priority; // TX priority class of the socket
+#if ETH_PTP
+    ethernetif_timestamp_t _rxTimestamp; // RX time stamp of the packet returned by parsePacket
+    uint32_t _txMark; // the last packet sent by endPacket, 0 if not sent yet
+#endif
 
     struct pbuf *_data;     //pbuf for data to send
     struct udp_struct _udp; //udp settings
@@ -101,6 +107,22 @@ class EthernetUDP : public UDP {
     };
     // Return the next byte from the current packet without moving on to the next byte
     virtual int peek();
+    // Zero-copy read of the current packet: lend the next contiguous segment,
+    // valid until release(). Returns segment length, or -1 if no data.
+    int borrow(const uint8_t **buf);
+    // Consume "size" bytes of the borrowed segment
+    void release(size_t size);
+    // Send in TX priority class "prio" (0 to ETH_TX_PRIO_HIGH), by the IP
+    // precedence of the socket
+    void setPriority(uint8_t prio);
+#if ETH_PTP
+    // Hardware time stamp of the packet returned by parsePacket().
+    // Returns 1 if available.
+    int rxTimestamp(uint32_t &sec, uint32_t &nsec);
+    // Hardware time stamp of the last packet sent by endPacket(), waiting up
+    // to "timeout" ms for its transmission. Returns 1 if available.
+    int txTimestamp(uint32_t &sec, uint32_t &nsec, unsigned long timeout = 10);
+#endif
     virtual void flush(); // Finish reading the current packet
 
     // Return the IP address of the host who sent the current incoming packet
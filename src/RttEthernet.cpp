@@ -115,6 +115,46 @@ EthernetLinkStatus EthernetClass::linkStatus()
   return (!stm32_eth_is_init()) ? Unknown : (stm32_eth_link_up() ? LinkON : LinkOFF);
 }
 
+int EthernetClass::waitReady(unsigned long timeout)
+{
+  return stm32_eth_wait_ready(timeout);
+}
+
+void EthernetClass::fastBoot(uint8_t linkConfig)
+{
+  stm32_eth_set_fast_boot(linkConfig);
+}
+
+uint8_t EthernetClass::linkConfig()
+{
+  return stm32_eth_get_link_config();
+}
+
+int EthernetClass::setMACFilter(uint8_t index, const uint8_t *mac, bool source)
+{
+  return stm32_eth_set_mac_filter(index, mac, source ? 1 : 0);
+}
+
+int EthernetClass::clearMACFilter(uint8_t index)
+{
+  return stm32_eth_set_mac_filter(index, NULL, 0);
+}
+
+int EthernetClass::setVLANFilter(uint16_t vid)
+{
+  return stm32_eth_set_vlan_filter(vid);
+}
+
+int EthernetClass::setRxFilter(uint32_t mode)
+{
+  return stm32_eth_set_rx_filter(mode);
+}
+
+uint32_t EthernetClass::rxFilter()
+{
+  return stm32_eth_get_rx_filter();
+}
+
 int EthernetClass::maintain()
 {
   uint8_t rc = checkLease();
@@ -182,26 +222,49 @@ IPAddress EthernetClass::getDnsServerIp()
 int EthernetClass::beginWithDHCP(unsigned long timeout)
 {
   _dhcp_lease_state = DHCP_CHECK_NONE;
-  uint8_t is_timeout = 0;
-  unsigned long startTime = millis();
 
   stm32_set_DHCP_state(DHCP_START);
 
-  while (stm32_get_DHCP_state() != DHCP_ADDRESS_ASSIGNED) {
-    if ((millis() - startTime) > timeout) {
-      is_timeout = 1;
-      stm32_set_DHCP_state(DHCP_ASK_RELEASE);
-      break;
-    }
-    sys_msleep(20);
-  }
-
-  if (is_timeout) {
+  // Sleep until address assigned, DHCP timeout or timeout
+  if (!stm32_DHCP_wait(timeout)) {
+    stm32_set_DHCP_state(DHCP_ASK_RELEASE);
     return 0;
   }
   return 1;
 }
 
+void EthernetClass::beginDHCP(void (*callback)(int))
+{
+  stm32_eth_init(MACAddressDefault(), NULL, NULL, NULL);
+  beginDHCPAsync(callback);
+}
+
+void EthernetClass::beginDHCP(uint8_t *mac_address, void (*callback)(int))
+{
+  stm32_eth_init(mac_address, NULL, NULL, NULL);
+  MACAddress(mac_address);
+  beginDHCPAsync(callback);
+}
+
+void EthernetClass::beginDHCPAsync(void (*callback)(int))
+{
+  _dhcp_lease_state = DHCP_CHECK_NONE;
+  _dhcp_callback = callback;
+
+  stm32_set_DHCP_callback(dhcpDone);
+  stm32_set_DHCP_state(DHCP_START);
+}
+
+void EthernetClass::dhcpDone(int result)
+{
+  if (result == 1) {
+    Ethernet._dnsServerAddress = Ethernet.getDnsServerIp();
+  }
+  if (Ethernet._dhcp_callback != NULL) {
+    Ethernet._dhcp_callback(result);
+  }
+}
+
 /*
     returns:
     0/DHCP_CHECK_NONE: nothing happened
@@ -5,6 +5,7 @@
 #include "IPAddress.h"
 #include "EthernetClient.h"
 #include "EthernetServer.h"
+#include "utility/ethernetif.h"
 
 #define DHCP_CHECK_NONE         (0)
 #define DHCP_CHECK_RENEW_FAIL   (1)
@@ -23,10 +24,13 @@ class EthernetClass {
     IPAddress _dnsServerAddress;
     uint8_t mac_address[6];
     uint8_t _dhcp_lease_state;
+    void (*_dhcp_callback)(int);
 
     uint8_t   *MACAddressDefault(void);
     IPAddress getDnsServerIp();
     int beginWithDHCP(unsigned long timeout = 10000);
+    void beginDHCPAsync(void (*callback)(int));
+    static void dhcpDone(int result);
     uint8_t checkLease();
 
   public:
@@ -35,6 +39,16 @@ class EthernetClass {
     // Returns 0 if the DHCP configuration failed, and 1 if it succeeded
     int begin(unsigned long timeout = 10000);
     EthernetLinkStatus linkStatus();
+    // Wait up to "timeout" ms (0 to poll) for link up and IP address set.
+    // Returns 1 if the network is ready
+    int waitReady(unsigned long timeout = 0);
+    // Call before begin() to start MAC with "linkConfig" (the value of
+    // linkConfig() saved from the last run) without waiting for PHY
+    // auto-negotiation, and resolve gateway and DNS server MAC addresses once
+    // ready
+    void fastBoot(uint8_t linkConfig = 0);
+    // Returns the last negotiated speed and duplex mode, 0 if unknown
+    uint8_t linkConfig();
     void begin(IPAddress local_ip);
     void begin(IPAddress local_ip, IPAddress subnet);
     void begin(IPAddress local_ip, IPAddress subnet, IPAddress gateway);
@@ -43,6 +57,11 @@ class EthernetClass {
     // configuration through DHCP.
     // Returns 0 if the DHCP configuration failed, and 1 if it succeeded
     int begin(uint8_t *mac_address, unsigned long timeout = 10000);
+    // Start DHCP and return at once. "callback" is called with 1 if DHCP
+    // succeeded, or 0 if it failed, from the network thread with TCPIP core
+    // locked, so it must not block
+    void beginDHCP(void (*callback)(int));
+    void beginDHCP(uint8_t *mac_address, void (*callback)(int));
     void begin(uint8_t *mac_address, IPAddress local_ip);
     void begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server);
     void begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server, IPAddress gateway);
@@ -60,6 +79,17 @@ class EthernetClass {
     IPAddress dnsServerIP();
     int getHostByName(const char *aHostname, IPAddress &aResult);
 
+    // Hardware MAC filters, only available after begin().
+    // Pass frames addressed to up to 3 extra MAC addresses (index 1 to 3),
+    // or sent from them if "source" is set. Returns 0 on success.
+    int setMACFilter(uint8_t index, const uint8_t *mac, bool source = false);
+    int clearMACFilter(uint8_t index);
+    // Drop VLAN frames with other VLAN ID, 0 to receive all
+    int setVLANFilter(uint16_t vid);
+    // Frame filter mode, combination of ETH_RX_FILTER_xxx
+    int setRxFilter(uint32_t mode);
+    uint32_t rxFilter();
+
     friend class EthernetClient;
     friend class EthernetServer;
 };
@@ -56,9 +56,16 @@
 #include "lwip/igmp.h"
 #include "lwip/timeouts.h"
 #include "netif/etharp.h"
+#include "lwip/dns.h"
+#include "netif/ethernet.h"
+#if ETH_RX_GRO
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/tcp.h"
+#endif
 
-#include "queue.h"
 #include "ethernetif.h"
+#include "ethernetif_phy.h"
+#include <rtthread.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -71,19 +78,126 @@ extern "C" {
 typedef struct lwip_custom_pbuf {
     struct pbuf_custom custom_p;
     uint8_t *buf;
+#if ETH_RX_BATCH
+    struct lwip_custom_pbuf *next;  /* Next frame in RX batch */
+#endif
+#if ETH_PTP
+    ethernetif_timestamp_t ts;      /* RX timestamp */
+#endif
 } lwip_custom_pbuf_t;
 
+#if ETH_TX_QUEUE_LEN
+typedef struct {
+  struct pbuf *p[ETH_TX_QUEUE_LEN];
+#if (ETH_TX_QUEUE_POLICY == ETH_TX_DROP_PRIO)
+  uint8_t prio[ETH_TX_QUEUE_LEN];
+#endif
+  uint32_t head;
+  uint32_t count;
+} tx_queue_t;
+#endif
+
+#ifdef ETH_INPUT_USE_IT
+typedef struct {
+  uint8_t adaptive;
+  uint32_t low_pps;                 /* At or below: no moderation */
+  uint32_t high_pps;                /* At or above: full moderation */
+  uint32_t max_usecs;
+  uint32_t frames;                  /* Frames since tick */
+  uint32_t tick;
+  uint32_t usecs_set;               /* Current watchdog delay */
+  uint32_t frames_set;              /* Current frames per RX interrupt */
+} rx_coalesce_t;
+#endif
+
+/* PHY management states, each one an MDIO operation */
+typedef enum {
+  PHY_STATE_IDLE = 0,
+  PHY_STATE_READ_IRQ,               /* Read and clear interrupt sources */
+  PHY_STATE_READ_BSR,               /* Read link status */
+  PHY_STATE_READ_STATUS,            /* Read auto-negotiation result */
+  PHY_STATE_WRITE_BCR,              /* Force speed and duplex */
+} phy_state_t;
+
+typedef struct {
+  const ethernetif_phy_ops_t *ops;
+  uint8_t ready;                    /* Set once MAC, DMA and PHY are initialized */
+  uint8_t state;                    /* One of phy_state_t */
+  uint8_t busy;                     /* MDIO operation of the state in progress */
+  uint8_t link_down;                /* Link down interrupt seen */
+  uint8_t pending;                  /* Link check requested while not idle */
+  uint8_t confirm;                  /* Speed and duplex mode not read from PHY yet */
+} phy_t;
+
+/* Spare RX buffers, reused in LIFO order so the most recently touched (cache
+   hot) buffer goes back to DMA first */
+typedef struct {
+  uint8_t *buf[ETH_RX_SPARE_NB];
+  uint32_t count;
+} rx_reservoir_t;
+
+#if ETH_FLOW_FILTER
+/* Token bucket of flow filter rate limit */
+typedef struct {
+  uint32_t tokens;                  /* In 1/1000 frame */
+  uint32_t tick;
+} rx_filter_bucket_t;
+#endif
+
+#if ETH_RX_BATCH
+typedef struct {
+  lwip_custom_pbuf_t *head;
+  lwip_custom_pbuf_t *tail;
+  uint32_t count;
+  uint8_t pending;                  /* Message posted and not yet handled */
+  struct tcpip_callback_msg *msg;
+} rx_batch_t;
+#endif
+
+#if ETH_RX_GRO
+#if CHECKSUM_CHECK_TCP
+#error "ETH_RX_GRO requires TCP checksum checked by hardware (CHECKSUM_CHECK_TCP 0)"
+#endif
+/* Coalesced TCP segment of a connection */
+typedef struct {
+  struct pbuf *head;                /* First frame, with payload of the next ones chained */
+  uint32_t seq;                     /* Expected sequence of the next segment */
+  uint32_t segs;
+} rx_gro_flow_t;
+#endif
+
 /* Private define ------------------------------------------------------------*/
 /* Network interface name */
 #define IFNAME0 's'
 #define IFNAME1 't'
 
-/* Definition of PHY SPECIAL CONTROL/STATUS REGISTER bitfield Auto-negotiation done indication */
-/* Placed in STM32Ethernet library instead of HAL conf to avoid compatibility dependence with Arduino_Core_STM32 */
-/* Could be moved from this file once Generic PHY is implemented */
-#define PHY_SR_AUTODONE ((uint16_t)0x1000)
+/* Time (ms) to wait for an MDIO operation to complete */
+#define ETH_PHY_STEP_MS 1U
+/* Timeout (ms) of MAC DMA software reset */
+#define ETH_SWRESET_TIMEOUT_MS 500U
+
+/* Initialize MAC and DMA without HAL_ETH_Init(), which resets PHY and waits
+   for auto-negotiation. Only for the families selecting MII/RMII in
+   SYSCFG_PMC (STM32F2/F4/F7), else HAL_ETH_Init() is always used. */
+#if defined(SYSCFG_PMC_MII_RMII_SEL)
+#define ETH_FAST_INIT 1
+#else
+#define ETH_FAST_INIT 0
+#endif
+
+#ifndef ETH_INPUT_USE_IT
+/* Without ETH interrupt, DMA status is checked by ethernet thread every (ms) */
+#define ETH_DMA_POLL_MS 20U
+#else
+/* Most frames per RX interrupt of adaptive RX interrupt moderation */
+#define ETH_RX_COALESCE_FRAMES_MAX ((ETH_RXBUFNB >= 2) ? (ETH_RXBUFNB / 2) : 1)
+#endif
 
 /* Private macro -------------------------------------------------------------*/
+#if ETH_BENCHMARK
+#define BENCH_CYCLES() (DWT->CYCCNT)
+#endif
+
 /* Private variables ---------------------------------------------------------*/
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
 #pragma data_alignment=4
@@ -98,37 +212,330 @@ __ALIGN_BEGIN ETH_DMADescTypeDef  DMATxDscrTab[ETH_TXBUFNB] __ALIGN_END;/* Ether
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
 #pragma data_alignment=4
 #endif
-__ALIGN_BEGIN uint8_t Rx_Buff[ETH_RXBUFNB * 2][ETH_RX_BUF_SIZE] __ALIGN_END; /* Ethernet Receive Buffer */
+__ALIGN_BEGIN uint8_t Rx_Buff[ETH_RXBUFNB + ETH_RX_SPARE_NB][ETH_RX_BUF_SIZE] __ALIGN_END; /* Ethernet Receive Buffer */
+
+#if ETH_TX_BOUNCE_NB
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+#pragma data_alignment=4
+#endif
+__ALIGN_BEGIN uint8_t Tx_Bounce[ETH_TX_BOUNCE_NB][ETH_TX_BUF_SIZE] __ALIGN_END; /* Ethernet Transmit Bounce Buffer */
+#endif
 
 ETH_HandleTypeDef EthHandle;
 
 static uint8_t macaddress[6] = { MAC_ADDR0, MAC_ADDR1, MAC_ADDR2, MAC_ADDR3, MAC_ADDR4, MAC_ADDR5 };
 
+/* MAC frame filter mode set by ethernetif_set_rx_filter(). Multicast hash
+   filtering (ETH_MACFFR_HM and ETH_MACFFR_HPF) is added by the driver while
+   any group is joined */
+static uint32_t rx_filter_mode = 0;
+
 #if LWIP_IGMP
 uint32_t ETH_HashTableHigh = 0x0;
 uint32_t ETH_HashTableLow = 0x0;
+/* Number of multicast addresses using each hash table bit */
+static uint8_t mcast_hash_ref[64];
+
+/* CRC-32 (reflected 0x04C11DB7), one nibble per lookup */
+static const uint32_t crc32_table[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
 #endif
 
 /* Custom pbuf pool */
-LWIP_MEMPOOL_DECLARE(RX_POOL, ETH_RXBUFNB * 2, sizeof(lwip_custom_pbuf_t), "ETH_RX_PBUF");
+LWIP_MEMPOOL_DECLARE(RX_POOL, ETH_RX_SPARE_NB, sizeof(lwip_custom_pbuf_t), "ETH_RX_PBUF");
+
+/* "pbuf" of each TX descriptor ending a frame, held until transmitted */
+static struct pbuf *tx_pbuf[ETH_TXBUFNB];
+#if ETH_TX_BOUNCE_NB
+/* Bounce buffer of each TX descriptor, held until transmitted */
+static uint8_t *tx_bounce[ETH_TXBUFNB];
+/* Free bounce buffers (LIFO) */
+static uint8_t *tx_bounce_free[ETH_TX_BOUNCE_NB];
+static uint32_t tx_bounce_cnt = 0;
+#endif
+/* Oldest TX descriptor not yet reclaimed, and number of them */
+static uint32_t tx_reclaim_idx = 0;
+static uint32_t tx_busy = 0;
+/* More frames coming: TX DMA is resumed once after the last of them */
+static uint8_t tx_more = 0;
+#if ETH_TX_QUEUE_LEN
+/* One TX queue per priority class */
+static tx_queue_t tx_queue[ETH_TX_PRIO_NUM];
+#endif
+#if (ETH_TX_PRIO_NUM > 1)
+static const ethernetif_tx_rule_t tx_prio_rule[] = {
+  ETH_TX_PRIO_RULES
+};
+#define TX_PRIO_RULE_NUM (sizeof(tx_prio_rule) / sizeof(tx_prio_rule[0]))
+#endif
+#ifdef ETH_INPUT_USE_IT
+static struct tcpip_callback_msg *tx_reclaim_msg;
+static volatile uint8_t tx_reclaim_pending = 0;
+#endif
+static rx_reservoir_t rx_reservoir;
+
+static ethernetif_stats_t stats;
+
+#if ETH_RX_BATCH
+static rx_batch_t rx_batch;
+#endif
+#if ETH_RX_GRO
+static rx_gro_flow_t rx_gro[ETH_GRO_FLOWS];
+/* Next flow to evict when all are in use */
+static uint32_t rx_gro_victim = 0;
+#if ETH_GRO_FLUSH_MS
+static uint8_t rx_gro_timer = 0;
+#endif
+#endif
+
+#if ETH_RX_DEFERRED
+static sys_sem_t rx_sem;
+#endif
+
+/* Events of ethernet thread */
+static struct rt_event eth_event;
+/* Network ready (ETH_READY_FLAG) */
+static struct rt_event ready_event;
+#define ETH_READY_FLAG 0x01U
+static uint8_t net_ready = 0;
+
+/* Fast boot: initial MAC config from the last negotiated speed and duplex
+   mode, and gateway and DNS server MAC addresses resolved once ready */
+static uint8_t fast_boot = 0;
+/* Last negotiated speed and duplex mode (ETH_LINK_CONFIG_xxx) */
+static uint8_t link_config = 0;
+
+/* PHY state machine, run by ethernet thread */
+static phy_t phy;
+
+#ifdef ETH_INPUT_USE_IT
+static rx_coalesce_t rx_coalesce;
+#endif
 
-static void *_tx_free_queue[ETH_TXBUFNB];
-static void *_rx_buf_queue[ETH_RXBUFNB];
-static queue_t tx_free_queue;
-static queue_t rx_buf_queue;
+/* VLAN ID to receive, 0 to receive all */
+static uint16_t rx_vlan_id = 0;
+
+#if ETH_PTP
+#define PTP_NSEC_PER_SEC  1000000000UL
+/* Timeout (ms) of PTP time stamp register updates, which take a few PTP
+   clock cycles */
+#define PTP_UPDATE_TIMEOUT_MS 10U
+/* Time stamp addend for nominal frequency */
+static uint32_t ptp_addend;
+/* Sequence (24-bit) of the last transmitted frame */
+static uint32_t tx_ts_seq = 0;
+/* Sequence of the frame ended by each TX descriptor */
+static uint32_t tx_ts_desc_seq[ETH_TXBUFNB];
+#endif
+
+#if ETH_FLOW_FILTER
+static const ethernetif_filter_rule_t rx_filter[] = {
+  ETH_FLOW_FILTER_RULES
+};
+#define RX_FILTER_NUM (sizeof(rx_filter) / sizeof(rx_filter[0]))
+static ethernetif_filter_stats_t rx_filter_stats[RX_FILTER_NUM];
+static rx_filter_bucket_t rx_filter_bucket[RX_FILTER_NUM];
+#endif
+
+#if ETH_BENCHMARK
+static ethernetif_bench_t bench;
+static __IO uint32_t bench_fault = ETH_FAULT_NONE;
+static uint8_t rx_recovering = 0;
+static uint8_t tx_recovering = 0;
+static uint32_t rx_recover_start;
+static uint32_t tx_recover_start;
+static __IO ETH_DMADescTypeDef *rx_held[ETH_RXBUFNB];
+static uint32_t rx_held_cnt = 0;
+#endif
 
 /* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef low_level_start(void);
+static void eth_macdma_config(void);
+#if ETH_FAST_INIT
+static HAL_StatusTypeDef low_level_fast_init(void);
+#endif
+static void eth_update_macffr(void);
+static void link_config_save(void);
+static void tx_reclaim(void);
+#if ETH_TX_QUEUE_LEN
+static void tx_queue_flush(void);
+#endif
+#ifdef ETH_INPUT_USE_IT
+static void ethernetif_tx_reclaim(void *arg);
+#endif
+#if ETH_RX_BATCH
+static void ethernetif_input_batch(void *arg);
+#endif
+#if ETH_RX_DEFERRED
+static void ethernetif_rx_thread(void *arg);
+#endif
+#ifdef ETH_INPUT_USE_IT
+static void rx_coalesce_apply(uint32_t usecs, uint32_t frames);
+static void rx_coalesce_update(uint32_t n);
+#endif
+
 /* Private functions ---------------------------------------------------------*/
-static void lwip_custom_pbuf_free(struct pbuf *p) {
-  lwip_custom_pbuf_t *custom_p = (lwip_custom_pbuf_t *)p;
-  bool ret;
+#if ETH_BENCHMARK
+static void bench_recovered(uint32_t start, uint32_t *cnt, uint64_t *cycles, uint32_t *max) {
+  uint32_t delta = BENCH_CYCLES() - start;
+
+  (*cnt)++;
+  *cycles += delta;
+  if (delta > *max) {
+    *max = delta;
+  }
+}
+#endif
+
+static void rx_reservoir_put(uint8_t *buf) {
+  SYS_ARCH_DECL_PROTECT(lev);
 
-  ret = queue_put(&rx_buf_queue, (void *)custom_p->buf);
-  if (!ret) {
+  SYS_ARCH_PROTECT(lev);
+  if (rx_reservoir.count >= ETH_RX_SPARE_NB) {
+    SYS_ARCH_UNPROTECT(lev);
     LOG_E("RX Q full");
+    return;
+  }
+  rx_reservoir.buf[rx_reservoir.count++] = buf;
+  if (rx_reservoir.count > stats.rx_spare_high) {
+    stats.rx_spare_high = rx_reservoir.count;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  LOG_D("RX Q+ %p %d", buf, rx_reservoir.count);
+}
+
+static uint8_t *rx_reservoir_get(void) {
+  uint8_t *buf = NULL;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  if (rx_reservoir.count > 0) {
+    buf = rx_reservoir.buf[--rx_reservoir.count];
+    if (rx_reservoir.count < stats.rx_spare_low) {
+      stats.rx_spare_low = rx_reservoir.count;
+    }
   } else {
-    LOG_D("RX Q+ %p %d", custom_p->buf, rx_buf_queue.put_cnt - rx_buf_queue.get_cnt);
+    stats.rx_spare_empty++;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return buf;
+}
+
+#if ETH_FLOW_FILTER
+/**
+  * @brief Check the flow filter rate limit of a rule
+  * @param i rule index
+  * @return 1 if the frame is within the rate, else 0
+  */
+static uint8_t rx_filter_take(uint32_t i) {
+  const ethernetif_filter_rule_t *rule = &rx_filter[i];
+  rx_filter_bucket_t *bucket = &rx_filter_bucket[i];
+  uint32_t now = HAL_GetTick();
+  uint32_t max = (rule->burst ? rule->burst : 1) * 1000U;
+  uint64_t tokens;
+
+  /* Refill: "rate" frames per 1000 ms, in 1/1000 frame */
+  tokens = (uint64_t)bucket->tokens + (uint64_t)(now - bucket->tick) * rule->rate;
+  bucket->tick = now;
+  bucket->tokens = (tokens > max) ? max : (uint32_t)tokens;
+
+  if (bucket->tokens < 1000U) {
+    return 0;
+  }
+  bucket->tokens -= 1000U;
+  return 1;
+}
+
+/**
+  * @brief Run the flow filter on a raw received frame
+  * @param frame the frame (including MAC header)
+  * @param len frame length
+  * @return 1 if the frame should be passed to LwIP stack, else 0
+  */
+static uint8_t rx_filter_pass(const uint8_t *frame, uint16_t len) {
+  const struct eth_hdr *ethhdr = (const struct eth_hdr *)frame;
+  const struct ip_hdr *iphdr = NULL;
+  uint16_t offset = SIZEOF_ETH_HDR;
+  uint16_t ethtype;
+  uint16_t port = 0;
+  uint8_t proto = 0;
+  uint8_t flags = 0;
+  uint8_t pass;
+  uint32_t i;
+
+  if (len < SIZEOF_ETH_HDR) {
+    return 0;
+  }
+
+  /* Destination type */
+  if (ethhdr->dest.addr[0] & 0x01) {
+    if ((ethhdr->dest.addr[0] & ethhdr->dest.addr[1] & ethhdr->dest.addr[2] &
+         ethhdr->dest.addr[3] & ethhdr->dest.addr[4] & ethhdr->dest.addr[5]) == 0xff) {
+      flags |= ETH_FILTER_MATCH_BCAST;
+    } else {
+      flags |= ETH_FILTER_MATCH_MCAST;
+    }
+  }
+
+  /* EtherType, skip VLAN tag */
+  ethtype = lwip_ntohs(ethhdr->type);
+  if ((ethtype == ETHTYPE_VLAN) && (len >= (SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR))) {
+    ethtype = lwip_ntohs(((const struct eth_vlan_hdr *)(frame + SIZEOF_ETH_HDR))->tpid);
+    offset += SIZEOF_VLAN_HDR;
+  }
+
+  /* IPv4 protocol and destination port of the first fragment */
+  if ((ethtype == ETHTYPE_IP) && (len >= (offset + IP_HLEN))) {
+    iphdr = (const struct ip_hdr *)(frame + offset);
+    proto = IPH_PROTO(iphdr);
+    offset += IPH_HL_BYTES(iphdr);
+    if (((proto == IP_PROTO_TCP) || (proto == IP_PROTO_UDP)) &&
+        ((lwip_ntohs(IPH_OFFSET(iphdr)) & IP_OFFMASK) == 0) &&
+        (len >= (offset + 4))) {
+      /* Destination port follows source port in both TCP and UDP */
+      port = (uint16_t)((frame[offset + 2] << 8) | frame[offset + 3]);
+    }
+  }
+
+  for (i = 0; i < RX_FILTER_NUM; i++) {
+    const ethernetif_filter_rule_t *rule = &rx_filter[i];
+
+    if ((rule->match & ETH_FILTER_MATCH_ETHTYPE) && (rule->ethtype != ethtype)) {
+      continue;
+    }
+    if ((rule->match & ETH_FILTER_MATCH_PROTO) && ((iphdr == NULL) || (rule->proto != proto))) {
+      continue;
+    }
+    if ((rule->match & ETH_FILTER_MATCH_PORT) && ((port == 0) || (rule->port != port))) {
+      continue;
+    }
+    if ((rule->match & (ETH_FILTER_MATCH_BCAST | ETH_FILTER_MATCH_MCAST)) &&
+        !(rule->match & flags)) {
+      continue;
+    }
+
+    rx_filter_stats[i].hits++;
+    pass = (rule->action == ETH_FILTER_PASS);
+    if (pass && rule->rate) {
+      pass = rx_filter_take(i);
+    }
+    if (!pass) {
+      rx_filter_stats[i].drops++;
+      stats.rx_filter_drop++;
+    }
+    return pass;
   }
+
+  return 1;
+}
+#endif /* ETH_FLOW_FILTER */
+
+static void lwip_custom_pbuf_free(struct pbuf *p) {
+  lwip_custom_pbuf_t *custom_p = (lwip_custom_pbuf_t *)p;
+
+  rx_reservoir_put(custom_p->buf);
   LWIP_MEMPOOL_FREE(RX_POOL, custom_p);
 }
 
@@ -178,6 +585,71 @@ void HAL_ETH_MspInit(ETH_HandleTypeDef *heth)
   __HAL_RCC_ETH_CLK_ENABLE();
 }
 
+#if ETH_PTP
+/**
+  * @brief  Wait for PTP time stamp register updates to be done, bounded as
+  *         it may be called with TCPIP core locked
+  * @param  flags: ETH_PTPTSCR_xxx update bits
+  * @retval 0 on success, -1 on timeout
+  */
+static int ptp_wait(uint32_t flags)
+{
+  uint32_t tickstart = HAL_GetTick();
+
+  while ((EthHandle.Instance->PTPTSCR & flags) != (uint32_t)RESET) {
+    if ((HAL_GetTick() - tickstart) > PTP_UPDATE_TIMEOUT_MS) {
+      LOG_E("PTP update timeout %08lx", (unsigned long)flags);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Initialize PTP time stamp unit: fine correction, digital rollover
+  *         (sub-second in ns) and time stamp of all frames
+  * @param  None
+  * @retval 0 on success, -1 on timeout
+  */
+static int ptp_init(void)
+{
+  uint32_t ssinc;
+  uint32_t i;
+
+  /* Time stamps are written to enhanced descriptors */
+  EthHandle.Instance->DMABMR |= ETH_DMABMR_EDE;
+  /* Mask time stamp trigger interrupt */
+  EthHandle.Instance->MACIMR |= ETH_MACIMR_TSTIM;
+
+  EthHandle.Instance->PTPTSCR = ETH_PTPTSCR_TSE | ETH_PTPTSCR_TSSSR | ETH_PTPTSCR_TSSARFE;
+
+  /* Sub-second increment (ns) for an accumulator overflow rate of about half HCLK */
+  ssinc = (2 * PTP_NSEC_PER_SEC + SystemCoreClock - 1) / SystemCoreClock;
+  EthHandle.Instance->PTPSSIR = ssinc;
+  ptp_addend = (uint32_t)(((uint64_t)(PTP_NSEC_PER_SEC / ssinc) << 32) / SystemCoreClock);
+  EthHandle.Instance->PTPTSAR = ptp_addend;
+  EthHandle.Instance->PTPTSCR |= ETH_PTPTSCR_TSARU;
+  if (ptp_wait(ETH_PTPTSCR_TSARU) != 0) {
+    return -1;
+  }
+  EthHandle.Instance->PTPTSCR |= ETH_PTPTSCR_TSFCU;
+
+  /* Start from 0 */
+  EthHandle.Instance->PTPTSHUR = 0;
+  EthHandle.Instance->PTPTSLUR = 0;
+  EthHandle.Instance->PTPTSCR |= ETH_PTPTSCR_TSSTI;
+  if (ptp_wait(ETH_PTPTSCR_TSSTI) != 0) {
+    return -1;
+  }
+
+  /* Time stamp all transmitted frames */
+  for (i = 0; i < ETH_TXBUFNB; i++) {
+    DMATxDscrTab[i].Status |= ETH_DMATXDESC_TTSE;
+  }
+  return 0;
+}
+#endif /* ETH_PTP */
+
 /*******************************************************************************
                        LL Driver Interface ( LwIP stack --> ETH)
 *******************************************************************************/
@@ -189,19 +661,93 @@ void HAL_ETH_MspInit(ETH_HandleTypeDef *heth)
   *        for this ethernetif
   */
 static void low_level_init(struct netif *netif) {
-  uint32_t regvalue;
   uint32_t i;
 
   /* Initialize memory pool */
   LWIP_MEMPOOL_INIT(RX_POOL);
 
+#if ETH_RX_BATCH
+  /* Preallocate the only message used to pass RX batch to tcpip_thread */
+  rx_batch.msg = tcpip_callbackmsg_new(ethernetif_input_batch, netif);
+  LWIP_ASSERT("rx_batch.msg != NULL", (rx_batch.msg != NULL));
+#endif
+
+#if ETH_RX_DEFERRED
+  /* Create RX thread */
+  if (sys_sem_new(&rx_sem, 0) != ERR_OK) {
+    LOG_E("RX sem err");
+  }
+  (void)sys_thread_new("eth_rx", ethernetif_rx_thread, netif, ETH_RX_THREAD_STACKSIZE, ETH_RX_THREAD_PRIO);
+#endif
+
+#ifdef ETH_INPUT_USE_IT
+  tx_reclaim_msg = tcpip_callbackmsg_new(ethernetif_tx_reclaim, netif);
+  LWIP_ASSERT("tx_reclaim_msg != NULL", (tx_reclaim_msg != NULL));
+#endif
+
   /* Initialize queues */
-  queue_init(tx_free_queue, _tx_free_queue);
-  queue_init(rx_buf_queue, _rx_buf_queue);
-  for (i = 0; i < ETH_RXBUFNB; i++) {
-    queue_put(&rx_buf_queue, (void *)&Rx_Buff[ETH_RXBUFNB + i][0]);
-    LOG_D("RX Q+ %p", Rx_Buff[ETH_RXBUFNB + i]);
+#if ETH_TX_BOUNCE_NB
+  for (i = 0; i < ETH_TX_BOUNCE_NB; i++) {
+    tx_bounce_free[i] = &Tx_Bounce[i][0];
+  }
+  tx_bounce_cnt = ETH_TX_BOUNCE_NB;
+#endif
+  rx_reservoir.count = 0;
+  for (i = 0; i < ETH_RX_SPARE_NB; i++) {
+    rx_reservoir_put(&Rx_Buff[ETH_RXBUFNB + i][0]);
+  }
+  stats.rx_spare_low = stats.rx_spare_high = rx_reservoir.count;
+
+  /* set MAC hardware address length */
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+
+  /* set MAC hardware address */
+  netif->hwaddr[0] =  macaddress[0];
+  netif->hwaddr[1] =  macaddress[1];
+  netif->hwaddr[2] =  macaddress[2];
+  netif->hwaddr[3] =  macaddress[3];
+  netif->hwaddr[4] =  macaddress[4];
+  netif->hwaddr[5] =  macaddress[5];
+
+  /* maximum transfer unit */
+  netif->mtu = 1500;
+
+  /* device capabilities */
+  /* don't set NETIF_FLAG_ETHARP if this device is not an ethernet one */
+  netif->flags |= NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP;
+
+#if LWIP_IGMP
+  netif_set_igmp_mac_filter(netif, igmp_mac_filter);
+#endif
+
+#if ETH_INIT_ASYNC
+  /* Let ethernet thread wait for PHY, with link down until then */
+  ethernetif_notify(ETH_EVENT_INIT);
+#else
+  if (low_level_start() == HAL_OK) {
+    /* Set netif link flag */
+    netif->flags |= NETIF_FLAG_LINK_UP;
   }
+#endif
+}
+
+/**
+  * @brief Initialize the hardware: MAC, DMA and PHY. HAL_ETH_Init() blocks
+  * until PHY auto-negotiation is done, or timed out. With fast boot and the
+  * last negotiated speed and duplex mode, or with ETH_INIT_ASYNC,
+  * low_level_fast_init() is used instead, which doesn't wait. HAL_ETH_Init()
+  * is still used if it fails to reset DMA.
+  *
+  * @return HAL_OK if link is up
+  */
+static HAL_StatusTypeDef low_level_start(void) {
+  HAL_StatusTypeDef status;
+#if ETH_FAST_INIT
+  uint8_t cached;
+#endif
+#ifdef ETH_INPUT_USE_IT
+  uint32_t i;
+#endif
 
   EthHandle.Instance = ETH;
   EthHandle.Init.MACAddr = macaddress;
@@ -219,189 +765,375 @@ static void low_level_init(struct netif *netif) {
   EthHandle.Init.RxMode = ETH_RXPOLLING_MODE;
 #endif /* ETH_INPUT_USE_IT */
   EthHandle.Init.ChecksumMode = ETH_CHECKSUM_BY_HARDWARE;
-  EthHandle.Init.PhyAddress = LAN8742A_PHY_ADDRESS;
-
-  /* configure ethernet peripheral (GPIOs, clocks, MAC, DMA) */
-  if (HAL_ETH_Init(&EthHandle) == HAL_OK) {
-    /* Set netif link flag */
-    netif->flags |= NETIF_FLAG_LINK_UP;
+  EthHandle.Init.PhyAddress = ETH_PHY_ADDRESS;
+
+  phy.confirm = 0;
+#if ETH_FAST_INIT
+  cached = fast_boot && (link_config & ETH_LINK_CONFIG_VALID);
+  if (cached || ETH_INIT_ASYNC) {
+    if (cached) {
+      /* Start with the last negotiated config, confirmed (or corrected) by
+         ethernetif_phy_step() once auto-negotiation is done */
+      EthHandle.Init.Speed = (link_config & ETH_LINK_CONFIG_100M) ? ETH_SPEED_100M : ETH_SPEED_10M;
+      EthHandle.Init.DuplexMode = (link_config & ETH_LINK_CONFIG_FULL) ? ETH_MODE_FULLDUPLEX : ETH_MODE_HALFDUPLEX;
+    }
+    status = low_level_fast_init();
+    phy.confirm = (status != HAL_ERROR);
+    if (!cached && (status == HAL_OK)) {
+      /* Link up once ethernetif_phy_step() reads speed and duplex mode */
+      status = HAL_TIMEOUT;
+    }
+  }
+#endif
+  if (!phy.confirm) {
+    /* configure ethernet peripheral (GPIOs, clocks, MAC, DMA) */
+    status = HAL_ETH_Init(&EthHandle);
+    if (EthHandle.State == HAL_ETH_STATE_READY) {
+      eth_macdma_config();
+    }
+    if (status == HAL_OK) {
+      link_config_save();
+    }
   }
 
   /* Initialize Tx Descriptors list: Chain Mode */
   HAL_ETH_DMATxDescListInit(&EthHandle, DMATxDscrTab, NULL, ETH_TXBUFNB);
+#ifdef ETH_INPUT_USE_IT
+  /* Raise TX complete interrupt after each frame, to reclaim its "pbuf" */
+  for (i = 0; i < ETH_TXBUFNB; i++) {
+    DMATxDscrTab[i].Status |= ETH_DMATXDESC_IC;
+  }
+#endif
 
   /* Initialize Rx Descriptors list: Chain Mode  */
   HAL_ETH_DMARxDescListInit(&EthHandle, DMARxDscrTab, &Rx_Buff[0][0], ETH_RXBUFNB);
+#ifdef ETH_INPUT_USE_IT
+  /* Interrupt on completion disable (DIC) bits are cleared by it */
+  rx_coalesce_apply(rx_coalesce.usecs_set, rx_coalesce.frames_set);
+#endif
 
-  /* set MAC hardware address length */
-  netif->hwaddr_len = ETH_HWADDR_LEN;
-
-  /* set MAC hardware address */
-  netif->hwaddr[0] =  macaddress[0];
-  netif->hwaddr[1] =  macaddress[1];
-  netif->hwaddr[2] =  macaddress[2];
-  netif->hwaddr[3] =  macaddress[3];
-  netif->hwaddr[4] =  macaddress[4];
-  netif->hwaddr[5] =  macaddress[5];
-
-  /* maximum transfer unit */
-  netif->mtu = 1500;
-
-  /* device capabilities */
-  /* don't set NETIF_FLAG_ETHARP if this device is not an ethernet one */
-  netif->flags |= NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP;
+#if ETH_PTP
+  if (ptp_init() != 0) {
+    LOG_E("PTP init err");
+  }
+#endif
 
   /* Enable MAC and DMA transmission and reception */
   HAL_ETH_Start(&EthHandle);
-#if LWIP_IGMP
-  netif_set_igmp_mac_filter(netif, igmp_mac_filter);
+#ifdef ETH_INPUT_USE_IT
+  /* Enable TX complete interrupt */
+  __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_T);
+  /* Enable RX buffer unavailable and TX underflow interrupts, to wake up
+     ethernet thread resuming DMA */
+  __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_AIS | ETH_DMA_IT_RBU | ETH_DMA_IT_TU);
 #endif
   /**** Configure PHY to generate an interrupt when Eth Link state changes ****/
-  /* Read Register Configuration */
-  HAL_ETH_ReadPHYRegister(&EthHandle, PHY_IMR, &regvalue);
-
-  regvalue |= PHY_ISFR_INT4;
+  phy.ops = ethernetif_phy_probe(&EthHandle, ETH_PHY);
+#ifdef ETH_PHY_INT_PIN
+  /* Also on link up, to know it without polling */
+  phy.ops->irq_enable(&EthHandle, 1);
+#else
+  phy.ops->irq_enable(&EthHandle, 0);
+#endif
 
-  /* Enable Interrupt on change of link status */
-  HAL_ETH_WritePHYRegister(&EthHandle, PHY_IMR, regvalue);
 #if LWIP_IGMP
-  ETH_HashTableHigh = EthHandle.Instance->MACHTHR;
-  ETH_HashTableLow = EthHandle.Instance->MACHTLR;
+  ETH_HashTableHigh = 0;
+  ETH_HashTableLow = 0;
+  memset(mcast_hash_ref, 0, sizeof(mcast_hash_ref));
+  EthHandle.Instance->MACHTHR = 0;
+  EthHandle.Instance->MACHTLR = 0;
 #endif
+  rx_filter_mode = EthHandle.Instance->MACFFR;
+
+  /* From now on, PHY is only accessed by ethernetif_phy_step() */
+  phy.state = PHY_STATE_IDLE;
+  phy.busy = 0;
+  phy.pending = 0;
+  phy.ready = 1;
+  return status;
 }
 
 /**
-  * @brief  Sends an Ethernet frame.
-  * @param  heth pointer to a ETH_HandleTypeDef structure that contains
-  *         the configuration information for ETHERNET module
-  * @param  bufcount Number of buffer to be sent
-  * @retval HAL status
+  * @brief Configure MAC and DMA with the driver settings, which are the
+  * defaults of HAL_ETH_Init(). Applied by both low_level_start() and
+  * low_level_fast_init(), so MAC and DMA are configured the same way whether
+  * or not HAL_ETH_Init() is used.
+  *
+  * @return None
   */
-HAL_StatusTypeDef HAL_ETH_TransmitFrame2(ETH_HandleTypeDef *heth, uint32_t bufcount)
-{
-  uint32_t i = 0;
-
-  /* Process Locked */
-  __HAL_LOCK(heth);
-
-  /* Set the ETH peripheral state to BUSY */
-  heth->State = HAL_ETH_STATE_BUSY;
-
-  if (bufcount == 0) {
-    /* Set ETH HAL state to READY */
-    heth->State = HAL_ETH_STATE_READY;
+static void eth_macdma_config(void) {
+  ETH_MACInitTypeDef macinit;
+  ETH_DMAInitTypeDef dmainit;
+
+  macinit.Watchdog = ETH_WATCHDOG_ENABLE;
+  macinit.Jabber = ETH_JABBER_ENABLE;
+  macinit.InterFrameGap = ETH_INTERFRAMEGAP_96BIT;
+  macinit.CarrierSense = ETH_CARRIERSENCE_ENABLE;
+  macinit.ReceiveOwn = ETH_RECEIVEOWN_ENABLE;
+  macinit.LoopbackMode = ETH_LOOPBACKMODE_DISABLE;
+  macinit.ChecksumOffload = (EthHandle.Init.ChecksumMode == ETH_CHECKSUM_BY_HARDWARE) ?
+    ETH_CHECKSUMOFFLAOD_ENABLE : ETH_CHECKSUMOFFLAOD_DISABLE;
+  macinit.RetryTransmission = ETH_RETRYTRANSMISSION_DISABLE;
+  macinit.AutomaticPadCRCStrip = ETH_AUTOMATICPADCRCSTRIP_DISABLE;
+  macinit.BackOffLimit = ETH_BACKOFFLIMIT_10;
+  macinit.DeferralCheck = ETH_DEFFERRALCHECK_DISABLE;
+  macinit.ReceiveAll = ETH_RECEIVEAll_DISABLE;
+  macinit.SourceAddrFilter = ETH_SOURCEADDRFILTER_DISABLE;
+  macinit.PassControlFrames = ETH_PASSCONTROLFRAMES_BLOCKALL;
+  macinit.BroadcastFramesReception = ETH_BROADCASTFRAMESRECEPTION_ENABLE;
+  macinit.DestinationAddrFilter = ETH_DESTINATIONADDRFILTER_NORMAL;
+  macinit.PromiscuousMode = ETH_PROMISCUOUS_MODE_DISABLE;
+  macinit.MulticastFramesFilter = ETH_MULTICASTFRAMESFILTER_PERFECT;
+  macinit.UnicastFramesFilter = ETH_UNICASTFRAMESFILTER_PERFECT;
+  macinit.HashTableHigh = 0x0U;
+  macinit.HashTableLow = 0x0U;
+  macinit.PauseTime = 0x0U;
+  macinit.ZeroQuantaPause = ETH_ZEROQUANTAPAUSE_DISABLE;
+  macinit.PauseLowThreshold = ETH_PAUSELOWTHRESHOLD_MINUS4;
+  macinit.UnicastPauseFrameDetect = ETH_UNICASTPAUSEFRAMEDETECT_DISABLE;
+  macinit.ReceiveFlowControl = ETH_RECEIVEFLOWCONTROL_DISABLE;
+  macinit.TransmitFlowControl = ETH_TRANSMITFLOWCONTROL_DISABLE;
+  macinit.VLANTagComparison = ETH_VLANTAGCOMPARISON_16BIT;
+  macinit.VLANTagIdentifier = 0x0U;
+
+  dmainit.DropTCPIPChecksumErrorFrame = ETH_DROPTCPIPCHECKSUMERRORFRAME_ENABLE;
+  dmainit.ReceiveStoreForward = ETH_RECEIVESTOREFORWARD_ENABLE;
+  dmainit.FlushReceivedFrame = ETH_FLUSHRECEIVEDFRAME_ENABLE;
+  dmainit.TransmitStoreForward = ETH_TRANSMITSTOREFORWARD_ENABLE;
+  dmainit.TransmitThresholdControl = ETH_TRANSMITTHRESHOLDCONTROL_64BYTES;
+  dmainit.ForwardErrorFrames = ETH_FORWARDERRORFRAMES_DISABLE;
+  dmainit.ForwardUndersizedGoodFrames = ETH_FORWARDUNDERSIZEDGOODFRAMES_DISABLE;
+  dmainit.ReceiveThresholdControl = ETH_RECEIVEDTHRESHOLDCONTROL_64BYTES;
+  dmainit.SecondFrameOperate = ETH_SECONDFRAMEOPERARTE_ENABLE;
+  dmainit.AddressAlignedBeats = ETH_ADDRESSALIGNEDBEATS_ENABLE;
+  dmainit.FixedBurst = ETH_FIXEDBURST_ENABLE;
+  dmainit.RxDMABurstLength = ETH_RXDMABURSTLENGTH_32BEAT;
+  dmainit.TxDMABurstLength = ETH_TXDMABURSTLENGTH_32BEAT;
+  dmainit.EnhancedDescriptorFormat = ETH_DMAENHANCEDDESCRIPTOR_ENABLE;
+  dmainit.DescriptorSkipLength = 0x0U;
+  dmainit.DMAArbitration = ETH_DMAARBITRATION_ROUNDROBIN_RXTX_1_1;
+
+  (void)HAL_ETH_ConfigMAC(&EthHandle, &macinit);
+  (void)HAL_ETH_ConfigDMA(&EthHandle, &dmainit);
+}
 
-    /* Process Unlocked */
-    __HAL_UNLOCK(heth);
+#if ETH_FAST_INIT
+/**
+  * @brief Initialize MAC and DMA as HAL_ETH_Init() does, with the speed and
+  * duplex mode set in EthHandle, but without resetting PHY nor waiting for
+  * auto-negotiation. PHY keeps auto-negotiating, or the link it already has
+  * (e.g. after MCU reset). STM32F2/F4/F7 only (MII/RMII selected in
+  * SYSCFG_PMC, as HAL_ETH_Init() of these families does).
+  *
+  * @return HAL_OK if link is up
+  *         HAL_TIMEOUT if link is not up yet
+  *         HAL_ERROR if DMA software reset is not done
+  */
+static HAL_StatusTypeDef low_level_fast_init(void) {
+  uint32_t tickstart;
+  uint32_t hclk;
+  uint32_t regvalue;
+  uint8_t *mac = EthHandle.Init.MACAddr;
 
-    return  HAL_ERROR;
+  if (EthHandle.State == HAL_ETH_STATE_RESET) {
+    EthHandle.Lock = HAL_UNLOCKED;
+    HAL_ETH_MspInit(&EthHandle);
   }
 
-  /* Check if the descriptor is owned by the ETHERNET DMA (when set) or CPU (when reset) */
-  if (((heth->TxDesc)->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET) {
-    /* OWN bit set */
-    heth->State = HAL_ETH_STATE_BUSY_TX;
-
-    /* Process Unlocked */
-    __HAL_UNLOCK(heth);
-
-    return HAL_ERROR;
+  /* Select MII or RMII mode */
+  __HAL_RCC_SYSCFG_CLK_ENABLE();
+  SYSCFG->PMC &= ~(SYSCFG_PMC_MII_RMII_SEL);
+  SYSCFG->PMC |= (uint32_t)EthHandle.Init.MediaInterface;
+
+  /* Reset MAC and DMA, which needs the clocks from PHY */
+  EthHandle.Instance->DMABMR |= ETH_DMABMR_SR;
+  tickstart = HAL_GetTick();
+  while ((EthHandle.Instance->DMABMR & ETH_DMABMR_SR) != (uint32_t)RESET) {
+    if ((HAL_GetTick() - tickstart) > ETH_SWRESET_TIMEOUT_MS) {
+      LOG_E("DMA reset timeout");
+      return HAL_ERROR;
+    }
   }
 
-  if (bufcount == 1) {
-    /* Set LAST and FIRST segment */
-    heth->TxDesc->Status |=ETH_DMATXDESC_FS|ETH_DMATXDESC_LS;
-    /* Set Own bit of the Tx descriptor Status: gives the buffer back to ETHERNET DMA */
-    heth->TxDesc->Status |= ETH_DMATXDESC_OWN;
-    /* Point to next descriptor */
-    heth->TxDesc = (ETH_DMADescTypeDef *)(heth->TxDesc->Buffer2NextDescAddr);
+  /* MDC clock range */
+  regvalue = EthHandle.Instance->MACMIIAR & ETH_MACMIIAR_CR_MASK;
+  hclk = HAL_RCC_GetHCLKFreq();
+  if (hclk < 35000000U) {
+    regvalue |= ETH_MACMIIAR_CR_Div16;
+  } else if (hclk < 60000000U) {
+    regvalue |= ETH_MACMIIAR_CR_Div26;
+  } else if (hclk < 100000000U) {
+    regvalue |= ETH_MACMIIAR_CR_Div42;
+  } else if (hclk < 150000000U) {
+    regvalue |= ETH_MACMIIAR_CR_Div62;
   } else {
-    for (i = 0; i < bufcount; i++) {
-      /* Clear FIRST and LAST segment bits */
-      heth->TxDesc->Status &= ~(ETH_DMATXDESC_FS | ETH_DMATXDESC_LS);
-
-      if (i == 0) {
-        /* Setting the first segment bit */
-        heth->TxDesc->Status |= ETH_DMATXDESC_FS;
-      } else if (i == (bufcount-1)) {
-        /* Setting the last segment bit */
-        heth->TxDesc->Status |= ETH_DMATXDESC_LS;
-      }
-
-      /* Set Own bit of the Tx descriptor Status: gives the buffer back to ETHERNET DMA */
-      heth->TxDesc->Status |= ETH_DMATXDESC_OWN;
-      /* point to next descriptor */
-      heth->TxDesc = (ETH_DMADescTypeDef *)(heth->TxDesc->Buffer2NextDescAddr);
-    }
+    regvalue |= ETH_MACMIIAR_CR_Div102;
   }
+  EthHandle.Instance->MACMIIAR = regvalue;
 
-  /* When Tx Buffer unavailable flag is set: clear it and resume transmission */
-  if (((heth->Instance)->DMASR & ETH_DMASR_TBUS) != (uint32_t)RESET) {
-    /* Clear TBUS ETHERNET DMA flag */
-    (heth->Instance)->DMASR = ETH_DMASR_TBUS;
-    /* Resume DMA transmission*/
-    (heth->Instance)->DMATPDR = 0;
+  eth_macdma_config();
+  if (EthHandle.Init.RxMode == ETH_RXINTERRUPT_MODE) {
+    __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_NIS | ETH_DMA_IT_R);
   }
 
-  /* Set ETH HAL State to Ready */
-  heth->State = HAL_ETH_STATE_READY;
+  /* Low register first, the address is taken when high register written */
+  EthHandle.Instance->MACA0LR = ((uint32_t)mac[3] << 24) | ((uint32_t)mac[2] << 16) | ((uint32_t)mac[1] << 8) | mac[0];
+  EthHandle.Instance->MACA0HR = ((uint32_t)mac[5] << 8) | mac[4];
 
-  /* Process Unlocked */
-  __HAL_UNLOCK(heth);
+  EthHandle.State = HAL_ETH_STATE_READY;
 
-  /* Return function status */
-  return HAL_OK;
+  /* One MDIO read, without waiting for the link */
+  regvalue = 0;
+  (void)HAL_ETH_ReadPHYRegister(&EthHandle, PHY_BSR, &regvalue);
+  return ((regvalue & PHY_LINKED_STATUS) != (uint32_t)RESET) ? HAL_OK : HAL_TIMEOUT;
 }
+#endif /* ETH_FAST_INIT */
 
 /**
-  * @brief This function should do the actual transmission of the packet. The packet is
-  * contained in the pbuf that is passed to the function. This pbuf
-  * might be chained.
+  * @brief Give the descriptors of a frame, from the current TX descriptor, to
+  * TX DMA. The first descriptor is given last, so DMA never sees a partial
+  * frame. Lock-free: the TX descriptors are only written with TCPIP core
+  * locked (single producer), and DMA is resumed by tx_doorbell().
   *
-  * @param netif the lwip network interface structure for this ethernetif
-  * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
-  * @return ERR_OK if the packet could be sent
-  *         an err_t value if the packet couldn't be sent
-  *
-  * @note Returning ERR_MEM here if a DMA queue of your MAC is full can lead to
-  *       strange results. You might consider waiting for space in the DMA queue
-  *       to become available since the stack doesn't retry to send a packet
-  *       dropped because of memory failure (except for the TCP timers).
+  * @param bufcount number of descriptors of the frame
+  * @return None
   */
-static err_t low_level_output(struct netif *netif, struct pbuf *p) {
-  err_t errval;
-  struct pbuf *q;
-  __IO ETH_DMADescTypeDef *DmaTxDesc;
-  uint32_t bufcount = 0;
-  uint32_t i = 0;
-
-  UNUSED(netif);
+static void tx_desc_commit(uint32_t bufcount) {
+  __IO ETH_DMADescTypeDef *first = EthHandle.TxDesc;
+  __IO ETH_DMADescTypeDef *desc = first;
+  uint32_t i;
 
-  /* Check if all done */
-  DmaTxDesc = EthHandle.TxDesc;
-  for (i = 0; i < ETH_TXBUFNB; i++) {
-    // LOG_D("output chk %d %08x %08x", i, DmaTxDesc, DmaTxDesc->Status);
-    if ((DmaTxDesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET) {
-      break;
+  for (i = 0; i < bufcount; i++) {
+    desc->Status &= ~(ETH_DMATXDESC_FS | ETH_DMATXDESC_LS);
+    if (i == 0) {
+      desc->Status |= ETH_DMATXDESC_FS;
+    }
+    if (i == (bufcount - 1)) {
+      desc->Status |= ETH_DMATXDESC_LS;
     }
+    if (i != 0) {
+      desc->Status |= ETH_DMATXDESC_OWN;
+    }
+    desc = (ETH_DMADescTypeDef *)(desc->Buffer2NextDescAddr);
+  }
 
-    /* Point to next descriptor */
-    DmaTxDesc = (ETH_DMADescTypeDef *)(DmaTxDesc->Buffer2NextDescAddr);
+  /* Descriptors and buffers are written before DMA may read them */
+  __DMB();
+  first->Status |= ETH_DMATXDESC_OWN;
+  EthHandle.TxDesc = (ETH_DMADescTypeDef *)desc;
+}
+
+/**
+  * @brief Resume TX DMA if it is suspended, as TX buffer unavailable (TBUS)
+  * or TX underflow (TUS). Called once per batch of frames, and may be called
+  * without TCPIP core locked as it only writes DMA status and poll demand.
+  *
+  * @return None
+  */
+static void tx_doorbell(void) {
+  uint32_t dmasr = EthHandle.Instance->DMASR & (ETH_DMASR_TBUS | ETH_DMASR_TUS);
+
+  if (dmasr == 0) {
+    return;
+  }
+#if ETH_BENCHMARK
+  if ((dmasr & ETH_DMASR_TBUS) && (bench_fault & ETH_FAULT_TX_STALL)) {
+    /* Lose the poll demand: TX DMA stays suspended until the next one */
+    bench_fault &= ~ETH_FAULT_TX_STALL;
+    tx_recover_start = BENCH_CYCLES();
+    tx_recovering = 1;
+    return;
+  }
+  if (tx_recovering) {
+    tx_recovering = 0;
+    bench_recovered(tx_recover_start, &bench.tx_recover_cnt, &bench.tx_recover_cycles, &bench.tx_recover_max);
+  }
+#endif
+  /* Clear TBUS and TUS ETHERNET DMA flag */
+  EthHandle.Instance->DMASR = dmasr;
+  /* Resume DMA transmission */
+  EthHandle.Instance->DMATPDR = 0;
+  stats.tx_poll_demand++;
+}
+
+#if ETH_TX_BOUNCE_NB
+/**
+  * @brief Copy a frame to a bounce buffer and hand it to TX DMA with one
+  * descriptor. The "pbuf" is not held.
+  *
+  * @param p the MAC packet to send
+  * @return ERR_OK if the packet is handed to DMA
+  *         ERR_USE if no free TX descriptor for now
+  */
+static err_t tx_frame_copy(struct pbuf *p) {
+  __IO ETH_DMADescTypeDef *DmaTxDesc = EthHandle.TxDesc;
+  uint8_t *buf;
+
+  if ((tx_busy >= ETH_TXBUFNB) || ((DmaTxDesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET)) {
+    return ERR_USE;
   }
-  if (i != ETH_TXBUFNB) {
-    LOG_D("output chk %d/%d", i, ETH_TXBUFNB);
+
+  buf = tx_bounce_free[--tx_bounce_cnt];
+  (void)pbuf_copy_partial(p, buf, p->tot_len, 0);
+  DmaTxDesc->Buffer1Addr = (uint32_t)buf;
+  DmaTxDesc->ControlBufferSize = (p->tot_len & ETH_DMATXDESC_TBS1);
+  tx_bounce[DmaTxDesc - DMATxDscrTab] = buf;
+  tx_busy++;
+  if (tx_busy > stats.tx_busy_max) {
+    stats.tx_busy_max = tx_busy;
   }
+  stats.tx_copybreak++;
 
-  /* Free "pbuf" */
-  while ((i == ETH_TXBUFNB) && (!is_empty(&tx_free_queue))) {
-    q = (struct pbuf *)queue_get(&tx_free_queue);
-    pbuf_free(q);
+  tx_desc_commit(1);
+#if ETH_PTP
+  tx_ts_seq = (tx_ts_seq + 1) & 0x00FFFFFF;
+  if (tx_ts_seq == 0) {
+    tx_ts_seq = 1;
   }
+  tx_ts_desc_seq[DmaTxDesc - DMATxDscrTab] = tx_ts_seq;
+#endif
+
+#if ETH_BENCHMARK
+  bench.tx_frames++;
+  bench.tx_bytes += p->tot_len;
+#endif
+  return ERR_OK;
+}
+#endif /* ETH_TX_BOUNCE_NB */
 
-  if (pbuf_clen(p) > ETH_TXBUFNB) {
-      errval = ENOBUFS;
-      LOG_E("output ENOBUFS");
-      goto error;
+/**
+  * @brief Hand a frame to TX DMA. The "pbuf" is held by the last descriptor
+  * of the frame until transmitted. Small frames (ETH_TX_COPYBREAK) and
+  * chains not fitting in free descriptors are copied to a bounce buffer
+  * instead, if one is free.
+  *
+  * @param p the MAC packet to send
+  * @return ERR_OK if the packet is handed to DMA
+  *         ERR_USE if not enough free TX descriptors for now
+  *         ERR_MEM if the packet can't be sent
+  */
+static err_t tx_frame_send(struct pbuf *p) {
+  struct pbuf *q;
+  __IO ETH_DMADescTypeDef *DmaTxDesc;
+  __IO ETH_DMADescTypeDef *LastTxDesc = NULL;
+  uint32_t bufcount = pbuf_clen(p);
+
+#if ETH_TX_BOUNCE_NB
+  if ((p->tot_len <= ETH_TX_BUF_SIZE) &&
+      ((p->tot_len <= ETH_TX_COPYBREAK) || (bufcount > (ETH_TXBUFNB - tx_busy)))) {
+    if (tx_bounce_cnt > 0) {
+      return tx_frame_copy(p);
+    }
+    /* No free bounce buffer: send it zero-copy if descriptors allow */
+    stats.tx_bounce_empty++;
+  }
+#endif
+  if (bufcount > ETH_TXBUFNB) {
+    LOG_E("output ERR_MEM");
+    return ERR_MEM;
+  }
+  if (bufcount > (ETH_TXBUFNB - tx_busy)) {
+    return ERR_USE;
   }
 
   /* Prepare DMA buffers */
@@ -409,54 +1141,399 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p) {
   for (q = p; q != NULL; q = q->next) {
     /* Is this buffer available? If not, goto error */
     if ((DmaTxDesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET) {
-      errval = ERR_USE;
-      LOG_E("output ERR_USE");
-      goto error;
+      return ERR_USE;
     }
 
     /* Check if the length of data is bigger than Tx buffer size*/
     if (q->len > ETH_TX_BUF_SIZE) {
-      errval = ENOBUFS;
-      LOG_E("output ENOBUFS2");
-      goto error;
-    }
-
-    /* Put "pbuf" to free queue */
-    if (!bufcount) {
-      if (!queue_put(&tx_free_queue, (void *)p)) {
-        LOG_E("TX Q full");
-        errval = ENOBUFS;
-        goto error;
-      }
-      pbuf_ref(p);
+      LOG_E("output ERR_MEM2");
+      return ERR_MEM;
     }
 
     DmaTxDesc->Buffer1Addr = (uint32_t)q->payload;
     DmaTxDesc->ControlBufferSize = (q->len & ETH_DMATXDESC_TBS1);
-    bufcount++;
+    LastTxDesc = DmaTxDesc;
 
     /* Point to next descriptor */
     DmaTxDesc = (ETH_DMADescTypeDef *)(DmaTxDesc->Buffer2NextDescAddr);
   }
 
-  /* Prepare transmit descriptors to give to DMA */
-  (void)HAL_ETH_TransmitFrame2(&EthHandle, bufcount);
+  /* The last descriptor holds "pbuf" until transmitted */
+  pbuf_ref(p);
+  tx_pbuf[LastTxDesc - DMATxDscrTab] = p;
+  tx_busy += bufcount;
+  if (tx_busy > stats.tx_busy_max) {
+    stats.tx_busy_max = tx_busy;
+  }
 
-  errval = ERR_OK;
+  /* Give descriptors to DMA, which is resumed once per batch */
+  tx_desc_commit(bufcount);
+#if ETH_PTP
+  /* Time stamp is written to the last descriptor of frame */
+  tx_ts_seq = (tx_ts_seq + 1) & 0x00FFFFFF;
+  if (tx_ts_seq == 0) {
+    tx_ts_seq = 1;
+  }
+  tx_ts_desc_seq[LastTxDesc - DMATxDscrTab] = tx_ts_seq;
+#endif
 
-error:
+#if ETH_BENCHMARK
+  bench.tx_frames++;
+  bench.tx_bytes += p->tot_len;
+#endif
+  return ERR_OK;
+}
 
-  /* When Transmit Underflow flag is set, clear it and issue a Transmit Poll Demand to resume transmission */
-  if ((EthHandle.Instance->DMASR & ETH_DMASR_TUS) != (uint32_t)RESET) {
-    /* Clear TUS ETHERNET DMA flag */
-    EthHandle.Instance->DMASR = ETH_DMASR_TUS;
+#if ETH_TX_QUEUE_LEN
+#if (ETH_TX_QUEUE_POLICY == ETH_TX_DROP_PRIO)
+/**
+  * @brief Get the priority of a frame: 1 for ARP and TCP segments without
+  * data (ACK, SYN, FIN, RST), 0 for the others.
+  *
+  * @param p the MAC packet
+  * @return priority
+  */
+static uint8_t tx_frame_prio(const struct pbuf *p) {
+  const struct eth_hdr *ethhdr = (const struct eth_hdr *)p->payload;
+  const struct ip_hdr *iphdr;
+  uint16_t iphlen;
+  uint16_t tcphlen;
+  const uint8_t *tcphdr;
+
+  if (p->len < SIZEOF_ETH_HDR) {
+    return 0;
+  }
+  if (ethhdr->type == PP_HTONS(ETHTYPE_ARP)) {
+    return 1;
+  }
+  if ((ethhdr->type != PP_HTONS(ETHTYPE_IP)) || (p->len < (SIZEOF_ETH_HDR + IP_HLEN))) {
+    return 0;
+  }
+
+  iphdr = (const struct ip_hdr *)((const uint8_t *)p->payload + SIZEOF_ETH_HDR);
+  if (IPH_PROTO(iphdr) != IP_PROTO_TCP) {
+    return 0;
+  }
+  /* TCP header is in the first pbuf */
+  iphlen = IPH_HL_BYTES(iphdr);
+  if (p->len < (SIZEOF_ETH_HDR + iphlen + 20)) {
+    return 0;
+  }
+  tcphdr = (const uint8_t *)iphdr + iphlen;
+  tcphlen = (tcphdr[12] >> 4) * 4;
+  return (lwip_ntohs(IPH_LEN(iphdr)) <= (iphlen + tcphlen)) ? 1 : 0;
+}
+#endif /* ETH_TX_DROP_PRIO */
+
+#if (ETH_TX_PRIO_NUM > 1)
+/**
+  * @brief Get the TX priority class of a frame:
+  *   - ETH_TX_PRIO_HIGH for ARP and TCP segments with ACK only
+  *   - the class of IP precedence, set by socket priority
+  *   - the class of the first matching ETH_TX_PRIO_RULES
+  *   - else 0
+  *
+  * @param p the MAC packet
+  * @return priority class
+  */
+static uint8_t tx_frame_class(const struct pbuf *p) {
+  const struct eth_hdr *ethhdr = (const struct eth_hdr *)p->payload;
+  const struct ip_hdr *iphdr;
+  const uint8_t *l4hdr;
+  uint16_t iphlen;
+  uint16_t sport = 0;
+  uint16_t dport = 0;
+  uint8_t proto;
+  uint32_t i;
+
+  if (p->len < SIZEOF_ETH_HDR) {
+    return 0;
+  }
+  if (ethhdr->type == PP_HTONS(ETHTYPE_ARP)) {
+    return ETH_TX_PRIO_HIGH;
+  }
+  if ((ethhdr->type != PP_HTONS(ETHTYPE_IP)) || (p->len < (SIZEOF_ETH_HDR + IP_HLEN))) {
+    return 0;
+  }
+
+  iphdr = (const struct ip_hdr *)((const uint8_t *)p->payload + SIZEOF_ETH_HDR);
+  iphlen = IPH_HL_BYTES(iphdr);
+  proto = IPH_PROTO(iphdr);
+  l4hdr = (const uint8_t *)iphdr + iphlen;
+  /* TCP/UDP header is in the first pbuf, and in the first fragment only */
+  if (((proto == IP_PROTO_TCP) || (proto == IP_PROTO_UDP)) &&
+      ((lwip_ntohs(IPH_OFFSET(iphdr)) & IP_OFFMASK) == 0) &&
+      (p->len >= (SIZEOF_ETH_HDR + iphlen + 4))) {
+    sport = (uint16_t)((l4hdr[0] << 8) | l4hdr[1]);
+    dport = (uint16_t)((l4hdr[2] << 8) | l4hdr[3]);
+    if ((proto == IP_PROTO_TCP) && (p->len >= (SIZEOF_ETH_HDR + iphlen + 20)) &&
+        ((l4hdr[13] & (TCP_SYN | TCP_FIN | TCP_RST)) == 0) &&
+        (lwip_ntohs(IPH_LEN(iphdr)) <= (iphlen + (l4hdr[12] >> 4) * 4))) {
+      /* ACK only, never reordered with data of the same connection */
+      return ETH_TX_PRIO_HIGH;
+    }
+  }
+
+  if (IPH_TOS(iphdr) >> 5) {
+    return (uint8_t)(((IPH_TOS(iphdr) >> 5) * ETH_TX_PRIO_NUM) / 8);
+  }
+
+  for (i = 0; i < TX_PRIO_RULE_NUM; i++) {
+    const ethernetif_tx_rule_t *rule = &tx_prio_rule[i];
+
+    if (rule->proto && (rule->proto != proto)) {
+      continue;
+    }
+    if (rule->port && (rule->port != sport) && (rule->port != dport)) {
+      continue;
+    }
+    return (rule->prio > ETH_TX_PRIO_HIGH) ? ETH_TX_PRIO_HIGH : rule->prio;
+  }
+
+  return 0;
+}
+#else
+#define tx_frame_class(p) 0
+#endif /* ETH_TX_PRIO_NUM > 1 */
+
+/**
+  * @brief Check if any frame of class "cls" or higher is queued.
+  *
+  * @param cls priority class
+  * @return 1 if queued, else 0
+  */
+static uint8_t tx_queue_busy(uint8_t cls) {
+  for (; cls < ETH_TX_PRIO_NUM; cls++) {
+    if (tx_queue[cls].count) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief Queue a frame until TX descriptors are free. When the queue of its
+  * class is full, drop the new frame (ETH_TX_DROP_TAIL), or the newest frame
+  * of a lower priority if any (ETH_TX_DROP_PRIO).
+  *
+  * @param cls priority class
+  * @param p the MAC packet to send
+  * @return ERR_OK if the packet is queued
+  *         ERR_MEM if the packet is dropped
+  */
+static err_t tx_queue_put(uint8_t cls, struct pbuf *p) {
+  tx_queue_t *queue = &tx_queue[cls];
+  uint32_t i;
+#if (ETH_TX_QUEUE_POLICY == ETH_TX_DROP_PRIO)
+  uint8_t prio = tx_frame_prio(p);
+#endif
+
+  if (queue->count >= ETH_TX_QUEUE_LEN) {
+#if (ETH_TX_QUEUE_POLICY == ETH_TX_DROP_PRIO)
+    /* Find the newest frame of lower priority */
+    for (i = queue->count; i > 0; i--) {
+      if (queue->prio[(queue->head + i - 1) % ETH_TX_QUEUE_LEN] < prio) {
+        break;
+      }
+    }
+    if (i == 0) {
+      stats.tx_queue_drop++;
+      return ERR_MEM;
+    }
+    /* Drop it, and move the newer ones forward */
+    pbuf_free(queue->p[(queue->head + i - 1) % ETH_TX_QUEUE_LEN]);
+    stats.tx_queue_drop++;
+    for (; i < queue->count; i++) {
+      queue->p[(queue->head + i - 1) % ETH_TX_QUEUE_LEN] = queue->p[(queue->head + i) % ETH_TX_QUEUE_LEN];
+      queue->prio[(queue->head + i - 1) % ETH_TX_QUEUE_LEN] = queue->prio[(queue->head + i) % ETH_TX_QUEUE_LEN];
+    }
+    queue->count--;
+#else
+    UNUSED(i);
+    stats.tx_queue_drop++;
+    return ERR_MEM;
+#endif
+  }
+
+  i = (queue->head + queue->count) % ETH_TX_QUEUE_LEN;
+  pbuf_ref(p);
+  queue->p[i] = p;
+#if (ETH_TX_QUEUE_POLICY == ETH_TX_DROP_PRIO)
+  queue->prio[i] = prio;
+#endif
+  queue->count++;
+  stats.tx_queued++;
+  if (queue->count > stats.tx_queue_max) {
+    stats.tx_queue_max = queue->count;
+  }
+  return ERR_OK;
+}
+
+/**
+  * @brief Hand queued frames to TX DMA in priority order, while TX
+  * descriptors are free.
+  * Called with TCPIP core locked.
+  *
+  * @return None
+  */
+static void tx_queue_flush(void) {
+  tx_queue_t *queue;
+  struct pbuf *p;
+  uint32_t cls;
+
+  /* Strict priority, higher class first */
+  for (cls = ETH_TX_PRIO_NUM; cls > 0; cls--) {
+    queue = &tx_queue[cls - 1];
+    while (queue->count) {
+      p = queue->p[queue->head];
+      if (tx_frame_send(p) == ERR_USE) {
+        return;
+      }
+      /* Sent, or can never be */
+      queue->p[queue->head] = NULL;
+      queue->head = (queue->head + 1) % ETH_TX_QUEUE_LEN;
+      queue->count--;
+      pbuf_free(p);
+    }
+  }
+}
+#endif /* ETH_TX_QUEUE_LEN */
+
+/**
+  * @brief This function should do the actual transmission of the packet. The packet is
+  * contained in the pbuf that is passed to the function. This pbuf
+  * might be chained.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+  * @return ERR_OK if the packet could be sent
+  *         an err_t value if the packet couldn't be sent
+  *
+  * @note Returning ERR_MEM here if a DMA queue of your MAC is full can lead to
+  *       strange results. You might consider waiting for space in the DMA queue
+  *       to become available since the stack doesn't retry to send a packet
+  *       dropped because of memory failure (except for the TCP timers).
+  *       So the packet waits in TX queue (ETH_TX_QUEUE_LEN) while TX
+  *       descriptors are busy, and is sent when they are reclaimed.
+  */
+static err_t low_level_output(struct netif *netif, struct pbuf *p) {
+  err_t errval;
+#if ETH_TX_QUEUE_LEN
+  uint8_t cls;
+#endif
+#if ETH_BENCHMARK
+  uint32_t start = BENCH_CYCLES();
+#endif
+
+  UNUSED(netif);
+
+#if ETH_INIT_ASYNC
+  /* Hardware not initialized yet */
+  if (!phy.ready) {
+    return ERR_IF;
+  }
+#endif
+
+  /* Free "pbuf" of transmitted frames, and send queued ones */
+  tx_reclaim();
+
+  /* No frame: only reclaim and resume transmission */
+  if (p == NULL) {
+    errval = ERR_OK;
+    goto error;
+  }
+
+#if ETH_TX_QUEUE_LEN
+  /* Keep frames of the same class in order, and behind higher classes */
+  cls = tx_frame_class(p);
+  if (tx_queue_busy(cls)) {
+    errval = tx_queue_put(cls, p);
+    goto error;
+  }
+#endif
+
+  errval = tx_frame_send(p);
+#if ETH_TX_QUEUE_LEN
+  if (errval == ERR_USE) {
+    /* Wait for TX descriptors */
+    errval = tx_queue_put(cls, p);
+  } else if (cls && tx_queue_busy(0)) {
+    stats.tx_prio_ahead++;
+  }
+#else
+  if (errval == ERR_USE) {
+    LOG_E("output ERR_USE");
+  }
+#endif
+
+error:
 
-    /* Resume DMA transmission*/
-    EthHandle.Instance->DMATPDR = 0;
+  /* Resume TX DMA, unless more frames are coming */
+  if ((p == NULL) || !tx_more) {
+    tx_doorbell();
+  }
+#if ETH_BENCHMARK
+  if (p != NULL) {
+    bench.tx_cycles += BENCH_CYCLES() - start;
   }
+#endif
   return errval;
 }
 
+/**
+  * @brief Free "pbuf" of the transmitted frames, from the oldest TX
+  * descriptor until one still owned by DMA, then send queued frames.
+  * Called with TCPIP core locked.
+  *
+  * @return None
+  */
+static void tx_reclaim(void)
+{
+  uint32_t i;
+
+  while (tx_busy) {
+    i = tx_reclaim_idx;
+    if ((DMATxDscrTab[i].Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET) {
+      break;
+    }
+    if (tx_pbuf[i] != NULL) {
+      pbuf_free(tx_pbuf[i]);
+      tx_pbuf[i] = NULL;
+      stats.tx_reclaim++;
+    }
+#if ETH_TX_BOUNCE_NB
+    if (tx_bounce[i] != NULL) {
+      tx_bounce_free[tx_bounce_cnt++] = tx_bounce[i];
+      tx_bounce[i] = NULL;
+      stats.tx_reclaim++;
+    }
+#endif
+    tx_reclaim_idx = (i + 1) % ETH_TXBUFNB;
+    tx_busy--;
+  }
+#if ETH_TX_QUEUE_LEN
+  tx_queue_flush();
+#endif
+}
+
+#ifdef ETH_INPUT_USE_IT
+/**
+  * @brief Reclaim transmitted frames in tcpip_thread, posted by TX complete
+  * interrupt.
+  *
+  * @param arg the lwip network interface structure for this ethernetif
+  */
+static void ethernetif_tx_reclaim(void *arg)
+{
+  UNUSED(arg);
+  tx_reclaim_pending = 0;
+  tx_reclaim();
+  if (!tx_more) {
+    tx_doorbell();
+  }
+}
+#endif
+
 /**
   * @brief Should allocate a pbuf and transfer the bytes of the incoming
   * packet from the interface into the pbuf.
@@ -467,13 +1544,16 @@ error:
   */
 static struct pbuf *low_level_input(struct netif *netif)
 {
-  void *new_buf = NULL;
+  uint8_t *new_buf = NULL;
   lwip_custom_pbuf_t *custom_p = NULL;
   struct pbuf *p = NULL;
   uint16_t len;
   uint8_t *buffer;
   __IO ETH_DMADescTypeDef *dmarxdesc;
   uint32_t i = 0;
+#if ETH_BENCHMARK
+  uint32_t start = BENCH_CYCLES();
+#endif
 
   UNUSED(netif);
 
@@ -496,34 +1576,86 @@ static struct pbuf *low_level_input(struct netif *netif)
       break;
     }
 
+    /* MAC only flags VLAN frames not matching the VLAN tag filter */
+    if (rx_vlan_id && (len >= (SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR)) &&
+        (((struct eth_hdr *)buffer)->type == PP_HTONS(ETHTYPE_VLAN)) &&
+        ((lwip_ntohs(((struct eth_vlan_hdr *)(buffer + SIZEOF_ETH_HDR))->prio_vid) & 0x0FFF) != rx_vlan_id)) {
+      stats.rx_vlan_drop++;
+      break;
+    }
+
+#if ETH_FLOW_FILTER
+    /* Drop unwanted frame and keep its buffer in descriptor */
+    if (!rx_filter_pass(buffer, len)) {
+      break;
+    }
+#endif
+
+    /* Allocate new buf */
+    new_buf = rx_reservoir_get();
+    if (new_buf == NULL) {
+      LOG_E("RX Q empty");
+      break;
+    }
+
     /* Allocate "pbuf" */
     custom_p = (lwip_custom_pbuf_t *)LWIP_MEMPOOL_ALLOC(RX_POOL);
     if (custom_p == NULL) {
       LOG_E("RX_POOL empty");
+      rx_reservoir_put(new_buf);
       break;
     }
     custom_p->custom_p.custom_free_function = lwip_custom_pbuf_free;
     custom_p->buf = buffer;
+#if ETH_PTP
+    /* Enhanced descriptor: TimeStampLow in ns with digital rollover */
+    custom_p->ts.sec = EthHandle.RxFrameInfos.LSRxDesc->TimeStampHigh;
+    custom_p->ts.nsec = EthHandle.RxFrameInfos.LSRxDesc->TimeStampLow;
+#endif
+#if ETH_RX_BATCH
+    custom_p->next = NULL;
+#endif
     p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &custom_p->custom_p, buffer, ETH_RX_BUF_SIZE);
     if (p == NULL) {
       LOG_E("PBUF_REF empty");
       LWIP_MEMPOOL_FREE(RX_POOL, custom_p);
+      rx_reservoir_put(new_buf);
       break;
     }
 
-    /* Allocate new buf */
-    if (is_empty(&rx_buf_queue)) {
-      LOG_E("RX Q empty, %d %d", rx_buf_queue.put_cnt, rx_buf_queue.get_cnt);
-      LWIP_MEMPOOL_FREE(RX_POOL, custom_p);
-      p = NULL;
-      break;
-    }
-    new_buf = queue_get(&rx_buf_queue);
-    // LOG_D("RX %p (%d), %d", EthHandle.RxFrameInfos.FSRxDesc->Buffer1Addr, len, (rx_buf_queue.put_cnt - rx_buf_queue.get_cnt));
-    LOG_D("RX Q- %p %d", new_buf, rx_buf_queue.put_cnt - rx_buf_queue.get_cnt);
+    LOG_D("RX Q- %p %d", new_buf, rx_reservoir.count);
     EthHandle.RxFrameInfos.FSRxDesc->Buffer1Addr = (uint32_t)new_buf;
   } while (0);
 
+#if ETH_BENCHMARK
+  if (p != NULL) {
+    bench.rx_frames++;
+    bench.rx_bytes += len;
+    if (rx_recovering) {
+      rx_recovering = 0;
+      bench_recovered(rx_recover_start, &bench.rx_recover_cnt, &bench.rx_recover_cycles, &bench.rx_recover_max);
+    }
+  }
+
+  if ((bench_fault & ETH_FAULT_RX_EXHAUST) && (EthHandle.RxFrameInfos.SegCount == 1)) {
+    /* Keep the descriptor from DMA */
+    rx_held[rx_held_cnt++] = EthHandle.RxFrameInfos.FSRxDesc;
+    if (rx_held_cnt == ETH_RXBUFNB) {
+      /* Ring exhausted: give it back but leave DMA suspended */
+      for (i = 0; i < rx_held_cnt; i++) {
+        rx_held[i]->Status |= ETH_DMARXDESC_OWN;
+      }
+      rx_held_cnt = 0;
+      bench_fault &= ~ETH_FAULT_RX_EXHAUST;
+      rx_recover_start = BENCH_CYCLES();
+      rx_recovering = 1;
+    }
+    EthHandle.RxFrameInfos.SegCount = 0;
+    bench.rx_cycles += BENCH_CYCLES() - start;
+    return p;
+  }
+#endif
+
   /* Release descriptors to DMA */
   /* Point to first descriptor */
   dmarxdesc = EthHandle.RxFrameInfos.FSRxDesc;
@@ -542,43 +1674,777 @@ static struct pbuf *low_level_input(struct netif *netif)
     EthHandle.Instance->DMASR = ETH_DMASR_RBUS;
     /* Resume DMA reception */
     EthHandle.Instance->DMARPDR = 0;
+#ifdef ETH_INPUT_USE_IT
+    /* Unmask the interrupt masked by HAL_ETH_ErrorCallback() */
+    __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_RBU);
+#endif
   }
+#if ETH_BENCHMARK
+  bench.rx_cycles += BENCH_CYCLES() - start;
+#endif
   return p;
 }
 
+#if ETH_RX_GRO
 /**
-  * @brief This function should be called when a packet is ready to be read
-  * from the interface. It uses the function low_level_input() that
-  * should handle the actual reception of bytes from the network
-  * interface. Then the type of the received packet is determined and
-  * the appropriate input function is called.
+  * @brief Get the TCP header of a frame which may be coalesced: IPv4 TCP
+  * segment in a single buffer, without IP options nor fragmentation.
   *
-  * @param netif the lwip network interface structure for this ethernetif
+  * @param p the received frame
+  * @return TCP header, or NULL
   */
-void ethernetif_input(struct netif *netif) {
-  err_t err;
-  struct pbuf *p = NULL;
-
-  do {
-    /* move received packet into a new pbuf */
-    p = low_level_input(netif);
-    if (p == NULL) {
-      /* no packet could be read, silently ignore this */
-      break;
-    }
+static struct tcp_hdr *rx_gro_tcp(struct pbuf *p) {
+  struct eth_hdr *ethhdr = (struct eth_hdr *)p->payload;
+  struct ip_hdr *iphdr;
 
-    /* pass Ethernet package to LwIP stack */
-    err = netif->input(p, netif);
-    if (err != ERR_OK) {
-      // LOG_E("netif->input err: %d", err);
-      pbuf_free(p);
-      continue;
-    }
-  } while (p != NULL);
+  if ((p->next != NULL) || (p->len < (SIZEOF_ETH_HDR + IP_HLEN + TCP_HLEN)) ||
+      (ethhdr->type != PP_HTONS(ETHTYPE_IP))) {
+    return NULL;
+  }
+  iphdr = (struct ip_hdr *)((uint8_t *)p->payload + SIZEOF_ETH_HDR);
+  if ((IPH_HL_BYTES(iphdr) != IP_HLEN) || (IPH_PROTO(iphdr) != IP_PROTO_TCP) ||
+      ((lwip_ntohs(IPH_OFFSET(iphdr)) & (IP_MF | IP_OFFMASK)) != 0) ||
+      (lwip_ntohs(IPH_LEN(iphdr)) > (p->len - SIZEOF_ETH_HDR))) {
+    return NULL;
+  }
+  return (struct tcp_hdr *)((uint8_t *)iphdr + IP_HLEN);
 }
 
-err_t ethernetif_output(struct netif *netif, struct pbuf *p) {
-  return low_level_output(netif, p);
+/**
+  * @brief Pass the coalesced segment of a connection to LwIP stack.
+  *
+  * @param flow the connection
+  * @param netif the lwip network interface structure for this ethernetif
+  */
+static void rx_gro_flush(rx_gro_flow_t *flow, struct netif *netif) {
+  struct pbuf *p = flow->head;
+  struct ip_hdr *iphdr;
+
+  if (p == NULL) {
+    return;
+  }
+  flow->head = NULL;
+
+  if (flow->segs > 1) {
+    /* IP total length of all the segments */
+    iphdr = (struct ip_hdr *)((uint8_t *)p->payload + SIZEOF_ETH_HDR);
+    IPH_LEN_SET(iphdr, lwip_htons((uint16_t)(p->tot_len - SIZEOF_ETH_HDR)));
+#if CHECKSUM_CHECK_IP
+    IPH_CHKSUM_SET(iphdr, 0);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+#endif
+    stats.rx_gro_flush++;
+  }
+  if (ethernet_input(p, netif) != ERR_OK) {
+    pbuf_free(p);
+  }
+}
+
+/**
+  * @brief Pass all the coalesced segments to LwIP stack.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  */
+static void rx_gro_flush_all(struct netif *netif) {
+  uint32_t i;
+
+  for (i = 0; i < ETH_GRO_FLOWS; i++) {
+    rx_gro_flush(&rx_gro[i], netif);
+  }
+}
+
+#if ETH_GRO_FLUSH_MS
+static void rx_gro_timeout(void *arg) {
+  rx_gro_timer = 0;
+  ethernetif_tx_more(1);
+  rx_gro_flush_all((struct netif *)arg);
+  ethernetif_tx_more(0);
+}
+#endif
+
+/**
+  * @brief Coalesce a received TCP segment with the previous in-order ones of
+  * the same connection, or pass the frame to LwIP stack. A segment which
+  * can't be coalesced passes after the coalesced ones of its connection.
+  *
+  * @param p the received frame
+  * @param netif the lwip network interface structure for this ethernetif
+  */
+static void rx_gro_input(struct pbuf *p, struct netif *netif) {
+  struct tcp_hdr *tcphdr = rx_gro_tcp(p);
+  struct ip_hdr *iphdr;
+  struct ip_hdr *h_iphdr;
+  struct tcp_hdr *h_tcphdr = NULL;
+  rx_gro_flow_t *flow = NULL;
+  rx_gro_flow_t *free_flow = NULL;
+  uint16_t hlen;
+  uint16_t len;
+  uint8_t flags;
+  uint32_t i;
+
+  if (tcphdr == NULL) {
+    if (ethernet_input(p, netif) != ERR_OK) {
+      pbuf_free(p);
+    }
+    return;
+  }
+  iphdr = (struct ip_hdr *)((uint8_t *)tcphdr - IP_HLEN);
+
+  /* Find the connection */
+  for (i = 0; i < ETH_GRO_FLOWS; i++) {
+    if (rx_gro[i].head == NULL) {
+      if (free_flow == NULL) {
+        free_flow = &rx_gro[i];
+      }
+      continue;
+    }
+    h_iphdr = (struct ip_hdr *)((uint8_t *)rx_gro[i].head->payload + SIZEOF_ETH_HDR);
+    h_tcphdr = (struct tcp_hdr *)((uint8_t *)h_iphdr + IP_HLEN);
+    if ((h_tcphdr->src == tcphdr->src) && (h_tcphdr->dest == tcphdr->dest) &&
+        ip4_addr_cmp(&h_iphdr->src, &iphdr->src) && ip4_addr_cmp(&h_iphdr->dest, &iphdr->dest)) {
+      flow = &rx_gro[i];
+      break;
+    }
+  }
+
+  hlen = SIZEOF_ETH_HDR + IP_HLEN + TCPH_HDRLEN_BYTES(tcphdr);
+  len = SIZEOF_ETH_HDR + lwip_ntohs(IPH_LEN(iphdr));
+  flags = TCPH_FLAGS(tcphdr);
+  if (((flags & ~(TCP_ACK | TCP_PSH)) != 0) || !(flags & TCP_ACK) || (len <= hlen)) {
+    /* Control or without data */
+    if (flow != NULL) {
+      rx_gro_flush(flow, netif);
+    }
+    if (ethernet_input(p, netif) != ERR_OK) {
+      pbuf_free(p);
+    }
+    return;
+  }
+  /* Drop the padding */
+  if (p->tot_len > len) {
+    pbuf_realloc(p, len);
+  }
+
+  if (flow != NULL) {
+    if ((flow->segs < ETH_GRO_SEGS) && (lwip_ntohl(tcphdr->seqno) == flow->seq) &&
+        ((flow->head->tot_len + len - hlen) <= 0xFFFF) &&
+        (TCPH_HDRLEN(h_tcphdr) == TCPH_HDRLEN(tcphdr)) &&
+        (memcmp(h_tcphdr + 1, tcphdr + 1, TCPH_HDRLEN_BYTES(tcphdr) - TCP_HLEN) == 0)) {
+      /* Take the latest ACK and window, and chain the payload */
+      h_tcphdr->ackno = tcphdr->ackno;
+      h_tcphdr->wnd = tcphdr->wnd;
+      flow->seq += len - hlen;
+      flow->segs++;
+      (void)pbuf_remove_header(p, hlen);
+      pbuf_cat(flow->head, p);
+      stats.rx_gro_merged++;
+      if (flags & TCP_PSH) {
+        TCPH_SET_FLAG(h_tcphdr, TCP_PSH);
+        rx_gro_flush(flow, netif);
+      }
+      return;
+    }
+    /* Out of order, or full */
+    rx_gro_flush(flow, netif);
+  }
+
+  if (flags & TCP_PSH) {
+    if (ethernet_input(p, netif) != ERR_OK) {
+      pbuf_free(p);
+    }
+    return;
+  }
+
+  /* Start a coalesced segment */
+  if (flow == NULL) {
+    flow = free_flow;
+  }
+  if (flow == NULL) {
+    flow = &rx_gro[rx_gro_victim];
+    rx_gro_victim = (rx_gro_victim + 1) % ETH_GRO_FLOWS;
+    rx_gro_flush(flow, netif);
+  }
+  flow->head = p;
+  flow->seq = lwip_ntohl(tcphdr->seqno) + len - hlen;
+  flow->segs = 1;
+}
+#endif /* ETH_RX_GRO */
+
+#if ETH_RX_BATCH
+/**
+  * @brief Pass all the frames of the RX batch to LwIP stack. It runs in
+  * tcpip_thread, so the core lock is acquired only once per batch.
+  *
+  * @param arg the lwip network interface structure for this ethernetif
+  */
+static void ethernetif_input_batch(void *arg) {
+  struct netif *netif = (struct netif *)arg;
+  lwip_custom_pbuf_t *custom_p;
+  lwip_custom_pbuf_t *next;
+#if ETH_RX_GRO && ETH_GRO_FLUSH_MS
+  uint32_t i;
+#endif
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  /* Detach the batch, any later frame will post a new message */
+  SYS_ARCH_PROTECT(lev);
+  custom_p = rx_batch.head;
+  rx_batch.head = rx_batch.tail = NULL;
+  rx_batch.count = 0;
+  rx_batch.pending = 0;
+  SYS_ARCH_UNPROTECT(lev);
+
+  /* Frames sent in reply are handed to DMA with one TX poll demand */
+  ethernetif_tx_more(1);
+  while (custom_p != NULL) {
+    next = custom_p->next;
+    custom_p->next = NULL;
+#if ETH_RX_GRO
+    rx_gro_input(&custom_p->custom_p.pbuf, netif);
+#else
+    if (ethernet_input(&custom_p->custom_p.pbuf, netif) != ERR_OK) {
+      pbuf_free(&custom_p->custom_p.pbuf);
+    }
+#endif
+    custom_p = next;
+  }
+#if ETH_RX_GRO
+#if ETH_GRO_FLUSH_MS
+  /* Hold the coalesced segments for the next batch, at most ETH_GRO_FLUSH_MS */
+  if (!rx_gro_timer) {
+    for (i = 0; i < ETH_GRO_FLOWS; i++) {
+      if (rx_gro[i].head != NULL) {
+        rx_gro_timer = 1;
+        sys_timeout(ETH_GRO_FLUSH_MS, rx_gro_timeout, netif);
+        break;
+      }
+    }
+  }
+#else
+  rx_gro_flush_all(netif);
+#endif
+#endif
+  ethernetif_tx_more(0);
+}
+#endif /* ETH_RX_BATCH */
+
+#ifdef ETH_INPUT_USE_IT
+/**
+  * @brief Program RX interrupt moderation. Every "frames"-th RX descriptor
+  * raises the RX interrupt on completion, the others have it disabled (DIC)
+  * and rely on the receive watchdog (DMARSWTR) to raise it "usecs" later.
+  *
+  * The setting is kept, and applied to the hardware once initialized.
+  *
+  * @param usecs receive watchdog delay, 0 to disable moderation
+  * @param frames number of frames per RX interrupt
+  */
+static void rx_coalesce_apply(uint32_t usecs, uint32_t frames) {
+  uint32_t rswtc;
+  uint32_t i;
+
+  rx_coalesce.usecs_set = usecs;
+  rx_coalesce.frames_set = frames;
+  if (EthHandle.State == HAL_ETH_STATE_RESET) {
+    return;
+  }
+
+  /* Watchdog counts in unit of 256 HCLK cycles */
+  rswtc = usecs * (SystemCoreClock / 1000000U) / 256U;
+  if (rswtc > ETH_DMARSWTR_RSWTC) {
+    rswtc = ETH_DMARSWTR_RSWTC;
+  }
+  if ((rswtc == 0) || (frames == 0)) {
+    /* Without watchdog, every frame must raise interrupt */
+    frames = 1;
+  } else if (frames > ETH_RXBUFNB) {
+    frames = ETH_RXBUFNB;
+  }
+
+  for (i = 0; i < ETH_RXBUFNB; i++) {
+    if ((frames > 1) && (((i + 1) % frames) != 0)) {
+      DMARxDscrTab[i].ControlBufferSize |= ETH_DMARXDESC_DIC;
+    } else {
+      DMARxDscrTab[i].ControlBufferSize &= ~ETH_DMARXDESC_DIC;
+    }
+  }
+  EthHandle.Instance->DMARSWTR = (frames > 1) ? rswtc : 0;
+
+  stats.rx_coalesce_usecs = (frames > 1) ? (rswtc * 256U / (SystemCoreClock / 1000000U)) : 0;
+  stats.rx_coalesce_frames = frames;
+}
+
+/**
+  * @brief Track the RX packet rate and scale RX interrupt moderation with it.
+  * Called by the RX path, and by ethernet thread (with "n" 0) so moderation
+  * decays when frames stop arriving.
+  * @param n number of RX descriptors just processed
+  */
+static void rx_coalesce_update(uint32_t n) {
+  uint32_t elapsed;
+  uint32_t pps;
+  uint32_t usecs;
+  uint32_t frames;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (!rx_coalesce.adaptive) {
+    return;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  rx_coalesce.frames += n;
+  elapsed = HAL_GetTick() - rx_coalesce.tick;
+  if (elapsed < ETH_RX_COALESCE_PERIOD) {
+    SYS_ARCH_UNPROTECT(lev);
+    return;
+  }
+  pps = (uint32_t)((uint64_t)rx_coalesce.frames * 1000U / elapsed);
+  rx_coalesce.frames = 0;
+  rx_coalesce.tick = HAL_GetTick();
+
+  if (pps <= rx_coalesce.low_pps) {
+    /* Light traffic: lowest latency */
+    usecs = 0;
+    frames = 1;
+  } else if (pps >= rx_coalesce.high_pps) {
+    usecs = rx_coalesce.max_usecs;
+    frames = ETH_RX_COALESCE_FRAMES_MAX;
+  } else {
+    usecs = (uint32_t)((uint64_t)rx_coalesce.max_usecs * (pps - rx_coalesce.low_pps) /
+                       (rx_coalesce.high_pps - rx_coalesce.low_pps));
+    frames = 1 + (ETH_RX_COALESCE_FRAMES_MAX - 1) * (pps - rx_coalesce.low_pps) /
+             (rx_coalesce.high_pps - rx_coalesce.low_pps);
+  }
+  if ((usecs != rx_coalesce.usecs_set) || (frames != rx_coalesce.frames_set)) {
+    rx_coalesce_apply(usecs, frames);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+#endif /* ETH_INPUT_USE_IT */
+
+/**
+  * @brief Check if the next RX descriptor is still owned by DMA
+  * @retval 1 if no frame is ready, else 0
+  */
+static inline uint8_t rx_ring_empty(void) {
+  return ((EthHandle.RxDesc->Status & ETH_DMARXDESC_OWN) != (uint32_t)RESET);
+}
+
+/**
+  * @brief Read the ready frames from the interface and pass them to LwIP
+  * stack, up to "budget" RX descriptors.
+  *
+  * With ETH_RX_BATCH, all the read frames are linked into one batch and
+  * handed to tcpip_thread with a single message. While the message is
+  * pending, new frames are appended to the same batch.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  * @param budget maximum number of RX descriptors to process
+  * @return number of RX descriptors processed
+  */
+static uint32_t ethernetif_poll(struct netif *netif, uint32_t budget) {
+  struct pbuf *p;
+  uint32_t n = 0;
+#if ETH_RX_BATCH
+  lwip_custom_pbuf_t *custom_p;
+  lwip_custom_pbuf_t *next;
+  uint32_t count = 0;
+  uint8_t post = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+#else
+  err_t err;
+#endif
+
+  while ((n < budget) && !rx_ring_empty()) {
+    n++;
+    /* move received packet into a new pbuf */
+    p = low_level_input(netif);
+    if (p == NULL) {
+      /* no packet could be read, silently ignore this */
+      continue;
+    }
+
+#if ETH_RX_BATCH
+    custom_p = (lwip_custom_pbuf_t *)p;
+    SYS_ARCH_PROTECT(lev);
+    if (rx_batch.tail == NULL) {
+      rx_batch.head = custom_p;
+    } else {
+      rx_batch.tail->next = custom_p;
+    }
+    rx_batch.tail = custom_p;
+    rx_batch.count++;
+    SYS_ARCH_UNPROTECT(lev);
+    count++;
+#else
+    /* pass Ethernet package to LwIP stack */
+    err = netif->input(p, netif);
+    if (err != ERR_OK) {
+      // LOG_E("netif->input err: %d", err);
+      stats.rx_mbox_drop++;
+      pbuf_free(p);
+    }
+#endif
+  }
+
+#ifdef ETH_INPUT_USE_IT
+  rx_coalesce_update(n);
+#endif
+
+#if ETH_RX_BATCH
+  if (count == 0) {
+    return n;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (!rx_batch.pending) {
+    rx_batch.pending = 1;
+    post = 1;
+    count = rx_batch.count;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  if (!post) {
+    /* Picked up by the pending message */
+    return n;
+  }
+
+  if (tcpip_callbackmsg_trycallback(rx_batch.msg) == ERR_OK) {
+    stats.rx_batch++;
+    if (count > stats.rx_batch_max) {
+      stats.rx_batch_max = count;
+    }
+    return n;
+  }
+
+  /* Mailbox full: drop the batch */
+  SYS_ARCH_PROTECT(lev);
+  custom_p = rx_batch.head;
+  rx_batch.head = rx_batch.tail = NULL;
+  rx_batch.count = 0;
+  rx_batch.pending = 0;
+  SYS_ARCH_UNPROTECT(lev);
+  while (custom_p != NULL) {
+    next = custom_p->next;
+    custom_p->next = NULL;
+    pbuf_free(&custom_p->custom_p.pbuf);
+    stats.rx_mbox_drop++;
+    custom_p = next;
+  }
+#endif /* ETH_RX_BATCH */
+
+  return n;
+}
+
+#if ETH_RX_DEFERRED
+/**
+  * @brief RX thread. Woken up with RX interrupt masked, it polls the RX ring
+  * up to ETH_RX_BUDGET descriptors per pass and unmasks the interrupt once
+  * the ring is empty. After a full pass it sleeps one tick, so a flood of
+  * frames can't starve tcpip_thread and application threads.
+  *
+  * @param arg the lwip network interface structure for this ethernetif
+  */
+static void ethernetif_rx_thread(void *arg) {
+  struct netif *netif = (struct netif *)arg;
+
+  while (1) {
+    (void)sys_arch_sem_wait(&rx_sem, 0);
+
+    while (1) {
+      stats.rx_poll++;
+      if (ethernetif_poll(netif, ETH_RX_BUDGET) >= ETH_RX_BUDGET) {
+        /* More frames may be waiting */
+        stats.rx_budget_out++;
+        (void)rt_thread_delay(1);
+        continue;
+      }
+
+      /* Ring empty: unmask RX interrupt */
+      __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_R);
+      /* Catch the frame received before unmasking */
+      if (rx_ring_empty()) {
+        break;
+      }
+      __HAL_ETH_DMA_DISABLE_IT(&EthHandle, ETH_DMA_IT_R);
+    }
+  }
+}
+#endif /* ETH_RX_DEFERRED */
+
+/**
+  * @brief This function should be called when a packet is ready to be read
+  * from the interface. It uses the function low_level_input() that
+  * should handle the actual reception of bytes from the network
+  * interface. Then the type of the received packet is determined and
+  * the appropriate input function is called.
+  *
+  * With ETH_RX_DEFERRED, it only masks RX interrupt and wakes up RX thread.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  */
+void ethernetif_input(struct netif *netif) {
+#if ETH_RX_DEFERRED
+  UNUSED(netif);
+  __HAL_ETH_DMA_DISABLE_IT(&EthHandle, ETH_DMA_IT_R);
+  sys_sem_signal(&rx_sem);
+#else
+  (void)ethernetif_poll(netif, ETH_RXBUFNB);
+#endif
+}
+
+err_t ethernetif_output(struct netif *netif, struct pbuf *p) {
+  return low_level_output(netif, p);
+}
+
+/**
+  * @brief Tell if more frames are coming, to resume TX DMA once after the
+  * last of them instead of after each frame. Called with TCPIP core locked.
+  *
+  * @param more 1 before sending a batch of frames, 0 after it
+  * @return None
+  */
+void ethernetif_tx_more(uint8_t more) {
+  tx_more = more;
+  if (!more) {
+    tx_doorbell();
+  }
+}
+
+/**
+  * @brief Initialize the events of ethernet thread. Called once before
+  * ethernetif_init().
+  *
+  * @param None
+  * @return None
+  */
+void ethernetif_event_init(void) {
+  if ((rt_event_init(&eth_event, "eth", RT_IPC_FLAG_FIFO) != RT_EOK) ||
+      (rt_event_init(&ready_event, "eth_rdy", RT_IPC_FLAG_FIFO) != RT_EOK)) {
+    LOG_E("Event err");
+  }
+}
+
+/**
+  * @brief Wake up ethernet thread. May be called from interrupt.
+  *
+  * @param events combination of ETH_EVENT_xxx
+  * @return None
+  */
+void ethernetif_notify(uint32_t events) {
+  (void)rt_event_send(&eth_event, events);
+}
+
+/**
+  * @brief Wait for the events of ethernet thread. Without ETH interrupt, DMA
+  * status is checked instead at least every ETH_DMA_POLL_MS. With adaptive
+  * RX interrupt moderation, the packet rate is checked at least every
+  * ETH_RX_COALESCE_PERIOD while moderation is on.
+  *
+  * @param timeout in ms, 0 not to wait or ETH_WAIT_FOREVER
+  * @return combination of ETH_EVENT_xxx, 0 on timeout
+  */
+uint32_t ethernetif_wait_event(uint32_t timeout) {
+  rt_uint32_t events = 0;
+  rt_int32_t ticks;
+
+#ifndef ETH_INPUT_USE_IT
+  if (timeout > ETH_DMA_POLL_MS) {
+    timeout = ETH_DMA_POLL_MS;
+  }
+#else
+  /* While RX interrupts are moderated, check the packet rate even if no
+     frame arrives, so the next frame doesn't wait for the watchdog */
+  if (rx_coalesce.adaptive && (rx_coalesce.frames_set > 1) && (timeout > ETH_RX_COALESCE_PERIOD)) {
+    timeout = ETH_RX_COALESCE_PERIOD;
+  }
+#endif
+  if (timeout == ETH_WAIT_FOREVER) {
+    ticks = RT_WAITING_FOREVER;
+  } else {
+    ticks = rt_tick_from_millisecond((rt_int32_t)timeout);
+  }
+  if (rt_event_recv(&eth_event, ETH_EVENT_ALL, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, ticks, &events) != RT_EOK) {
+    events = 0;
+  }
+#ifdef ETH_INPUT_USE_IT
+  rx_coalesce_update(0);
+#endif
+#ifndef ETH_INPUT_USE_IT
+  if ((EthHandle.Instance->DMASR & ETH_DMASR_RBUS) != (uint32_t)RESET) {
+    events |= ETH_EVENT_RX_RESUME;
+  }
+  if ((EthHandle.Instance->DMASR & ETH_DMASR_TUS) != (uint32_t)RESET) {
+    events |= ETH_EVENT_TX_RESUME;
+  }
+  /* No TX complete interrupt: reclaim here too, so queued frames are sent
+     even if no other frame is */
+  if (tx_busy && ((DMATxDscrTab[tx_reclaim_idx].Status & ETH_DMATXDESC_OWN) == (uint32_t)RESET)) {
+    events |= ETH_EVENT_TX_RECLAIM;
+  }
+#endif
+  return events;
+}
+
+/**
+  * @brief Update network ready state: link up, interface up and IP address
+  * set. Called on link or interface status change.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  * @return None
+  */
+static void ethernetif_update_ready(struct netif *netif) {
+  rt_uint32_t events;
+#if LWIP_DNS
+  const ip4_addr_t *dns;
+#endif
+
+  if (!netif_is_up(netif) || !netif_is_link_up(netif) || ip4_addr_isany(netif_ip4_addr(netif))) {
+    net_ready = 0;
+    (void)rt_event_recv(&ready_event, ETH_READY_FLAG, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, RT_WAITING_NO, &events);
+    return;
+  }
+  if (net_ready) {
+    return;
+  }
+  net_ready = 1;
+
+  if (fast_boot) {
+    /* Resolve gateway and (on-link) DNS server ahead of the first packet */
+    if (!ip4_addr_isany(netif_ip4_gw(netif))) {
+      (void)etharp_request(netif, netif_ip4_gw(netif));
+    }
+#if LWIP_DNS
+    dns = ip_2_ip4(dns_getserver(0));
+    if (!ip4_addr_isany(dns) && ip4_addr_netcmp(dns, netif_ip4_addr(netif), netif_ip4_netmask(netif))) {
+      (void)etharp_request(netif, dns);
+    }
+#endif
+  }
+  (void)rt_event_send(&ready_event, ETH_READY_FLAG);
+}
+
+/**
+  * @brief Save the speed and duplex mode of MAC as the last negotiated ones.
+  *
+  * @param None
+  * @return None
+  */
+static void link_config_save(void) {
+  link_config = ETH_LINK_CONFIG_VALID;
+  if (EthHandle.Init.Speed == ETH_SPEED_100M) {
+    link_config |= ETH_LINK_CONFIG_100M;
+  }
+  if (EthHandle.Init.DuplexMode == ETH_MODE_FULLDUPLEX) {
+    link_config |= ETH_LINK_CONFIG_FULL;
+  }
+}
+
+/**
+  * @brief Enable fast boot. Must be called before ethernetif_init().
+  *  - With a valid link config, MAC starts with it at once, without resetting
+  *    PHY nor waiting for auto-negotiation; the link is up at once if PHY
+  *    still has it (e.g. after MCU reset)
+  *  - Gateway and DNS server MAC addresses are resolved once network is ready
+  *
+  * @param config the last negotiated speed and duplex mode, kept by
+  *   application from ethernetif_get_link_config(), 0 if unknown
+  * @return None
+  */
+void ethernetif_set_fast_boot(uint8_t config) {
+  fast_boot = 1;
+  link_config = config;
+}
+
+/**
+  * @brief Get the last negotiated speed and duplex mode.
+  *
+  * @param None
+  * @return combination of ETH_LINK_CONFIG_xxx, 0 if unknown
+  */
+uint8_t ethernetif_get_link_config(void) {
+  return link_config;
+}
+
+/**
+  * @brief Wait for the network to be ready: link up, interface up and IP
+  * address set.
+  *
+  * @param timeout in ms, 0 not to wait (poll) or ETH_WAIT_FOREVER
+  * @return 1 if ready, else 0
+  */
+uint8_t ethernetif_wait_ready(uint32_t timeout) {
+  rt_uint32_t events;
+  rt_int32_t ticks;
+
+  if (timeout == ETH_WAIT_FOREVER) {
+    ticks = RT_WAITING_FOREVER;
+  } else {
+    ticks = rt_tick_from_millisecond((rt_int32_t)timeout);
+  }
+  return (rt_event_recv(&ready_event, ETH_READY_FLAG, RT_EVENT_FLAG_OR, ticks, &events) == RT_EOK);
+}
+
+/**
+  * @brief Resume DMA suspended as RX buffer unavailable (RBUS) or TX
+  * underflow (TUS), then unmask the interrupt masked by
+  * HAL_ETH_ErrorCallback(). Called by ethernet thread.
+  *
+  * With ETH_INPUT_USE_IT, RX ring is only read by ETH interrupt (or RX
+  * thread), which also resumes DMA after releasing a frame. So RX DMA is
+  * only resumed here when no frame is left in the ring.
+  *
+  * Transmitted frames are reclaimed, and queued ones sent, on TX resume and
+  * on ETH_EVENT_TX_RECLAIM: TX complete not handed to tcpip_thread (mailbox
+  * full), or without ETH interrupt.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  * @param events ETH_EVENT_RX_RESUME, ETH_EVENT_TX_RESUME and/or
+  *   ETH_EVENT_TX_RECLAIM
+  * @return None
+  */
+void ethernetif_resume(struct netif *netif, uint32_t events) {
+  if (events & ETH_EVENT_RX_RESUME) {
+    LOG_D("Re-enable RX");
+#ifdef ETH_INPUT_USE_IT
+    if ((EthHandle.RxDesc->Status & ETH_DMARXDESC_OWN) != (uint32_t)RESET) {
+      /* No frame to read but suspended: resume DMA reception */
+      EthHandle.Instance->DMASR = ETH_DMASR_RBUS;
+      EthHandle.Instance->DMARPDR = 0;
+      __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_RBU);
+    } else if ((EthHandle.Instance->DMASR & ETH_DMASR_RBUS) == (uint32_t)RESET) {
+      /* Already resumed by the reader */
+      __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_RBU);
+    }
+    /* Otherwise left masked until the reader releases a frame */
+#else
+    /* RBUS is cleared after reading a frame */
+    ethernetif_input(netif);
+    if (((EthHandle.Instance->DMASR & ETH_DMASR_RBUS) != (uint32_t)RESET) &&
+        ((EthHandle.RxDesc->Status & ETH_DMARXDESC_OWN) != (uint32_t)RESET)) {
+      /* No frame to read but suspended: resume DMA reception */
+      EthHandle.Instance->DMASR = ETH_DMASR_RBUS;
+      EthHandle.Instance->DMARPDR = 0;
+    }
+#endif
+  }
+
+  if (events & (ETH_EVENT_TX_RESUME | ETH_EVENT_TX_RECLAIM)) {
+    LOG_D("Re-enable TX");
+    LOCK_TCPIP_CORE();
+#ifdef ETH_INPUT_USE_IT
+    if (events & ETH_EVENT_TX_RECLAIM) {
+      /* Let TX complete interrupt post the message again */
+      tx_reclaim_pending = 0;
+    }
+#endif
+    (void)low_level_output(netif, NULL);
+    UNLOCK_TCPIP_CORE();
+#ifdef ETH_INPUT_USE_IT
+    if (events & ETH_EVENT_TX_RESUME) {
+      __HAL_ETH_DMA_ENABLE_IT(&EthHandle, ETH_DMA_IT_TU);
+    }
+#endif
+  }
 }
 
 
@@ -641,25 +2507,50 @@ u32_t sys_now(void)
 }
 
 /**
-  * @brief  This function sets the netif link status.
-  * @param  netif: the network interface
-  * @retval None
+  * @brief Start an MDIO operation on a PHY register, without waiting for it.
+  * The clock range of MACMIIAR is kept.
+  *
+  * @param reg PHY register
+  * @param write 1 to write "value", 0 to read
+  * @param value value to write
+  * @return None
   */
-void ethernetif_set_link(struct netif *netif)
-{
-  uint32_t regvalue = 0;
-
-  /* Read PHY_MISR*/
-  HAL_ETH_ReadPHYRegister(&EthHandle, PHY_ISFR, &regvalue);
-
-  /* Check whether the link interrupt has occurred or not */
-  if ((regvalue & PHY_ISFR_INT4) != (uint16_t)RESET) {
-    netif_set_link_down(netif);
+static void mdio_start(uint16_t reg, uint8_t write, uint16_t value) {
+  uint32_t tmpreg = EthHandle.Instance->MACMIIAR & ~ETH_MACMIIAR_CR_MASK;
+
+  tmpreg |= ((uint32_t)EthHandle.Init.PhyAddress << 11U) & ETH_MACMIIAR_PA;
+  tmpreg |= ((uint32_t)reg << 6U) & ETH_MACMIIAR_MR;
+  if (write) {
+    EthHandle.Instance->MACMIIDR = value;
+    tmpreg |= ETH_MACMIIAR_MW;
   }
+  EthHandle.Instance->MACMIIAR = tmpreg | ETH_MACMIIAR_MB;
+}
 
-  HAL_ETH_ReadPHYRegister(&EthHandle, PHY_BSR, &regvalue);
+/**
+  * @brief Check if the MDIO operation started by mdio_start() is complete.
+  *
+  * @param value the register value read
+  * @return 1 if complete, else 0
+  */
+static uint8_t mdio_done(uint16_t *value) {
+  if ((EthHandle.Instance->MACMIIAR & ETH_MACMIIAR_MB) != (uint32_t)RESET) {
+    return 0;
+  }
+  *value = (uint16_t)EthHandle.Instance->MACMIIDR;
+  return 1;
+}
 
-  if ((regvalue & PHY_LINKED_STATUS) != (uint16_t)RESET) {
+/**
+  * @brief Set the netif link status, with TCPIP core locked only for it.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  * @param up 1 for link up, 0 for link down
+  * @return None
+  */
+static void phy_set_link(struct netif *netif, uint8_t up) {
+  LOCK_TCPIP_CORE();
+  if (up) {
 #if LWIP_IGMP
     if (!(netif->flags & NETIF_FLAG_IGMP)) {
       netif->flags |= NETIF_FLAG_IGMP;
@@ -667,12 +2558,170 @@ void ethernetif_set_link(struct netif *netif)
       igmp_start(netif);
     }
 #endif
-    LOCK_TCPIP_CORE();
     netif_set_link_up(netif);
-    UNLOCK_TCPIP_CORE();
+  } else {
+    netif_set_link_down(netif);
+  }
+  UNLOCK_TCPIP_CORE();
+}
+
+/**
+  * @brief  This function starts checking the netif link status. The check
+  *         is done by ethernetif_phy_step(), without TCPIP core locked.
+  * @param  netif: the network interface
+  * @retval None
+  */
+void ethernetif_set_link(struct netif *netif)
+{
+  UNUSED(netif);
+
+  if (!phy.ready) {
+    return;
+  }
+  if (phy.state == PHY_STATE_IDLE) {
+    phy.state = PHY_STATE_READ_IRQ;
+  } else {
+    /* A change during the check may not be seen by it, and PHY interrupt
+       output stays asserted until the interrupt sources are read again */
+    phy.pending = 1;
+  }
+}
+
+/**
+  * @brief Run PHY state machine: complete the MDIO operation of the current
+  * state, then start the one of the next state. It never waits for MDIO and
+  * takes TCPIP core lock only to set the netif link status. Called by
+  * ethernet thread.
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  * @return time (ms) to call it again, ETH_WAIT_FOREVER when idle
+  */
+uint32_t ethernetif_phy_step(struct netif *netif) {
+  uint16_t regvalue;
+  uint32_t speed;
+  uint32_t duplex;
+
+  if (phy.state == PHY_STATE_IDLE) {
+    return ETH_WAIT_FOREVER;
+  }
+  if (phy.busy) {
+    if (!mdio_done(&regvalue)) {
+      return ETH_PHY_STEP_MS;
+    }
+    phy.busy = 0;
+
+    switch (phy.state) {
+      case PHY_STATE_READ_IRQ:
+        /* Check whether the link interrupt has occurred or not */
+        phy.link_down = ((regvalue & phy.ops->irq_link_down) != (uint16_t)RESET);
+        phy.state = PHY_STATE_READ_BSR;
+        break;
+
+      case PHY_STATE_READ_BSR:
+        if ((phy.link_down || ((regvalue & PHY_LINKED_STATUS) == (uint16_t)RESET)) &&
+            netif_is_link_up(netif)) {
+          phy_set_link(netif, 0);
+        }
+        if (((regvalue & PHY_LINKED_STATUS) == (uint16_t)RESET) ||
+            (netif_is_link_up(netif) && !phy.confirm)) {
+          phy.state = PHY_STATE_IDLE;
+        } else if (EthHandle.Init.AutoNegotiation != ETH_AUTONEGOTIATION_DISABLE) {
+          phy.state = PHY_STATE_READ_STATUS;
+        } else {
+          phy.state = PHY_STATE_WRITE_BCR;
+        }
+        break;
+
+      case PHY_STATE_READ_STATUS:
+        /* Configure the MAC with the Speed and Duplex Mode fixed by the
+           auto-negotiation process, or check again later if not done */
+        if (!phy.ops->status(regvalue, &speed, &duplex)) {
+          phy.state = PHY_STATE_IDLE;
+          break;
+        }
+        phy.confirm = 0;
+        phy.state = PHY_STATE_IDLE;
+        if (netif_is_link_up(netif)) {
+          /* Link up with the last negotiated config (fast boot) */
+          if ((speed != EthHandle.Init.Speed) || (duplex != EthHandle.Init.DuplexMode)) {
+            EthHandle.Init.Speed = speed;
+            EthHandle.Init.DuplexMode = duplex;
+            link_config_save();
+            LOCK_TCPIP_CORE();
+            HAL_ETH_ConfigMAC(&EthHandle, (ETH_MACInitTypeDef *) NULL);
+            UNLOCK_TCPIP_CORE();
+          }
+          break;
+        }
+        EthHandle.Init.Speed = speed;
+        EthHandle.Init.DuplexMode = duplex;
+        link_config_save();
+        phy_set_link(netif, 1);
+        break;
+
+      case PHY_STATE_WRITE_BCR:
+        phy_set_link(netif, 1);
+        phy.state = PHY_STATE_IDLE;
+        break;
+
+      default:
+        phy.state = PHY_STATE_IDLE;
+        break;
+    }
+  }
+
+  if ((phy.state == PHY_STATE_IDLE) && phy.pending) {
+    /* Check again for the link change requested during this check */
+    phy.pending = 0;
+    phy.state = PHY_STATE_READ_IRQ;
+  }
+
+  switch (phy.state) {
+    case PHY_STATE_READ_IRQ:
+      mdio_start(phy.ops->irq_reg, 0, 0);
+      break;
+    case PHY_STATE_READ_BSR:
+      mdio_start(PHY_BSR, 0, 0);
+      break;
+    case PHY_STATE_READ_STATUS:
+      mdio_start(phy.ops->status_reg, 0, 0);
+      break;
+    case PHY_STATE_WRITE_BCR:
+      /* Set MAC Speed and Duplex Mode to PHY */
+      assert_param(IS_ETH_SPEED(EthHandle.Init.Speed));
+      assert_param(IS_ETH_DUPLEX_MODE(EthHandle.Init.DuplexMode));
+      mdio_start(PHY_BCR, 1, (uint16_t)(EthHandle.Init.DuplexMode >> 3) | (uint16_t)(EthHandle.Init.Speed >> 1));
+      break;
+    default:
+      return ETH_WAIT_FOREVER;
   }
+  phy.busy = 1;
+  return ETH_PHY_STEP_MS;
 }
 
+#if ETH_INIT_ASYNC
+/**
+  * @brief Initialize MAC, DMA and PHY, deferred from ethernetif_init() by
+  * ETH_INIT_ASYNC. Called by ethernet thread on ETH_EVENT_INIT. MAC and DMA
+  * are started at once by low_level_fast_init() where available, and the
+  * link is set up by ethernetif_phy_step() with the speed and duplex mode
+  * negotiated by PHY. Otherwise only this thread waits for HAL_ETH_Init().
+  *
+  * @param netif the lwip network interface structure for this ethernetif
+  * @return None
+  */
+void ethernetif_start(struct netif *netif) {
+  if (phy.ready) {
+    return;
+  }
+  if (low_level_start() == HAL_OK) {
+    phy_set_link(netif, 1);
+  }
+  /* Check the link now, not at the next poll or PHY interrupt */
+  ethernetif_set_link(netif);
+}
+#endif /* ETH_INIT_ASYNC */
+
 /**
   * @brief  Link callback function, this function is called on change of link status
   *         to update low level driver configuration.
@@ -681,44 +2730,9 @@ void ethernetif_set_link(struct netif *netif)
   */
 void ethernetif_update_config(struct netif *netif)
 {
-  uint32_t regvalue = 0;
-
   if (netif_is_link_up(netif)) {
-    /* Restart the auto-negotiation */
-    if (EthHandle.Init.AutoNegotiation != ETH_AUTONEGOTIATION_DISABLE) {
-
-      /* Check Auto negotiation */
-      HAL_ETH_ReadPHYRegister(&EthHandle, PHY_SR, &regvalue);
-      if ((regvalue & PHY_SR_AUTODONE) != PHY_SR_AUTODONE) {
-        goto error;
-      }
-
-      /* Configure the MAC with the Duplex Mode fixed by the auto-negotiation process */
-      if ((regvalue & PHY_DUPLEX_STATUS) != (uint32_t)RESET) {
-        /* Set Ethernet duplex mode to Full-duplex following the auto-negotiation */
-        EthHandle.Init.DuplexMode = ETH_MODE_FULLDUPLEX;
-      } else {
-        /* Set Ethernet duplex mode to Half-duplex following the auto-negotiation */
-        EthHandle.Init.DuplexMode = ETH_MODE_HALFDUPLEX;
-      }
-      /* Configure the MAC with the speed fixed by the auto-negotiation process */
-      if (regvalue & PHY_SPEED_STATUS) {
-        /* Set Ethernet speed to 10M following the auto-negotiation */
-        EthHandle.Init.Speed = ETH_SPEED_10M;
-      } else {
-        /* Set Ethernet speed to 100M following the auto-negotiation */
-        EthHandle.Init.Speed = ETH_SPEED_100M;
-      }
-    } else { /* AutoNegotiation Disable */
-error :
-      /* Check parameters */
-      assert_param(IS_ETH_SPEED(EthHandle.Init.Speed));
-      assert_param(IS_ETH_DUPLEX_MODE(EthHandle.Init.DuplexMode));
-
-      /* Set MAC Speed and Duplex Mode to PHY */
-      HAL_ETH_WritePHYRegister(&EthHandle, PHY_BCR, ((uint16_t)(EthHandle.Init.DuplexMode >> 3) |
-                                                     (uint16_t)(EthHandle.Init.Speed >> 1)));
-    }
+    /* Speed and Duplex Mode are already got from (or set to) PHY by
+       ethernetif_phy_step(), so no MDIO operation with TCPIP core locked */
 
     /* ETHERNET MAC Re-Configuration */
     HAL_ETH_ConfigMAC(&EthHandle, (ETH_MACInitTypeDef *) NULL);
@@ -731,6 +2745,7 @@ error :
   }
 
   ethernetif_notify_conn_changed(netif);
+  ethernetif_update_ready(netif);
 }
 
 /**
@@ -746,9 +2761,25 @@ __weak void ethernetif_notify_conn_changed(struct netif *netif)
   UNUSED(netif);
 }
 
+/**
+  * @brief  This function notify user about network interface status change:
+  *         up, down or IP address changed.
+  * @param  netif: the network interface
+  * @retval None
+  */
+__weak void ethernetif_notify_status_changed(struct netif *netif)
+{
+  /* NOTE : This is function clould be implemented in user file
+            when the callback is needed,
+  */
+  UNUSED(netif);
+}
+
 void ethernetif_status_changed(struct netif *netif) {
   uint32_t addr;
 
+  ethernetif_update_ready(netif);
+  ethernetif_notify_status_changed(netif);
   if (!netif_is_up(netif) || !netif_is_link_up(netif))
     return;
   addr = stm32_eth_get_ipaddr();
@@ -774,6 +2805,318 @@ void ethernetif_set_mac_addr(const uint8_t *mac)
   }
 }
 
+/**
+  * @brief  Take a snapshot of the driver statistics
+  * @param  snapshot: where to store the statistics
+  * @retval None
+  */
+void ethernetif_get_stats(ethernetif_stats_t *snapshot)
+{
+  memcpy(snapshot, &stats, sizeof(stats));
+  snapshot->rx_spare = rx_reservoir.count;
+}
+
+/**
+  * @brief  Write MAC frame filter register with the mode set by user and the
+  *         multicast hash filtering of joined groups. The register is read
+  *         back and written again, as successive writes may not be taken
+  *         into account (register write delay). No sleep, as it may be
+  *         called with TCPIP core locked.
+  * @param  None
+  * @retval None
+  */
+static void eth_update_macffr(void)
+{
+  uint32_t value = rx_filter_mode;
+
+#if LWIP_IGMP
+  if (ETH_HashTableHigh || ETH_HashTableLow) {
+    /* Pass multicast frames matching either hash table or perfect filter */
+    value |= ETH_MACFFR_HM | ETH_MACFFR_HPF;
+  }
+#endif
+  if (EthHandle.Instance->MACFFR == value) {
+    return;
+  }
+  EthHandle.Instance->MACFFR = value;
+  value = EthHandle.Instance->MACFFR;
+  EthHandle.Instance->MACFFR = value;
+}
+
+/**
+  * @brief  Set a MAC perfect filter address. Frames with the destination (or
+  *         source) address matching any enabled one pass the address filter.
+  * @param  index: filter index, 1 to ETH_MAC_FILTER_NUM
+  * @param  mac: MAC address, NULL to disable the filter
+  * @param  source: compare with source address instead of destination
+  * @param  mask: bit 0 to 5 set to ignore MAC address byte 0 to 5
+  * @retval 0 on success, -1 on error
+  */
+int ethernetif_set_mac_filter(uint8_t index, const uint8_t *mac, uint8_t source, uint8_t mask)
+{
+  __IO uint32_t *reg;
+  uint32_t high;
+
+  if (!ethernetif_is_init() || (index < 1) || (index > ETH_MAC_FILTER_NUM)) {
+    return -1;
+  }
+
+  /* MACA1HR, MACA1LR, MACA2HR ... */
+  reg = &EthHandle.Instance->MACA1HR + (index - 1) * 2;
+  if (mac == NULL) {
+    *reg = 0;
+    return 0;
+  }
+
+  high = ((uint32_t)mac[5] << 8) | mac[4];
+  high |= ((uint32_t)(mask & 0x3F) << 24) & ETH_MACA1HR_MBC;
+  if (source) {
+    high |= ETH_MACA1HR_SA;
+  }
+  /* Low register first, the address is taken when high register written */
+  *(reg + 1) = ((uint32_t)mac[3] << 24) | ((uint32_t)mac[2] << 16) | ((uint32_t)mac[1] << 8) | mac[0];
+  *reg = high | ETH_MACA1HR_AE;
+  return 0;
+}
+
+/**
+  * @brief  Set VLAN tag filter. VLAN frames with other VLAN ID are dropped.
+  * @param  vid: 12-bit VLAN ID, 0 to disable the filter
+  * @retval 0 on success, -1 on error
+  */
+int ethernetif_set_vlan_filter(uint16_t vid)
+{
+  if (!ethernetif_is_init() || (vid > 0x0FFF)) {
+    return -1;
+  }
+
+  rx_vlan_id = vid;
+  if (vid) {
+    /* Compare 12-bit VLAN ID only */
+    EthHandle.Instance->MACVLANTR = ETH_MACVLANTR_VLANTC | vid;
+  } else {
+    EthHandle.Instance->MACVLANTR = 0;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Set MAC frame filter mode. Multicast hash filtering stays enabled
+  *         while any multicast group is joined.
+  * @param  mode: ETH_RX_FILTER_xxx combination
+  * @retval 0 on success, -1 on error
+  */
+int ethernetif_set_rx_filter(uint32_t mode)
+{
+  if (!ethernetif_is_init()) {
+    return -1;
+  }
+
+  rx_filter_mode = mode & (ETH_MACFFR_RA | ETH_MACFFR_HPF | ETH_MACFFR_SAF | ETH_MACFFR_SAIF |
+                           ETH_MACFFR_PCF | ETH_MACFFR_BFD | ETH_MACFFR_PAM | ETH_MACFFR_DAIF |
+                           ETH_MACFFR_HM | ETH_MACFFR_HU | ETH_MACFFR_PM);
+  eth_update_macffr();
+  return 0;
+}
+
+/**
+  * @brief  Get MAC frame filter mode
+  * @param  None
+  * @retval ETH_RX_FILTER_xxx combination
+  */
+uint32_t ethernetif_get_rx_filter(void)
+{
+  if (!ethernetif_is_init()) {
+    return 0;
+  }
+  return EthHandle.Instance->MACFFR;
+}
+
+#if ETH_PTP
+/**
+  * @brief  Get RX time stamp of a received frame
+  * @param  p: pbuf of the frame, as passed by LwIP
+  * @param  ts: time stamp
+  * @retval 0 on success, -1 if not received by this driver
+  */
+int ethernetif_get_rx_timestamp(const struct pbuf *p, ethernetif_timestamp_t *ts)
+{
+  const lwip_custom_pbuf_t *custom_p = (const lwip_custom_pbuf_t *)p;
+
+  if ((p == NULL) || !(p->flags & PBUF_FLAG_IS_CUSTOM) ||
+      (custom_p->custom_p.custom_free_function != lwip_custom_pbuf_free)) {
+    return -1;
+  }
+  *ts = custom_p->ts;
+  return 0;
+}
+
+/**
+  * @brief  Get the mark of the last transmitted frame, to be called with
+  *         TCPIP core locked right after the frame is sent
+  * @param  None
+  * @retval TX mark, 0 if no frame transmitted
+  */
+uint32_t ethernetif_get_tx_mark(void)
+{
+  uint32_t i;
+
+  if (tx_ts_seq == 0) {
+    return 0;
+  }
+  for (i = 0; i < ETH_TXBUFNB; i++) {
+    if (tx_ts_desc_seq[i] == tx_ts_seq) {
+      break;
+    }
+  }
+  /* Descriptor index in low byte */
+  return (tx_ts_seq << 8) | i;
+}
+
+/**
+  * @brief  Get TX time stamp of a transmitted frame
+  * @param  mark: TX mark of the frame
+  * @param  ts: time stamp
+  * @retval 0 on success, -1 if not yet transmitted or descriptor reused
+  */
+int ethernetif_get_tx_timestamp(uint32_t mark, ethernetif_timestamp_t *ts)
+{
+  __IO ETH_DMADescTypeDef *desc;
+  uint32_t i = mark & 0xFF;
+
+  if ((mark == 0) || (i >= ETH_TXBUFNB) || (tx_ts_desc_seq[i] != (mark >> 8))) {
+    return -1;
+  }
+
+  desc = &DMATxDscrTab[i];
+  if ((desc->Status & ETH_DMATXDESC_OWN) || !(desc->Status & ETH_DMATXDESC_TTSS)) {
+    return -1;
+  }
+  ts->sec = desc->TimeStampHigh;
+  ts->nsec = desc->TimeStampLow;
+
+  /* Check descriptor not reused meanwhile */
+  return (tx_ts_desc_seq[i] == (mark >> 8)) ? 0 : -1;
+}
+
+/**
+  * @brief  Get PTP time
+  * @param  ts: current time
+  * @retval None
+  */
+void ethernetif_ptp_get_time(ethernetif_timestamp_t *ts)
+{
+  uint32_t sec;
+
+  do {
+    sec = EthHandle.Instance->PTPTSHR;
+    ts->nsec = EthHandle.Instance->PTPTSLR;
+    ts->sec = EthHandle.Instance->PTPTSHR;
+  } while (sec != ts->sec);
+}
+
+/**
+  * @brief  Set PTP time
+  * @param  ts: new time
+  * @retval 0 on success, -1 if the previous update is not done
+  */
+int ethernetif_ptp_set_time(const ethernetif_timestamp_t *ts)
+{
+  if (ptp_wait(ETH_PTPTSCR_TSSTI | ETH_PTPTSCR_TSSTU) != 0) {
+    return -1;
+  }
+  EthHandle.Instance->PTPTSHUR = ts->sec;
+  EthHandle.Instance->PTPTSLUR = ts->nsec;
+  EthHandle.Instance->PTPTSCR |= ETH_PTPTSCR_TSSTI;
+  return 0;
+}
+
+/**
+  * @brief  Step PTP time
+  * @param  nsec: offset to add, negative to subtract
+  * @retval 0 on success, -1 if the previous update is not done
+  */
+int ethernetif_ptp_adjust_time(int64_t nsec)
+{
+  uint64_t abs_ns = (nsec < 0) ? -nsec : nsec;
+  uint32_t sec = (uint32_t)(abs_ns / PTP_NSEC_PER_SEC);
+  uint32_t ns = (uint32_t)(abs_ns % PTP_NSEC_PER_SEC);
+
+  if (ptp_wait(ETH_PTPTSCR_TSSTI | ETH_PTPTSCR_TSSTU) != 0) {
+    return -1;
+  }
+  EthHandle.Instance->PTPTSHUR = sec;
+  if (nsec < 0) {
+    /* Subtraction with digital rollover takes (10^9 - ns) */
+    EthHandle.Instance->PTPTSLUR = ETH_PTPTSLUR_TSUPNS | (ns ? (PTP_NSEC_PER_SEC - ns) : 0);
+  } else {
+    EthHandle.Instance->PTPTSLUR = ns;
+  }
+  EthHandle.Instance->PTPTSCR |= ETH_PTPTSCR_TSSTU;
+  return 0;
+}
+
+/**
+  * @brief  Adjust PTP clock frequency
+  * @param  ppb: frequency offset from nominal in parts per billion, positive
+  *         to speed up
+  * @retval 0 on success, -1 if the previous update is not done
+  */
+int ethernetif_ptp_adjust_freq(int32_t ppb)
+{
+  int64_t addend = ptp_addend + ((int64_t)ptp_addend * ppb) / (int64_t)PTP_NSEC_PER_SEC;
+
+  if (addend > 0xFFFFFFFF) {
+    addend = 0xFFFFFFFF;
+  }
+  if (ptp_wait(ETH_PTPTSCR_TSARU) != 0) {
+    return -1;
+  }
+  EthHandle.Instance->PTPTSAR = (uint32_t)addend;
+  EthHandle.Instance->PTPTSCR |= ETH_PTPTSCR_TSARU;
+  return 0;
+}
+#endif /* ETH_PTP */
+
+#if ETH_FLOW_FILTER
+/**
+  * @brief  Take a snapshot of the flow filter counters
+  * @param  snapshot: where to store the counters, one entry per rule
+  * @param  num: number of entries in "snapshot"
+  * @retval number of flow filter rules
+  */
+uint32_t ethernetif_get_filter_stats(ethernetif_filter_stats_t *snapshot, uint32_t num)
+{
+  if (num > RX_FILTER_NUM) {
+    num = RX_FILTER_NUM;
+  }
+  memcpy(snapshot, rx_filter_stats, num * sizeof(ethernetif_filter_stats_t));
+  return RX_FILTER_NUM;
+}
+#endif /* ETH_FLOW_FILTER */
+
+/**
+  * @brief  Clear the driver statistics and restart the watermarks
+  * @param  None
+  * @retval None
+  */
+void ethernetif_clear_stats(void)
+{
+  uint32_t usecs = stats.rx_coalesce_usecs;
+  uint32_t frames = stats.rx_coalesce_frames;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  memset(&stats, 0, sizeof(stats));
+  stats.rx_coalesce_usecs = usecs;
+  stats.rx_coalesce_frames = frames;
+  stats.rx_spare_low = stats.rx_spare_high = rx_reservoir.count;
+#if ETH_FLOW_FILTER
+  memset(rx_filter_stats, 0, sizeof(rx_filter_stats));
+#endif
+  SYS_ARCH_UNPROTECT(lev);
+}
+
 #if LWIP_IGMP
 err_t igmp_mac_filter(struct netif *netif, const ip4_addr_t *ip4_addr, netif_mac_filter_action action)
 {
@@ -787,7 +3130,12 @@ err_t igmp_mac_filter(struct netif *netif, const ip4_addr_t *ip4_addr, netif_mac
   mac[4] = *(p + 2);
   mac[5] = *(p + 3);
 
-  register_multicast_address(mac);
+  /* lwIP calls here only on first join and last leave of a group */
+  if (action == NETIF_ADD_MAC_FILTER) {
+    register_multicast_address(mac);
+  } else {
+    unregister_multicast_address(mac);
+  }
 
   return 0;
 }
@@ -796,49 +3144,123 @@ err_t igmp_mac_filter(struct netif *netif, const ip4_addr_t *ip4_addr, netif_mac
 #define HASH_BITS 6 /* #bits in hash */
 #endif
 
+/**
+  * @brief  Ethernet CRC-32 (as FCS), table driven
+  * @param  data: data to calculate
+  * @param  length: data length in bytes
+  * @retval CRC value
+  */
 uint32_t ethcrc(const uint8_t *data, size_t length)
 {
   uint32_t crc = 0xffffffff;
-  size_t i;
-  int j;
-
-  for (i = 0; i < length; i++) {
-    for (j = 0; j < 8; j++) {
-      if (((crc >> 31) ^ (data[i] >> j)) & 0x01) {
-        /* x^26+x^23+x^22+x^16+x^12+x^11+x^10+x^8+x^7+x^5+x^4+x^2+x+1 */
-        crc = (crc << 1) ^ 0x04C11DB7;
-      } else {
-        crc = crc << 1;
-      }
-    }
+
+  while (length--) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+    crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
   }
   return ~crc;
 }
 
-void register_multicast_address(const uint8_t *mac)
+/**
+  * @brief  Get MAC hash table bit of a multicast address
+  * @param  mac: multicast MAC address
+  * @retval hash table bit index
+  */
+static uint8_t eth_mcast_hash(const uint8_t *mac)
 {
-  uint32_t crc;
-  uint8_t hash;
-
-  /* Calculate crc32 value of mac address */
-  crc = ethcrc(mac, HASH_BITS);
-
   /*
-   * Only upper HASH_BITS are used
+   * Only upper HASH_BITS of the bit reversed CRC are used
    * which point to specific bit in the hash registers
    */
-  hash = (crc >> 26) & 0x3F;
+  return (uint8_t)(__RBIT(ethcrc(mac, ETH_HWADDR_LEN)) >> (32 - HASH_BITS));
+}
+
+/**
+  * @brief  Write hash table registers, and enable multicast hash filtering
+  *         only when any group joined
+  * @param  None
+  * @retval None
+  */
+static void eth_update_hash_table(void)
+{
+  EthHandle.Instance->MACHTHR = ETH_HashTableHigh;
+  EthHandle.Instance->MACHTLR = ETH_HashTableLow;
+  eth_update_macffr();
+}
+
+void register_multicast_address(const uint8_t *mac)
+{
+  uint8_t hash = eth_mcast_hash(mac);
+
+  if (mcast_hash_ref[hash]++) {
+    /* Bit already set by other address */
+    return;
+  }
 
   if (hash > 31) {
-    ETH_HashTableHigh |= 1 << (hash - 32);
-    EthHandle.Instance->MACHTHR = ETH_HashTableHigh;
+    ETH_HashTableHigh |= 1UL << (hash - 32);
   } else {
-    ETH_HashTableLow |= 1 << hash;
-    EthHandle.Instance->MACHTLR = ETH_HashTableLow;
+    ETH_HashTableLow |= 1UL << hash;
   }
+  eth_update_hash_table();
+}
+
+void unregister_multicast_address(const uint8_t *mac)
+{
+  uint8_t hash = eth_mcast_hash(mac);
+
+  if (!mcast_hash_ref[hash] || --mcast_hash_ref[hash]) {
+    /* Bit still used by other address */
+    return;
+  }
+
+  if (hash > 31) {
+    ETH_HashTableHigh &= ~(1UL << (hash - 32));
+  } else {
+    ETH_HashTableLow &= ~(1UL << hash);
+  }
+  eth_update_hash_table();
 }
 #endif /* LWIP_IGMP */
 
+#if ETH_BENCHMARK
+/**
+  * @brief  Clear the benchmark counters and start the cycle counter
+  * @param  None
+  * @retval None
+  */
+void ethernetif_bench_reset(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  memset(&bench, 0, sizeof(bench));
+  rx_recovering = 0;
+  tx_recovering = 0;
+  bench.start_tick = HAL_GetTick();
+}
+
+/**
+  * @brief  Take a snapshot of the benchmark counters
+  * @param  snapshot: where to store the counters
+  * @retval None
+  */
+void ethernetif_bench_get(ethernetif_bench_t *snapshot)
+{
+  memcpy(snapshot, &bench, sizeof(bench));
+}
+
+/**
+  * @brief  Arm a fault to measure how long the driver takes to recover from it
+  * @param  fault: ETH_FAULT_RX_EXHAUST and/or ETH_FAULT_TX_STALL
+  * @retval None
+  */
+void ethernetif_bench_inject(uint32_t fault)
+{
+  bench_fault |= fault;
+}
+#endif /* ETH_BENCHMARK */
 
 #ifdef ETH_INPUT_USE_IT
 /**
@@ -849,9 +3271,90 @@ void register_multicast_address(const uint8_t *mac)
 void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth)
 {
   (void)heth;
+  stats.rx_irq++;
   ethernetif_input(&gnetif);
 }
 
+/**
+  * @brief  Ethernet Tx Transfer completed callback
+  * @param  heth: ETH handle
+  * @retval None
+  */
+void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth)
+{
+  (void)heth;
+  stats.tx_irq++;
+  if (tx_reclaim_pending) {
+    return;
+  }
+  tx_reclaim_pending = 1;
+  if (tcpip_callbackmsg_trycallback(tx_reclaim_msg) != ERR_OK) {
+    /* Mailbox full: still pending, reclaimed by ethernet thread */
+    ethernetif_notify(ETH_EVENT_TX_RECLAIM);
+  }
+}
+
+/**
+  * @brief  Ethernet DMA error callback: RX buffer unavailable or TX underflow.
+  *         The status stays set until DMA is resumed, so its interrupt is
+  *         masked until ethernet thread resumes DMA.
+  * @param  heth: ETH handle
+  * @retval None
+  */
+void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *heth)
+{
+  uint32_t dmasr = heth->Instance->DMASR;
+  uint32_t events = 0;
+
+  if ((dmasr & ETH_DMASR_RBUS) != (uint32_t)RESET) {
+    __HAL_ETH_DMA_DISABLE_IT(heth, ETH_DMA_IT_RBU);
+    events |= ETH_EVENT_RX_RESUME;
+  }
+  if ((dmasr & ETH_DMASR_TUS) != (uint32_t)RESET) {
+    __HAL_ETH_DMA_DISABLE_IT(heth, ETH_DMA_IT_TU);
+    events |= ETH_EVENT_TX_RESUME;
+  }
+  if (events) {
+    ethernetif_notify(events);
+  }
+}
+
+/**
+  * @brief  Set fixed RX interrupt moderation
+  * @param  usecs: delay from the first not signaled frame to RX interrupt
+  *         (receive watchdog, up to 255 * 256 HCLK cycles), 0 to disable
+  * @param  frames: RX interrupt is raised at least every "frames" frames
+  * @retval None
+  */
+void ethernetif_set_rx_coalesce(uint32_t usecs, uint32_t frames)
+{
+  rx_coalesce.adaptive = 0;
+  rx_coalesce_apply(usecs, frames);
+}
+
+/**
+  * @brief  Set adaptive RX interrupt moderation, following the packet rate
+  *         measured every ETH_RX_COALESCE_PERIOD ms
+  * @param  low_pps: at or below this rate, every frame raises RX interrupt
+  * @param  high_pps: at or above this rate, moderation is at maximum
+  * @param  max_usecs: maximum delay of RX interrupt
+  * @retval None
+  */
+void ethernetif_set_rx_coalesce_adaptive(uint32_t low_pps, uint32_t high_pps, uint32_t max_usecs)
+{
+  if (high_pps <= low_pps) {
+    high_pps = low_pps + 1;
+  }
+  rx_coalesce.low_pps = low_pps;
+  rx_coalesce.high_pps = high_pps;
+  rx_coalesce.max_usecs = max_usecs;
+  rx_coalesce.frames = 0;
+  rx_coalesce.tick = HAL_GetTick();
+  rx_coalesce.adaptive = 1;
+  /* Start with lowest latency */
+  rx_coalesce_apply(0, 1);
+}
+
 /**
   * @brief  This function handles Ethernet interrupt request.
   * @param  None
@@ -52,21 +52,392 @@ extern "C" {
 #endif
 #include "lwip/errno.h"
 #include "lwip/netif.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/ip.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Set to 1 to collect driver throughput, cycle cost and recovery statistics */
+#ifndef ETH_BENCHMARK
+#define ETH_BENCHMARK 0
+#endif
+
+/* Number of spare RX buffers, to replace the ones lent to LwIP stack */
+#ifndef ETH_RX_SPARE_NB
+#define ETH_RX_SPARE_NB ETH_RXBUFNB
+#endif
+
+/* Number of frames waiting in TX queue while TX descriptors are busy, 0 to
+   drop them (ERR_USE) */
+#ifndef ETH_TX_QUEUE_LEN
+#define ETH_TX_QUEUE_LEN ETH_TXBUFNB
+#endif
+
+/* TX queue policy when full */
+#define ETH_TX_DROP_TAIL  0   /* Drop the new frame */
+#define ETH_TX_DROP_PRIO  1   /* Drop the newest frame of lower priority (data
+                                 vs ARP and TCP control), else the new one */
+#ifndef ETH_TX_QUEUE_POLICY
+#define ETH_TX_QUEUE_POLICY ETH_TX_DROP_TAIL
+#endif
+
+/* Number of TX priority classes (1 to 4), each with its own TX queue of
+   ETH_TX_QUEUE_LEN frames. Queued frames are sent in strict priority order,
+   and a frame is sent ahead of the queued ones of lower classes. */
+#ifndef ETH_TX_PRIO_NUM
+#define ETH_TX_PRIO_NUM 1
+#endif
+#if (ETH_TX_PRIO_NUM < 1) || (ETH_TX_PRIO_NUM > 4)
+#error "ETH_TX_PRIO_NUM must be 1 to 4"
+#endif
+#if (ETH_TX_PRIO_NUM > 1) && !ETH_TX_QUEUE_LEN
+#error "ETH_TX_PRIO_NUM requires ETH_TX_QUEUE_LEN"
+#endif
+/* The highest class, for ARP and TCP segments with ACK only */
+#define ETH_TX_PRIO_HIGH (ETH_TX_PRIO_NUM - 1)
+/* IP TOS of a socket to send in class "prio": IP precedence mapped to class
+   by "precedence * ETH_TX_PRIO_NUM / 8" */
+#define ETH_TX_PRIO_TOS(prio) \
+  ((uint8_t)(((((prio) * 8U) + ETH_TX_PRIO_NUM - 1) / ETH_TX_PRIO_NUM) << 5))
+
+#if (ETH_TX_PRIO_NUM > 1)
+/* TX priority rules for frames from sockets without priority (IP precedence
+   0), checked in order and the first match applies. Frames not matching any
+   rule are in class 0. Override it in "lwipopts_extra.h". */
+#ifndef ETH_TX_PRIO_RULES
+#define ETH_TX_PRIO_RULES \
+  /* DNS */ \
+  { IP_PROTO_UDP, 53, ETH_TX_PRIO_HIGH }, \
+  /* DHCP */ \
+  { IP_PROTO_UDP, 67, ETH_TX_PRIO_HIGH }, \
+  { IP_PROTO_UDP, 68, ETH_TX_PRIO_HIGH },
+#endif
+#endif /* ETH_TX_PRIO_NUM > 1 */
+
+/* Number of TX bounce buffers, 0 to disable. Frames no longer than
+   ETH_TX_COPYBREAK, and chains not fitting in free TX descriptors, are copied
+   to one of them and their "pbuf" is released at once. Each one takes
+   ETH_TX_BUF_SIZE bytes of RAM */
+#ifndef ETH_TX_BOUNCE_NB
+#define ETH_TX_BOUNCE_NB 0
+#endif
+#ifndef ETH_TX_COPYBREAK
+#define ETH_TX_COPYBREAK 128
+#endif
+
+/* Set to 1 to hand all the received frames to tcpip_thread with one message */
+#ifndef ETH_RX_BATCH
+#define ETH_RX_BATCH 0
+#endif
+
+/* Set to 1 to coalesce in-order TCP segments of the same connection in one RX
+   batch into one segment before LwIP stack (software GRO). Segments with
+   flags other than ACK and PSH are not coalesced. */
+#ifndef ETH_RX_GRO
+#define ETH_RX_GRO 0
+#endif
+
+#if ETH_RX_GRO
+#if !ETH_RX_BATCH
+#error "ETH_RX_GRO requires ETH_RX_BATCH"
+#endif
+/* Number of connections coalesced at the same time */
+#ifndef ETH_GRO_FLOWS
+#define ETH_GRO_FLOWS 4
+#endif
+/* Maximum number of segments coalesced into one */
+#ifndef ETH_GRO_SEGS
+#define ETH_GRO_SEGS 8
+#endif
+/* Time (ms) to hold coalesced segments for the next RX batch, 0 to pass them
+   at the end of each batch */
+#ifndef ETH_GRO_FLUSH_MS
+#define ETH_GRO_FLUSH_MS 0
+#endif
+#endif /* ETH_RX_GRO */
+
+/* Set to 1 to defer RX processing from ETH interrupt to a RX thread */
+#ifndef ETH_RX_DEFERRED
+#define ETH_RX_DEFERRED 0
+#endif
+
+#if ETH_RX_DEFERRED
+#ifndef ETH_INPUT_USE_IT
+#error "ETH_RX_DEFERRED requires ETH_INPUT_USE_IT"
+#endif
+/* Maximum number of RX descriptors processed by RX thread before sleeping one
+   tick */
+#ifndef ETH_RX_BUDGET
+#define ETH_RX_BUDGET ETH_RXBUFNB
+#endif
+#ifndef ETH_RX_THREAD_STACKSIZE
+#define ETH_RX_THREAD_STACKSIZE (512 * 2)
+#endif
+/* Bigger number means higher priority (CMSIS OS API). Not above tcpip_thread,
+   which handles the received frames */
+#ifndef ETH_RX_THREAD_PRIO
+#define ETH_RX_THREAD_PRIO TCPIP_THREAD_PRIO
+#endif
+#endif /* ETH_RX_DEFERRED */
+
+/* Set to 1 to filter received frames in the driver before they reach LwIP */
+#ifndef ETH_FLOW_FILTER
+#define ETH_FLOW_FILTER 0
+#endif
+
+#if ETH_FLOW_FILTER
+/* Flow filter rule fields to match, all the given ones must match */
+#define ETH_FILTER_MATCH_ETHTYPE  0x01U   /* EtherType (after VLAN tag) */
+#define ETH_FILTER_MATCH_PROTO    0x02U   /* IPv4 protocol */
+#define ETH_FILTER_MATCH_PORT     0x04U   /* TCP/UDP destination port */
+#define ETH_FILTER_MATCH_BCAST    0x08U   /* Broadcast destination */
+#define ETH_FILTER_MATCH_MCAST    0x10U   /* Multicast destination */
+
+/* Flow filter rule actions */
+#define ETH_FILTER_PASS           0U
+#define ETH_FILTER_DROP           1U
+
+/* IPv6 frames pass the default rules only if LwIP handles them */
+#if LWIP_IPV6
+#define ETH_FLOW_FILTER_PASS_IPV6 \
+  { ETH_FILTER_MATCH_ETHTYPE, ETH_FILTER_PASS, ETHTYPE_IPV6, 0, 0, 0, 0 },
+#else
+#define ETH_FLOW_FILTER_PASS_IPV6
+#endif
+
+/* Flow filter rules, checked in order and the first match applies. Frames
+   not matching any rule are passed. Override it in "lwipopts_extra.h". */
+#ifndef ETH_FLOW_FILTER_RULES
+#define ETH_FLOW_FILTER_RULES \
+  /* ARP storm protection */ \
+  { ETH_FILTER_MATCH_ETHTYPE, ETH_FILTER_PASS, ETHTYPE_ARP, 0, 0, 100, 20 }, \
+  /* Broadcast storm protection */ \
+  { ETH_FILTER_MATCH_BCAST, ETH_FILTER_PASS, 0, 0, 0, 200, 40 }, \
+  /* Drop frames of the EtherTypes LwIP doesn't handle */ \
+  { ETH_FILTER_MATCH_ETHTYPE, ETH_FILTER_PASS, ETHTYPE_IP, 0, 0, 0, 0 }, \
+  ETH_FLOW_FILTER_PASS_IPV6 \
+  { 0, ETH_FILTER_DROP, 0, 0, 0, 0, 0 },
+#endif
+#endif /* ETH_FLOW_FILTER */
+
+/* Set to 1 to timestamp frames with IEEE 1588 (PTP) MAC clock */
+#ifndef ETH_PTP
+#define ETH_PTP 0
+#endif
+
+/* Set to 1 to return from ethernetif_init() at once, with link down, and let
+   ethernet thread initialize MAC, DMA and PHY. MAC and DMA start without
+   waiting for PHY auto-negotiation (STM32F2/F4/F7), the link is up once PHY
+   state machine reads the negotiated speed and duplex mode. */
+#ifndef ETH_INIT_ASYNC
+#define ETH_INIT_ASYNC 0
+#endif
+
+/* PHY back end: ETH_PHY_AUTO (detected by PHY identifier), ETH_PHY_LAN8742A,
+   ETH_PHY_DP83848 or ETH_PHY_KSZ8081 (in "ethernetif_phy.h") */
+#ifndef ETH_PHY
+#define ETH_PHY ETH_PHY_AUTO
+#endif
+/* PHY address on MDIO bus */
+#ifndef ETH_PHY_ADDRESS
+#define ETH_PHY_ADDRESS LAN8742A_PHY_ADDRESS
+#endif
+
+/* Define ETH_PHY_INT_PIN to the Arduino pin wired to PHY interrupt output
+   (nINT), to check link status on PHY interrupt instead of polling it */
+
+/* Events of ethernet thread, signaled by ethernetif_notify() */
+#define ETH_EVENT_RX_RESUME   0x01U   /* RX DMA suspended as RX buffer unavailable (RBUS) */
+#define ETH_EVENT_TX_RESUME   0x02U   /* TX DMA suspended as TX underflow (TUS) */
+#define ETH_EVENT_LINK        0x04U   /* PHY interrupt: link status changed */
+#define ETH_EVENT_DHCP        0x08U   /* DHCP state set by user */
+#define ETH_EVENT_INIT        0x10U   /* Initialize MAC, DMA and PHY (ETH_INIT_ASYNC) */
+#define ETH_EVENT_TX_RECLAIM  0x20U   /* Transmitted frames to reclaim, and queued ones to send */
+#define ETH_EVENT_ALL         0x3FU
+
+/* Speed and duplex mode for ethernetif_set_fast_boot(), 0 if unknown */
+#define ETH_LINK_CONFIG_VALID 0x80U
+#define ETH_LINK_CONFIG_100M  0x01U
+#define ETH_LINK_CONFIG_FULL  0x02U
+
+/* No timeout for ethernetif_wait_event() */
+#define ETH_WAIT_FOREVER      0xFFFFFFFFU
+
+/* MAC frame filter modes for ethernetif_set_rx_filter() */
+#define ETH_RX_FILTER_RECEIVE_ALL     ETH_MACFFR_RA   /* Pass all frames to DMA, even failing address filter */
+#define ETH_RX_FILTER_PROMISCUOUS     ETH_MACFFR_PM   /* Pass all frames passing CRC check */
+#define ETH_RX_FILTER_ALL_MULTICAST   ETH_MACFFR_PAM  /* Pass all multicast frames */
+#define ETH_RX_FILTER_NO_BROADCAST    ETH_MACFFR_BFD  /* Drop broadcast frames */
+#define ETH_RX_FILTER_HASH_MULTICAST  ETH_MACFFR_HM   /* Multicast: hash table instead of perfect filter */
+#define ETH_RX_FILTER_HASH_UNICAST    ETH_MACFFR_HU   /* Unicast: hash table instead of perfect filter */
+#define ETH_RX_FILTER_HASH_OR_PERFECT ETH_MACFFR_HPF  /* Pass frames matching either hash table or perfect filter */
+#define ETH_RX_FILTER_SOURCE_ADDR     ETH_MACFFR_SAF  /* Drop frames failing source address filter */
+#define ETH_RX_FILTER_CTRL_BLOCK      ETH_MACFFR_PCF_BlockAll
+#define ETH_RX_FILTER_CTRL_PASS       ETH_MACFFR_PCF_ForwardAll
+#define ETH_RX_FILTER_CTRL_FILTERED   ETH_MACFFR_PCF_ForwardPassedAddrFilter
+
+/* Number of MAC perfect filter addresses, in addition to the station address */
+#define ETH_MAC_FILTER_NUM            3
+
+#ifdef ETH_INPUT_USE_IT
+/* Adaptive RX interrupt moderation: packet rate sampling period (ms) */
+#ifndef ETH_RX_COALESCE_PERIOD
+#define ETH_RX_COALESCE_PERIOD 100
+#endif
+#endif /* ETH_INPUT_USE_IT */
+
+#if ETH_BENCHMARK
+/* Faults for ethernetif_bench_inject() */
+#define ETH_FAULT_NONE        0x00U
+/* Hold every RX descriptor until the ring is exhausted, then hand the ring
+   back without a receive poll demand (leads to RBUS) */
+#define ETH_FAULT_RX_EXHAUST  0x01U
+/* Drop the next transmit poll demand while TX DMA is suspended (TBUS/TUS) */
+#define ETH_FAULT_TX_STALL    0x02U
+#endif /* ETH_BENCHMARK */
+
 /* Exported types ------------------------------------------------------------*/
+#if ETH_PTP
+typedef struct {
+  uint32_t sec;
+  uint32_t nsec;
+} ethernetif_timestamp_t;
+#endif /* ETH_PTP */
+
+#if (ETH_TX_PRIO_NUM > 1)
+typedef struct {
+  uint8_t proto;                /* IPv4 protocol, 0 for any */
+  uint16_t port;                /* TCP/UDP source or destination port, 0 for any */
+  uint8_t prio;                 /* TX priority class */
+} ethernetif_tx_rule_t;
+#endif
+
+#if ETH_FLOW_FILTER
+typedef struct {
+  uint8_t match;                /* ETH_FILTER_MATCH_xxx */
+  uint8_t action;               /* ETH_FILTER_PASS or ETH_FILTER_DROP */
+  uint16_t ethtype;
+  uint8_t proto;
+  uint16_t port;
+  uint32_t rate;                /* Passed frames per second, 0 for unlimited */
+  uint32_t burst;               /* Frames passed in a burst over "rate" */
+} ethernetif_filter_rule_t;
+
+typedef struct {
+  uint32_t hits;                /* Frames matching the rule */
+  uint32_t drops;               /* Frames dropped by the rule or its rate limit */
+} ethernetif_filter_stats_t;
+#endif /* ETH_FLOW_FILTER */
+
+typedef struct {
+  uint32_t rx_mbox_drop;        /* Frames dropped as tcpip_thread mailbox was full */
+  uint32_t rx_batch;            /* Batches handed to tcpip_thread */
+  uint32_t rx_batch_max;        /* Frames in the largest batch */
+  uint32_t rx_poll;             /* RX thread polling passes */
+  uint32_t rx_budget_out;       /* RX thread passes ended by ETH_RX_BUDGET */
+  uint32_t rx_irq;              /* RX interrupts */
+  uint32_t rx_coalesce_usecs;   /* Current RX interrupt watchdog delay */
+  uint32_t rx_coalesce_frames;  /* Current frames per RX interrupt */
+  uint32_t rx_spare;            /* Free spare RX buffers */
+  uint32_t rx_spare_low;        /* Low watermark of free spare RX buffers */
+  uint32_t rx_spare_high;       /* High watermark of free spare RX buffers */
+  uint32_t rx_spare_empty;      /* Frames dropped as no spare RX buffer */
+  uint32_t rx_filter_drop;      /* Frames dropped by flow filter */
+  uint32_t rx_vlan_drop;        /* Frames dropped as VLAN ID not matching */
+  uint32_t rx_gro_merged;       /* TCP segments coalesced into another one */
+  uint32_t rx_gro_flush;        /* Coalesced TCP segments passed to LwIP */
+  uint32_t tx_irq;              /* TX complete interrupts */
+  uint32_t tx_reclaim;          /* Transmitted frames reclaimed */
+  uint32_t tx_busy_max;         /* Most TX descriptors owned by DMA */
+  uint32_t tx_queued;           /* Frames waited in TX queue */
+  uint32_t tx_queue_max;        /* Most frames in TX queue */
+  uint32_t tx_queue_drop;       /* Frames dropped as TX queue full */
+  uint32_t tx_prio_ahead;       /* Frames sent ahead of queued lower class ones */
+  uint32_t tx_poll_demand;      /* TX DMA resumed by poll demand */
+  uint32_t tx_copybreak;        /* Frames copied to TX bounce buffer */
+  uint32_t tx_bounce_empty;     /* Times no free TX bounce buffer */
+} ethernetif_stats_t;
+
+#if ETH_BENCHMARK
+typedef struct {
+  uint32_t start_tick;          /* HAL tick of the last reset */
+  uint32_t rx_frames;
+  uint64_t rx_bytes;
+  uint64_t rx_cycles;           /* Cycles spent in low_level_input() */
+  uint32_t tx_frames;
+  uint64_t tx_bytes;
+  uint64_t tx_cycles;           /* Cycles spent in low_level_output() */
+  uint32_t rx_recover_cnt;      /* Recovered RX faults */
+  uint64_t rx_recover_cycles;   /* Total cycles from fault to next RX frame */
+  uint32_t rx_recover_max;
+  uint32_t tx_recover_cnt;      /* Recovered TX faults */
+  uint64_t tx_recover_cycles;   /* Total cycles from fault to TX resume */
+  uint32_t tx_recover_max;
+} ethernetif_bench_t;
+#endif /* ETH_BENCHMARK */
+
+/* Exported functions ------------------------------------------------------- */
 uint8_t ethernetif_is_init(void);
 err_t ethernetif_init(struct netif *netif);
 void ethernetif_input(struct netif *netif);
 err_t ethernetif_output(struct netif *netif, struct pbuf *p);
+void ethernetif_tx_more(uint8_t more);
+void ethernetif_event_init(void);
+void ethernetif_notify(uint32_t events);
+uint32_t ethernetif_wait_event(uint32_t timeout);
+void ethernetif_resume(struct netif *netif, uint32_t events);
+uint8_t ethernetif_wait_ready(uint32_t timeout);
+void ethernetif_set_fast_boot(uint8_t config);
+uint8_t ethernetif_get_link_config(void);
+#if ETH_INIT_ASYNC
+void ethernetif_start(struct netif *netif);
+#endif
 void ethernetif_set_link(struct netif *netif);
+uint32_t ethernetif_phy_step(struct netif *netif);
 void ethernetif_update_config(struct netif *netif);
 void ethernetif_notify_conn_changed(struct netif *netif);
 void ethernetif_status_changed(struct netif *netif);
+void ethernetif_notify_status_changed(struct netif *netif);
 
 void ethernetif_set_mac_addr(const uint8_t *mac);
+void ethernetif_get_stats(ethernetif_stats_t *stats);
+void ethernetif_clear_stats(void);
+
+int ethernetif_set_mac_filter(uint8_t index, const uint8_t *mac, uint8_t source, uint8_t mask);
+int ethernetif_set_vlan_filter(uint16_t vid);
+int ethernetif_set_rx_filter(uint32_t mode);
+uint32_t ethernetif_get_rx_filter(void);
+
+#if ETH_FLOW_FILTER
+uint32_t ethernetif_get_filter_stats(ethernetif_filter_stats_t *stats, uint32_t num);
+#endif
+
+#if ETH_PTP
+int ethernetif_get_rx_timestamp(const struct pbuf *p, ethernetif_timestamp_t *ts);
+uint32_t ethernetif_get_tx_mark(void);
+int ethernetif_get_tx_timestamp(uint32_t mark, ethernetif_timestamp_t *ts);
+void ethernetif_ptp_get_time(ethernetif_timestamp_t *ts);
+int ethernetif_ptp_set_time(const ethernetif_timestamp_t *ts);
+int ethernetif_ptp_adjust_time(int64_t nsec);
+int ethernetif_ptp_adjust_freq(int32_t ppb);
+#endif
+
+#ifdef ETH_INPUT_USE_IT
+void ethernetif_set_rx_coalesce(uint32_t usecs, uint32_t frames);
+void ethernetif_set_rx_coalesce_adaptive(uint32_t low_pps, uint32_t high_pps, uint32_t max_usecs);
+#endif
 
 #if LWIP_IGMP
 err_t igmp_mac_filter(struct netif *netif, const ip4_addr_t *ip4_addr, netif_mac_filter_action action);
 void register_multicast_address(const uint8_t *mac);
+void unregister_multicast_address(const uint8_t *mac);
+uint32_t ethcrc(const uint8_t *data, size_t length);
+#endif
+
+#if ETH_BENCHMARK
+void ethernetif_bench_reset(void);
+void ethernetif_bench_get(ethernetif_bench_t *bench);
+void ethernetif_bench_inject(uint32_t fault);
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,169 @@
+/***************************************************************************//**
+ * @file    ethernetif_phy.cpp
+ * @brief   Arduino RTT-Ethernet library PHY driver
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+/* Includes ------------------------------------------------------------------*/
+#include "ethernetif_phy.h"
+
+#define LOG_TAG "ETH_PHY"
+#include <log.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Private define ------------------------------------------------------------*/
+/* LAN8742A (SMSC/Microchip) */
+#define LAN8742A_ID           0x0007C130UL
+#define LAN8742A_ISFR         29U       /* Interrupt source flag */
+#define LAN8742A_IMR          30U       /* Interrupt mask */
+#define LAN8742A_SR           31U       /* PHY special control/status */
+#define LAN8742A_INT4         0x0010U   /* Link down */
+#define LAN8742A_INT6         0x0040U   /* Auto-negotiation complete */
+#define LAN8742A_SR_AUTODONE  0x1000U
+#define LAN8742A_SR_10M       0x0004U
+#define LAN8742A_SR_FULL      0x0010U
+
+/* DP83848 (TI) */
+#define DP83848_ID            0x20005C90UL
+#define DP83848_PHYSTS        0x10U     /* PHY status */
+#define DP83848_MICR          0x11U     /* MII interrupt control */
+#define DP83848_MISR          0x12U     /* MII interrupt status and enable */
+#define DP83848_PHYSTS_10M    0x0002U
+#define DP83848_PHYSTS_FULL   0x0004U
+#define DP83848_PHYSTS_ANDONE 0x0010U
+#define DP83848_MICR_INTEN    0x0002U
+#define DP83848_MICR_INT_OE   0x0001U
+#define DP83848_MISR_ANC_EN   0x0004U   /* Auto-negotiation complete */
+#define DP83848_MISR_LINK_EN  0x0020U   /* Link status changed */
+#define DP83848_MISR_LINK     0x2000U
+
+/* KSZ8081 (Micrel/Microchip) */
+#define KSZ8081_ID            0x00221560UL
+#define KSZ8081_ICSR          0x1BU     /* Interrupt control/status */
+#define KSZ8081_PC1           0x1EU     /* PHY control 1 */
+#define KSZ8081_ICSR_UP_EN    0x0100U
+#define KSZ8081_ICSR_DOWN_EN  0x0400U
+#define KSZ8081_ICSR_DOWN     0x0004U
+#define KSZ8081_PC1_MODE      0x0007U   /* Operation mode, 0 while negotiating */
+#define KSZ8081_PC1_100M      0x0002U
+#define KSZ8081_PC1_FULL      0x0004U
+
+/* Private functions ---------------------------------------------------------*/
+static void lan8742a_irq_enable(ETH_HandleTypeDef *heth, uint8_t link_up) {
+  uint32_t regvalue = 0;
+
+  HAL_ETH_ReadPHYRegister(heth, LAN8742A_IMR, &regvalue);
+  regvalue |= LAN8742A_INT4;
+  if (link_up) {
+    regvalue |= LAN8742A_INT6;
+  }
+  HAL_ETH_WritePHYRegister(heth, LAN8742A_IMR, regvalue);
+}
+
+static uint8_t lan8742a_status(uint16_t regvalue, uint32_t *speed, uint32_t *duplex) {
+  if ((regvalue & LAN8742A_SR_AUTODONE) == 0) {
+    return 0;
+  }
+  *speed = (regvalue & LAN8742A_SR_10M) ? ETH_SPEED_10M : ETH_SPEED_100M;
+  *duplex = (regvalue & LAN8742A_SR_FULL) ? ETH_MODE_FULLDUPLEX : ETH_MODE_HALFDUPLEX;
+  return 1;
+}
+
+static void dp83848_irq_enable(ETH_HandleTypeDef *heth, uint8_t link_up) {
+  uint32_t regvalue = DP83848_MISR_LINK_EN;
+
+  if (link_up) {
+    regvalue |= DP83848_MISR_ANC_EN;
+  }
+  HAL_ETH_WritePHYRegister(heth, DP83848_MISR, regvalue);
+  HAL_ETH_WritePHYRegister(heth, DP83848_MICR, DP83848_MICR_INTEN | DP83848_MICR_INT_OE);
+}
+
+static uint8_t dp83848_status(uint16_t regvalue, uint32_t *speed, uint32_t *duplex) {
+  if ((regvalue & DP83848_PHYSTS_ANDONE) == 0) {
+    return 0;
+  }
+  *speed = (regvalue & DP83848_PHYSTS_10M) ? ETH_SPEED_10M : ETH_SPEED_100M;
+  *duplex = (regvalue & DP83848_PHYSTS_FULL) ? ETH_MODE_FULLDUPLEX : ETH_MODE_HALFDUPLEX;
+  return 1;
+}
+
+static void ksz8081_irq_enable(ETH_HandleTypeDef *heth, uint8_t link_up) {
+  uint32_t regvalue = KSZ8081_ICSR_DOWN_EN;
+
+  if (link_up) {
+    regvalue |= KSZ8081_ICSR_UP_EN;
+  }
+  HAL_ETH_WritePHYRegister(heth, KSZ8081_ICSR, regvalue);
+}
+
+static uint8_t ksz8081_status(uint16_t regvalue, uint32_t *speed, uint32_t *duplex) {
+  if ((regvalue & KSZ8081_PC1_MODE) == 0) {
+    return 0;
+  }
+  *speed = (regvalue & KSZ8081_PC1_100M) ? ETH_SPEED_100M : ETH_SPEED_10M;
+  *duplex = (regvalue & KSZ8081_PC1_FULL) ? ETH_MODE_FULLDUPLEX : ETH_MODE_HALFDUPLEX;
+  return 1;
+}
+
+/* Exported variables --------------------------------------------------------*/
+const ethernetif_phy_ops_t ethernetif_phy_lan8742a = {
+  "LAN8742A", LAN8742A_ID, lan8742a_irq_enable,
+  LAN8742A_ISFR, LAN8742A_INT4, LAN8742A_SR, lan8742a_status,
+};
+
+const ethernetif_phy_ops_t ethernetif_phy_dp83848 = {
+  "DP83848", DP83848_ID, dp83848_irq_enable,
+  DP83848_MISR, DP83848_MISR_LINK, DP83848_PHYSTS, dp83848_status,
+};
+
+const ethernetif_phy_ops_t ethernetif_phy_ksz8081 = {
+  "KSZ8081", KSZ8081_ID, ksz8081_irq_enable,
+  KSZ8081_ICSR, KSZ8081_ICSR_DOWN, KSZ8081_PC1, ksz8081_status,
+};
+
+/* Private variables ---------------------------------------------------------*/
+static const ethernetif_phy_ops_t *const phy_table[] = {
+  &ethernetif_phy_lan8742a,
+  &ethernetif_phy_dp83848,
+  &ethernetif_phy_ksz8081,
+};
+
+/* Exported functions ------------------------------------------------------- */
+/**
+  * @brief  Get the PHY operations, detecting the PHY by its identifier with
+  *         blocking MDIO if "phy" is ETH_PHY_AUTO
+  * @param  heth: ETH handle, with PHY address set
+  * @param  phy: one of ETH_PHY_xxx
+  * @retval PHY operations, LAN8742A ones if the PHY is unknown
+  */
+const ethernetif_phy_ops_t *ethernetif_phy_probe(ETH_HandleTypeDef *heth, uint32_t phy)
+{
+  uint32_t id1 = 0;
+  uint32_t id2 = 0;
+  uint32_t id;
+  uint32_t i;
+
+  if ((phy != ETH_PHY_AUTO) && (phy <= (sizeof(phy_table) / sizeof(phy_table[0])))) {
+    return phy_table[phy - 1];
+  }
+
+  HAL_ETH_ReadPHYRegister(heth, ETH_PHY_IDR1, &id1);
+  HAL_ETH_ReadPHYRegister(heth, ETH_PHY_IDR2, &id2);
+  id = ((id1 << 16) | (id2 & 0xFFFFU)) & ETH_PHY_ID_MASK;
+  for (i = 0; i < (sizeof(phy_table) / sizeof(phy_table[0])); i++) {
+    if (phy_table[i]->id == id) {
+      LOG_D("PHY %s", phy_table[i]->name);
+      return phy_table[i];
+    }
+  }
+
+  LOG_W("Unknown PHY %08lx", (unsigned long)id);
+  return &ethernetif_phy_lan8742a;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,59 @@
+/***************************************************************************//**
+ * @file    ethernetif_phy.h
+ * @brief   Arduino RTT-Ethernet library PHY driver header
+ * @author  onelife <onelife.real[at]gmail.com>
+ ******************************************************************************/
+#ifndef __ETHERNETIF_PHY_H__
+#define __ETHERNETIF_PHY_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32_def.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+/* PHY back ends for ETH_PHY */
+#define ETH_PHY_AUTO          0   /* Detected by PHY identifier */
+#define ETH_PHY_LAN8742A      1
+#define ETH_PHY_DP83848       2
+#define ETH_PHY_KSZ8081       3
+
+/* Standard PHY identifier registers */
+#define ETH_PHY_IDR1          2U
+#define ETH_PHY_IDR2          3U
+/* PHY identifier without revision number */
+#define ETH_PHY_ID_MASK       0xFFFFFFF0UL
+
+/* Exported types ------------------------------------------------------------*/
+/* PHY operations. Link status itself is read from standard basic status
+   register (BSR). Registers in "irq_reg" and "status_reg" are read one MDIO
+   operation at a time by PHY state machine. */
+typedef struct {
+  const char *name;
+  uint32_t id;                  /* (PHYIDR1 << 16) | PHYIDR2, without revision */
+  /* Enable PHY interrupt on link down, and on link up (or auto-negotiation
+     complete) if "link_up" is set. Called once at init with blocking MDIO. */
+  void (*irq_enable)(ETH_HandleTypeDef *heth, uint8_t link_up);
+  uint16_t irq_reg;             /* Interrupt status register, cleared by reading */
+  uint16_t irq_link_down;       /* Flags of "irq_reg" telling link may be down */
+  uint16_t status_reg;          /* Register with auto-negotiation result */
+  /* Get speed (ETH_SPEED_xxx) and duplex mode (ETH_MODE_xxx) from "status_reg"
+     value, return 0 if auto-negotiation is not done */
+  uint8_t (*status)(uint16_t regvalue, uint32_t *speed, uint32_t *duplex);
+} ethernetif_phy_ops_t;
+
+/* Exported variables --------------------------------------------------------*/
+extern const ethernetif_phy_ops_t ethernetif_phy_lan8742a;
+extern const ethernetif_phy_ops_t ethernetif_phy_dp83848;
+extern const ethernetif_phy_ops_t ethernetif_phy_ksz8081;
+
+/* Exported functions ------------------------------------------------------- */
+const ethernetif_phy_ops_t *ethernetif_phy_probe(ETH_HandleTypeDef *heth, uint32_t phy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ETHERNETIF_PHY_H__ */
@@ -9,36 +9,136 @@
 /* Includes ------------------------------------------------------------------*/
 #include <stddef.h>
 #include <stdint.h>
-#include <stdbool.h>
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+/* Exported functions ------------------------------------------------------- */
+/* Smallest power of two not less than "n" */
+constexpr uint32_t queue_pow2(uint32_t n) {
+  return (n <= 1) ? 1 : (2 * queue_pow2((n + 1) / 2));
+}
 
 /* Exported types ------------------------------------------------------------*/
-typedef struct {
-    uint32_t front, rear, put_cnt, get_cnt;
-    uint32_t capacity;
-    void **array;
-} queue_t;
-
-/* Exported macros ---------------------------------------------------------- */
-#define queue_init(q, b) { \
-    q.front = 0; \
-    q.rear = sizeof(b) / sizeof(void *) - 1; \
-    q.put_cnt = q.get_cnt = 0; \
-    q.capacity = q.rear + 1; \
-    q.array = b; \
-}
+/* Lock-free single-producer/single-consumer ring of at least "N" items of type
+   "T", stored in place. Capacity is rounded up to power of two at compile time,
+   so index wrapping is a mask.
+   - put functions are called by the producer only
+   - get functions are called by the consumer only
+   "head" is written by the producer only and "tail" by the consumer only. Both
+   are free running, and published with release and read with acquire ordering.
+   There is no constructor, so it may live in memory from mem_malloc(): call
+   init() before use. */
+template <typename T, uint32_t N>
+class spsc_queue {
 
-/* Exported functions ------------------------------------------------------- */
-bool is_full(queue_t *queue);
-bool is_empty(queue_t *queue);
-bool queue_put(queue_t *queue, void *item);
-void *queue_get(queue_t *queue);
+  public:
+    static constexpr uint32_t capacity = queue_pow2(N);
 
-#ifdef __cplusplus
-}
-#endif
+    void init(void)
+    {
+      head = tail = 0;
+    }
+
+    bool is_full(void)
+    {
+      return ((load_own(head) - load_peer(tail)) > mask);
+    }
+
+    bool is_empty(void)
+    {
+      return (load_peer(head) == load_own(tail));
+    }
+
+    uint32_t count(void)
+    {
+      return (load_peer(head) - load_peer(tail));
+    }
+
+    // Returns false if full
+    bool put(const T &item)
+    {
+      uint32_t h = load_own(head);
+
+      if ((h - load_peer(tail)) > mask) {
+        return false;
+      }
+      array[h & mask] = item;
+      store_own(head, h + 1);
+      return true;
+    }
+
+    // Returns number of items put
+    uint32_t put_n(const T *items, uint32_t n)
+    {
+      uint32_t h = load_own(head);
+      uint32_t space = capacity - (h - load_peer(tail));
+      uint32_t i;
+
+      if (n > space) {
+        n = space;
+      }
+      for (i = 0; i < n; i++) {
+        array[(h + i) & mask] = items[i];
+      }
+      if (n) {
+        store_own(head, h + n);
+      }
+      return n;
+    }
+
+    // Returns T() if empty
+    T get(void)
+    {
+      uint32_t t = load_own(tail);
+      T item;
+
+      if (load_peer(head) == t) {
+        return T();
+      }
+      item = array[t & mask];
+      store_own(tail, t + 1);
+      return item;
+    }
+
+    // Returns number of items got
+    uint32_t get_n(T *items, uint32_t n)
+    {
+      uint32_t t = load_own(tail);
+      uint32_t avail = load_peer(head) - t;
+      uint32_t i;
+
+      if (n > avail) {
+        n = avail;
+      }
+      for (i = 0; i < n; i++) {
+        items[i] = array[(t + i) & mask];
+      }
+      if (n) {
+        store_own(tail, t + n);
+      }
+      return n;
+    }
+
+  private:
+    static constexpr uint32_t mask = capacity - 1;
+
+    // Own index: only written by the caller
+    static uint32_t load_own(const uint32_t &x)
+    {
+      return __atomic_load_n(&x, __ATOMIC_RELAXED);
+    }
+    // Peer index: items (or slots) before it are visible after the load
+    static uint32_t load_peer(const uint32_t &x)
+    {
+      return __atomic_load_n(&x, __ATOMIC_ACQUIRE);
+    }
+    // Publish own index after the items (or slots) before it
+    static void store_own(uint32_t &x, uint32_t v)
+    {
+      __atomic_store_n(&x, v, __ATOMIC_RELEASE);
+    }
+
+    uint32_t head;              // Next slot to put
+    uint32_t tail;              // Next slot to get
+    T array[capacity];
+};
 
 #endif
@@ -82,6 +82,12 @@ __IO uint8_t DHCP_state = DHCP_OFF;
 /* Set to 1 if user use DHCP to obtain network addresses */
 static uint8_t DHCP_Started_by_user = 0;
 
+/* Given when DHCP is done: address assigned or timeout */
+static sys_sem_t DHCP_done_sem;
+
+/* Called once when DHCP is done, with 1 if address assigned or 0 if timeout */
+static void (*DHCP_done_callback)(int) = NULL;
+
 /* Ethernet link status periodic timer */
 static uint32_t gEhtLinkTickStart = 0;
 
@@ -128,39 +134,110 @@ static void tcpip_init_done(void *arg)
 #endif /* LWIP_NETIF_STATUS_CALLBACK */
 }
 
+#ifdef ETH_PHY_INT_PIN
+/**
+* @brief  PHY interrupt handler: wakes up ethernet thread to check link status
+* @param  None
+* @retval None
+*/
+static void phy_irq_handler(void)
+{
+  ethernetif_notify(ETH_EVENT_LINK);
+}
+#endif /* ETH_PHY_INT_PIN */
+
+/**
+* @brief  Time left before a periodic timer is due
+* @param  start: tick of the last run
+* @param  period: in ms
+* @param  now: current tick
+* @retval Time left in ms, 0 if due
+*/
+static uint32_t time_left(uint32_t start, uint32_t period, uint32_t now)
+{
+  uint32_t elapsed = now - start;
+
+  return (elapsed >= period) ? 0 : (period - elapsed);
+}
+
+/**
+* @brief  Time ethernet thread may sleep before the next due timer
+* @param  timeout: time in ms before the next step of PHY state machine
+* @retval Time in ms, or ETH_WAIT_FOREVER
+*/
+static uint32_t ethernet_thread_timeout(uint32_t timeout)
+{
+  uint32_t now = HAL_GetTick();
+  uint32_t left;
+
+#ifndef ETH_PHY_INT_PIN
+  left = time_left(gEhtLinkTickStart, TIME_CHECK_ETH_LINK_STATE, now);
+  if (left < timeout) {
+    timeout = left;
+  }
+#endif
+#if LWIP_DHCP
+  /* DHCP state machine only runs until address assigned, timeout or stopped */
+  if ((DHCP_state == DHCP_START) || (DHCP_state == DHCP_WAIT_ADDRESS) ||
+      (DHCP_state == DHCP_ASK_RELEASE) || (DHCP_state == DHCP_LINK_DOWN)) {
+    left = time_left(DHCPfineTimer, DHCP_FINE_TIMER_MSECS, now);
+    if (left < timeout) {
+      timeout = left;
+    }
+  }
+#endif /* LWIP_DHCP */
+  (void)now;
+  (void)left;
+  return timeout;
+}
+
 void ethernet_thread(void *arg) {
-  extern ETH_HandleTypeDef EthHandle;
+  uint32_t events;
+  uint32_t phy_timeout;
   (void)arg;
 
+  /* Check ethernet link status at start */
+  events = ETH_EVENT_LINK;
+
   while (1) {
-    /* Check RX status */
-    if ((EthHandle.Instance->DMASR & ETH_DMASR_RBUS) != (uint32_t)RESET) {
-      LOG_D("Re-enable RX");
-      ethernetif_input(&gnetif);
+#if ETH_INIT_ASYNC
+    if (events & ETH_EVENT_INIT) {
+      /* Only this thread waits for PHY auto-negotiation */
+      ethernetif_start(&gnetif);
     }
+#endif
 
-    /* When Transmit Underflow flag is set, clear it and issue a Transmit Poll Demand to resume transmission */
-    if ((EthHandle.Instance->DMASR & ETH_DMASR_TUS) != (uint32_t)RESET) {
-      LOG_D("Re-enable TX");
-      ethernetif_output(&gnetif, NULL);
+    /* Resume DMA suspended as RX buffer unavailable or TX underflow, and
+       reclaim transmitted frames not reclaimed by tcpip_thread */
+    if (events & (ETH_EVENT_RX_RESUME | ETH_EVENT_TX_RESUME | ETH_EVENT_TX_RECLAIM)) {
+      ethernetif_resume(&gnetif, events);
     }
 
-    /* Check ethernet link status */
+#ifndef ETH_PHY_INT_PIN
+    /* No PHY interrupt: poll ethernet link status */
     if ((HAL_GetTick() - gEhtLinkTickStart) >= TIME_CHECK_ETH_LINK_STATE) {
-      LOCK_TCPIP_CORE();
+      events |= ETH_EVENT_LINK;
+    }
+#endif
+
+    /* Check ethernet link status */
+    if (events & ETH_EVENT_LINK) {
       ethernetif_set_link(&gnetif);
-      UNLOCK_TCPIP_CORE();
       gEhtLinkTickStart = HAL_GetTick();
     }
-
-    /* Handle LwIP timeouts */
-    // sys_check_timeouts();
+    /* One MDIO operation per wake up, without TCPIP core locked */
+    phy_timeout = ethernetif_phy_step(&gnetif);
 
 #if LWIP_DHCP
+    if (events & ETH_EVENT_DHCP) {
+      /* Run DHCP state machine now */
+      DHCPfineTimer = HAL_GetTick() - DHCP_FINE_TIMER_MSECS;
+    }
     stm32_DHCP_Periodic_Handle(&gnetif);
 #endif /* LWIP_DHCP */
 
-    sys_msleep(20);
+    /* Sleep until an event or the next due timer */
+    events = ethernetif_wait_event(ethernet_thread_timeout(phy_timeout));
   }
 }
 
@@ -202,17 +279,31 @@ void stm32_eth_init(const uint8_t *mac, const uint8_t *ip, const uint8_t *gw, co
 #endif /* LWIP_DHCP */
     }
 
+    /* Events must be ready before ETH and PHY interrupts */
+    ethernetif_event_init();
+#if LWIP_DHCP
+    if (sys_sem_new(&DHCP_done_sem, 0) != ERR_OK) {
+      LOG_E("DHCP sem new failed");
+    }
+#endif /* LWIP_DHCP */
+
     /* Initialize the LwIP stack */
     tcpip_init(&tcpip_init_done, NULL);
 
+#ifdef ETH_PHY_INT_PIN
+    /* PHY interrupt output is active low */
+    pinMode(ETH_PHY_INT_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(ETH_PHY_INT_PIN), phy_irq_handler, FALLING);
+#endif
+
+    /* Start Ethernet thread */
+    (void)sys_thread_new("ethernet", ethernet_thread, NULL, ETHERNET_THREAD_STACKSIZE, ETHERNET_THREAD_PRIO);
+
     initDone = 1;
   }
 
   /* Reset DHCP if used */
   User_notification(&gnetif);
-
-  /* Start Ethernet thread */
-  (void)sys_thread_new("ethernet", ethernet_thread, NULL, ETHERNET_THREAD_STACKSIZE, ETHERNET_THREAD_PRIO);
 }
 
 /**
@@ -235,6 +326,112 @@ uint8_t stm32_eth_link_up(void)
   return netif_is_link_up(&gnetif);
 }
 
+/**
+  * @brief  Wait for the network to be ready: link up and IP address set
+  * @param  timeout: in ms, 0 not to wait
+  * @retval 1 for ready, 0 for not ready
+  */
+uint8_t stm32_eth_wait_ready(uint32_t timeout)
+{
+  return ethernetif_wait_ready(timeout);
+}
+
+/**
+  * @brief  Enable fast boot, must be called before stm32_eth_init()
+  * @param  link_config: the last negotiated speed and duplex mode from
+  *         stm32_eth_get_link_config(), 0 if unknown
+  * @retval None
+  */
+void stm32_eth_set_fast_boot(uint8_t link_config)
+{
+  ethernetif_set_fast_boot(link_config);
+}
+
+/**
+  * @brief  Get the last negotiated speed and duplex mode
+  * @param  None
+  * @retval combination of ETH_LINK_CONFIG_xxx, 0 if unknown
+  */
+uint8_t stm32_eth_get_link_config(void)
+{
+  return ethernetif_get_link_config();
+}
+
+/**
+  * @brief  Set a MAC perfect filter address
+  * @param  index: filter index, 1 to ETH_MAC_FILTER_NUM
+  * @param  mac: MAC address, NULL to disable the filter
+  * @param  source: compare with source address instead of destination
+  * @retval 0 on success, -1 on error
+  */
+int stm32_eth_set_mac_filter(uint8_t index, const uint8_t *mac, uint8_t source)
+{
+  return ethernetif_set_mac_filter(index, mac, source, 0);
+}
+
+/**
+  * @brief  Set VLAN tag filter
+  * @param  vid: 12-bit VLAN ID, 0 to disable the filter
+  * @retval 0 on success, -1 on error
+  */
+int stm32_eth_set_vlan_filter(uint16_t vid)
+{
+  return ethernetif_set_vlan_filter(vid);
+}
+
+/**
+  * @brief  Set MAC frame filter mode
+  * @param  mode: ETH_RX_FILTER_xxx combination
+  * @retval 0 on success, -1 on error
+  */
+int stm32_eth_set_rx_filter(uint32_t mode)
+{
+  return ethernetif_set_rx_filter(mode);
+}
+
+/**
+  * @brief  Get MAC frame filter mode
+  * @param  None
+  * @retval ETH_RX_FILTER_xxx combination
+  */
+uint32_t stm32_eth_get_rx_filter(void)
+{
+  return ethernetif_get_rx_filter();
+}
+
+/**
+  * @brief  Tell if more frames are coming, to resume TX DMA once per batch
+  * @param  more: 1 before sending a batch of frames, 0 after it
+  * @retval None
+  */
+void stm32_eth_tx_more(uint8_t more)
+{
+  ethernetif_tx_more(more);
+}
+
+#if ETH_PTP
+/**
+  * @brief  Get the mark of the last transmitted frame, for its time stamp
+  * @param  None
+  * @retval TX mark, 0 if no frame transmitted
+  */
+uint32_t stm32_eth_get_tx_mark(void)
+{
+  return ethernetif_get_tx_mark();
+}
+
+/**
+  * @brief  Get TX time stamp of a transmitted frame
+  * @param  mark: TX mark of the frame
+  * @param  ts: time stamp
+  * @retval 0 on success, -1 if not available
+  */
+int stm32_eth_get_tx_timestamp(uint32_t mark, ethernetif_timestamp_t *ts)
+{
+  return ethernetif_get_tx_timestamp(mark, ts);
+}
+#endif /* ETH_PTP */
+
 #if LWIP_DHCP
 
 /**
@@ -247,6 +444,23 @@ uint8_t stm32_dhcp_started(void)
   return DHCP_Started_by_user;
 }
 
+/**
+  * @brief  End DHCP process: wake up the waiter and call the callback
+  * @param  state: DHCP_ADDRESS_ASSIGNED or DHCP_TIMEOUT
+  * @retval None
+  */
+static void stm32_DHCP_done(uint8_t state)
+{
+  void (*callback)(int) = DHCP_done_callback;
+
+  DHCP_state = state;
+  DHCP_done_callback = NULL;
+  sys_sem_signal(&DHCP_done_sem);
+  if (callback != NULL) {
+    callback((state == DHCP_ADDRESS_ASSIGNED) ? 1 : 0);
+  }
+}
+
 /**
   * @brief  DHCP_Process_Handle
   * @param  netif pointer to generic data structure used for all lwIP network interfaces
@@ -270,22 +484,26 @@ void stm32_DHCP_process(struct netif *netif)
         break;
 
       case DHCP_WAIT_ADDRESS: {
-          if (dhcp_supplied_address(netif)) {
-            DHCP_state = DHCP_ADDRESS_ASSIGNED;
+          /* Address assigned is reported by stm32_DHCP_status_changed(),
+             only check for timeout here */
+          LOCK_TCPIP_CORE();
+          if (DHCP_state != DHCP_WAIT_ADDRESS) {
+            /* Done in the meantime */
+          } else if (dhcp_supplied_address(netif)) {
+            stm32_DHCP_done(DHCP_ADDRESS_ASSIGNED);
           } else {
             dhcp = (struct dhcp *)netif_get_client_data(netif, LWIP_NETIF_CLIENT_DATA_INDEX_DHCP);
 
             /* DHCP timeout */
             if (dhcp->tries > MAX_DHCP_TRIES) {
-              DHCP_state = DHCP_TIMEOUT;
               // If DHCP address not bind, keep DHCP stopped
               DHCP_Started_by_user = 0;
               /* Stop DHCP */
-              LOCK_TCPIP_CORE();
               dhcp_release_and_stop(netif);
-              UNLOCK_TCPIP_CORE();
+              stm32_DHCP_done(DHCP_TIMEOUT);
             }
           }
+          UNLOCK_TCPIP_CORE();
         }
         break;
       case DHCP_ASK_RELEASE:
@@ -304,6 +522,51 @@ void stm32_DHCP_process(struct netif *netif)
   }
 }
 
+/**
+  * @brief  Update DHCP state on network interface status change, with TCPIP
+  *         core locked. DHCP address bound ends the process at once.
+  * @param  netif pointer to generic data structure used for all lwIP network interfaces
+  * @retval None
+  */
+void stm32_DHCP_status_changed(struct netif *netif)
+{
+  if ((DHCP_state == DHCP_WAIT_ADDRESS) && dhcp_supplied_address(netif)) {
+    stm32_DHCP_done(DHCP_ADDRESS_ASSIGNED);
+  }
+}
+
+/**
+  * @brief  Wait for DHCP to be done
+  * @param  timeout: in ms
+  * @retval 1 if address assigned, 0 if DHCP timeout or timeout
+  */
+uint8_t stm32_DHCP_wait(uint32_t timeout)
+{
+  uint32_t start = HAL_GetTick();
+  uint32_t elapsed;
+
+  /* Signals of a former process are told by DHCP state */
+  while ((DHCP_state != DHCP_ADDRESS_ASSIGNED) && (DHCP_state != DHCP_TIMEOUT)) {
+    elapsed = HAL_GetTick() - start;
+    if (elapsed >= timeout) {
+      break;
+    }
+    (void)sys_arch_sem_wait(&DHCP_done_sem, timeout - elapsed);
+  }
+  return (DHCP_state == DHCP_ADDRESS_ASSIGNED) ? 1 : 0;
+}
+
+/**
+  * @brief  Set the function called once when DHCP is done, with TCPIP core
+  *         locked. It must not block.
+  * @param  callback: called with 1 if address assigned, 0 if DHCP timeout
+  * @retval None
+  */
+void stm32_set_DHCP_callback(void (*callback)(int))
+{
+  DHCP_done_callback = callback;
+}
+
 /**
   * @brief  DHCP periodic check
   * @param  netif pointer to generic data structure used for all lwIP network interfaces
@@ -359,6 +622,8 @@ void stm32_set_DHCP_state(uint8_t state) {
   if (DHCP_START == state) {
     DHCP_Started_by_user = 1;
   }
+  /* Wake up ethernet thread to process it */
+  ethernetif_notify(ETH_EVENT_DHCP);
 }
 
 /**
@@ -445,6 +710,8 @@ void ethernetif_notify_conn_changed(struct netif *netif)
     /* Update DHCP state machine if DHCP used */
     if (DHCP_Started_by_user == 1) {
       DHCP_state = DHCP_START;
+      /* Start DHCP without waiting for the next DHCP periodic check */
+      ethernetif_notify(ETH_EVENT_DHCP);
     }
 
     /* When the netif is fully configured this function must be called.*/
@@ -464,6 +731,20 @@ void ethernetif_notify_conn_changed(struct netif *netif)
 
 #endif /* LWIP_NETIF_LINK_CALLBACK */
 
+#if LWIP_NETIF_STATUS_CALLBACK
+
+/**
+  * @brief  This function notify user about network interface status change.
+  * @param  netif: the network interface
+  * @retval None
+  */
+void ethernetif_notify_status_changed(struct netif *netif)
+{
+  stm32_DHCP_status_changed(netif);
+}
+
+#endif /* LWIP_NETIF_STATUS_CALLBACK */
+
 /**
   * @brief  Notify the User about the network interface config status
   * @param  netif: the network interface
@@ -626,19 +907,32 @@ struct pbuf *stm32_new_data(struct pbuf *p, const uint8_t *buffer, size_t size)
 }
 
 void stm32_free_data(struct pbuf_data *data) {
-  if (data->p == NULL) {
-    return;
-  }
-  while (!is_empty(&data->pbuf_queue)) {
-    pbuf_free((struct pbuf *)queue_get(&data->pbuf_queue));
+  while (!data->pbuf_queue.is_empty()) {
+    pbuf_free(data->pbuf_queue.get());
   }
   if (data->p) {
     pbuf_free(data->p);
+    data->p = NULL;
   }
   data->available = 0;
   data->offset = 0;
 }
 
+/**
+  * @brief Get the current pbuf of received data, taking the next queued one
+  * if none. Called by the reader only.
+  * @param data pointer to data structure
+  * @retval current pbuf, or NULL if no data
+  */
+static struct pbuf *stm32_data_head(struct pbuf_data *data)
+{
+  if (data->p == NULL) {
+    data->p = data->pbuf_queue.get();
+    data->offset = 0;
+  }
+  return data->p;
+}
+
 /**
   * @brief This function passes pbuf data to uin8_t buffer. It takes account if
   * pbuf is chained.
@@ -653,19 +947,24 @@ uint16_t stm32_get_data(struct pbuf_data *data, uint8_t *buffer, size_t size)
   uint16_t to_copy;
   uint16_t copied;
 
-  if ((data->p == NULL) || (buffer == NULL) || (size == 0) || (data->available == 0)) {
+  if ((buffer == NULL) || (size == 0) || (data->available == 0) ||
+      (stm32_data_head(data) == NULL)) {
     return 0;
   }
+  /* More than 64K may be available, but not returned at once */
+  if (size > 0xFFFF) {
+    size = 0xFFFF;
+  }
 
   if (size == 1) {
     buffer[0] = pbuf_get_at(data->p, data->offset);
-    data->available--;
+    __atomic_fetch_sub(&data->available, 1, __ATOMIC_RELAXED);
 
     if ((data->offset + 1) == data->p->tot_len) {
       /* Current "pbuf" done */
       pbuf_free(data->p);
       data->offset = 0;
-      data->p = (struct pbuf *)queue_get(&data->pbuf_queue);
+      data->p = data->pbuf_queue.get();
     } else {
       data->offset++;
     }
@@ -677,24 +976,94 @@ uint16_t stm32_get_data(struct pbuf_data *data, uint8_t *buffer, size_t size)
   to_copy = size;
   while (nb < size) {
     copied = pbuf_copy_partial(data->p, &buffer[nb], to_copy, data->offset);
-    data->available -= copied;
+    __atomic_fetch_sub(&data->available, copied, __ATOMIC_RELAXED);
     nb += copied;
 
     if ((copied < to_copy) || ((data->offset + copied) == data->p->tot_len)) {
-      /* Current "pbuf" done */
+      /* Current "pbuf" done: continue from the start of the next one */
       pbuf_free(data->p);
       data->offset = 0;
-      data->p = (struct pbuf *)queue_get(&data->pbuf_queue);
+      data->p = data->pbuf_queue.get();
       if (data->p == NULL)
         break;
+    } else {
+      data->offset += copied;
     }
-    data->offset += copied;
     to_copy -= copied;
   }
 
   return nb;
 }
 
+/**
+  * @brief This function lends the next contiguous segment of received data
+  * without copy. The data stays valid until released by stm32_release_data().
+  * @param data pointer to data structure
+  * @param buffer where to return the pointer to the segment
+  * @retval number of data in the segment
+  */
+uint16_t stm32_borrow_data(struct pbuf_data *data, const uint8_t **buffer)
+{
+  struct pbuf *q;
+  uint16_t offset;
+
+  if ((buffer == NULL) || (data->available == 0) || (stm32_data_head(data) == NULL)) {
+    return 0;
+  }
+
+  /* Find the chained pbuf holding current offset */
+  offset = data->offset;
+  for (q = data->p; (q != NULL) && (offset >= q->len); q = q->next) {
+    offset -= q->len;
+  }
+  if (q == NULL) {
+    return 0;
+  }
+
+  *buffer = (const uint8_t *)q->payload + offset;
+  return q->len - offset;
+}
+
+/**
+  * @brief This function releases borrowed data, and frees the pbufs fully
+  * consumed.
+  * @param data pointer to data structure
+  * @param size the number of data to release
+  * @retval number of data released
+  */
+uint16_t stm32_release_data(struct pbuf_data *data, size_t size)
+{
+  struct pbuf *q;
+  uint16_t consumed;
+
+  if ((size == 0) || (data->available == 0) || (stm32_data_head(data) == NULL)) {
+    return 0;
+  }
+
+  if (size > (size_t)(data->p->tot_len - data->offset)) {
+    size = data->p->tot_len - data->offset;
+  }
+  data->offset += size;
+  __atomic_fetch_sub(&data->available, (uint32_t)size, __ATOMIC_RELAXED);
+
+  if (data->offset == data->p->tot_len) {
+    /* Current "pbuf" done */
+    pbuf_free(data->p);
+    data->offset = 0;
+    data->p = data->pbuf_queue.get();
+  } else if (data->offset >= data->p->len) {
+    /* Free the chained pbufs before current offset */
+    consumed = 0;
+    for (q = data->p; (data->offset - consumed) >= q->len; q = q->next) {
+      consumed += q->len;
+    }
+    data->p = pbuf_free_header(data->p, consumed);
+    data->offset -= consumed;
+  }
+
+  return size;
+}
+
 #if LWIP_UDP
 
 /**
@@ -721,6 +1090,12 @@ void udp_receive_callback(void *arg, struct udp_pcb *pcb, struct pbuf *p,
 
     udp_arg->data.p = p;
     udp_arg->data.available = p->len;
+#if ETH_PTP
+    if (ethernetif_get_rx_timestamp(p, &udp_arg->rx_ts) != 0) {
+      udp_arg->rx_ts.sec = 0;
+      udp_arg->rx_ts.nsec = 0;
+    }
+#endif
 
     ip_addr_copy(udp_arg->ip, *addr);
     udp_arg->port = port;
@@ -803,7 +1178,7 @@ err_t tcp_accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
       client->data.p = NULL;
       client->data.available = 0;
       client->data.offset = 0;
-      queue_init(client->data.pbuf_queue, client->data._pbuf_queue);
+      client->data.pbuf_queue.init();
       client->is_accept = 0;
 
       /* Looking for an empty socket */
@@ -884,22 +1259,17 @@ static err_t tcp_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
     }
     ret_err = err;
   } else if ((tcp_arg->state == TCP_CONNECTED) || (tcp_arg->state == TCP_ACCEPTED)) {
+    /* The reader takes it from queue, "data.p" is left to the reader */
+    if (!tcp_arg->data.pbuf_queue.put(p)) {
+      /* Refused: LwIP keeps the data and passes it again later */
+      LOG_D("Client Q full");
+      return ERR_MEM;
+    }
+    __atomic_fetch_add(&tcp_arg->data.available, p->tot_len, __ATOMIC_RELAXED);
+
     /* Acknowledge data reception */
     tcp_recved(tpcb, p->tot_len);
 
-    if (tcp_arg->data.p == NULL) {
-      tcp_arg->data.p = p;
-      tcp_arg->data.available += p->tot_len;
-      tcp_arg->data.offset = 0;
-    } else {
-      if (!queue_put(&tcp_arg->data.pbuf_queue, (void *)p)) {
-        LOG_E("Client Q full");
-        pbuf_free(p);
-      } else {
-        tcp_arg->data.available += p->tot_len;
-      }
-    }
-
     ret_err = ERR_OK;
   }
   /* data received when connection already closed */
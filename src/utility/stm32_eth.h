@@ -46,6 +46,7 @@
 #include "lwip/udp.h"
 #include "lwip/tcp.h"
 #include "lwip/opt.h"
+#include "ethernetif.h"
 #include <functional>
 
 /* Exported types ------------------------------------------------------------*/
@@ -62,16 +63,18 @@ typedef enum {
 /* Struct to store received data */
 struct pbuf_data {
   struct pbuf *p;     // the packet buffer that was received
-  uint16_t available; // number of data
+  uint32_t available; // number of data, may exceed 64K with coalesced (GRO) segments queued
   uint16_t offset;
-  void *_pbuf_queue[ETH_RXBUFNB];
-  queue_t pbuf_queue;
+  spsc_queue<struct pbuf *, ETH_RXBUFNB + 1> pbuf_queue; // received pbufs after "p", from tcpip thread to reader
 };
 
 /* UDP structure */
 struct udp_struct {
   struct udp_pcb *pcb; /* pointer on the current udp_pcb */
   struct pbuf_data data;
+#if ETH_PTP
+  ethernetif_timestamp_t rx_ts; // the RX time stamp of the packet
+#endif
   ip_addr_t ip;       // the remote IP address from which the packet was received
   u16_t port;         // the remote port from which the packet was received
   std::function<void()> onDataArrival;
@@ -125,12 +128,27 @@ struct tcp_struct {
 void stm32_eth_init(const uint8_t *mac, const uint8_t *ip, const uint8_t *gw, const uint8_t *netmask);
 uint8_t stm32_eth_is_init(void);
 uint8_t stm32_eth_link_up(void);
+uint8_t stm32_eth_wait_ready(uint32_t timeout);
+void stm32_eth_set_fast_boot(uint8_t link_config);
+uint8_t stm32_eth_get_link_config(void);
+int stm32_eth_set_mac_filter(uint8_t index, const uint8_t *mac, uint8_t source);
+int stm32_eth_set_vlan_filter(uint16_t vid);
+int stm32_eth_set_rx_filter(uint32_t mode);
+uint32_t stm32_eth_get_rx_filter(void);
+void stm32_eth_tx_more(uint8_t more);
+#if ETH_PTP
+uint32_t stm32_eth_get_tx_mark(void);
+int stm32_eth_get_tx_timestamp(uint32_t mark, ethernetif_timestamp_t *ts);
+#endif
 
 void User_notification(struct netif *netif);
 
 #if LWIP_DHCP
   void stm32_DHCP_Process(struct netif *netif);
   void stm32_DHCP_Periodic_Handle(struct netif *netif);
+  void stm32_DHCP_status_changed(struct netif *netif);
+  uint8_t stm32_DHCP_wait(uint32_t timeout);
+  void stm32_set_DHCP_callback(void (*callback)(int));
   void stm32_DHCP_manual_config(void);
   uint8_t stm32_get_DHCP_lease_state(void);
   void stm32_set_DHCP_state(uint8_t state);
@@ -162,6 +180,8 @@ uint32_t stm32_eth_get_dhcpaddr(void);
 struct pbuf *stm32_new_data(struct pbuf *p, const uint8_t *buffer, size_t size);
 void stm32_free_data(struct pbuf_data *data);
 uint16_t stm32_get_data(struct pbuf_data *data, uint8_t *buffer, size_t size);
+uint16_t stm32_borrow_data(struct pbuf_data *data, const uint8_t **buffer);
+uint16_t stm32_release_data(struct pbuf_data *data, size_t size);
 
 ip_addr_t *u8_to_ip_addr(uint8_t *ipu8, ip_addr_t *ipaddr);
 uint32_t ip_addr_to_u32(ip_addr_t *ipaddr);